@@ -5,10 +5,25 @@
  * Forked on 2/21
  */
 
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE // for MAP_ANONYMOUS and madvise()
+#endif
+
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
 #include <assert.h>
 //#include <w32api/rpcndr.h>
 #include <stdio.h> // for perror()
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/syscall.h> // for mbind() and getcpu(), which glibc does not wrap
 
 #include "mem_pool.h"
 
@@ -28,9 +43,72 @@ static const unsigned   MEM_NODE_HEAP_INIT_CAPACITY     = 40;
 static const float      MEM_NODE_HEAP_FILL_FACTOR       = .75; //MEM_FILL_FACTOR;
 static const unsigned   MEM_NODE_HEAP_EXPAND_FACTOR     = 2;    //MEM_EXPAND_FACTOR;
 
-static const unsigned   MEM_GAP_IX_INIT_CAPACITY        = 40;
-static const float      MEM_GAP_IX_FILL_FACTOR          = 0.75; //MEM_FILL_FACTOR;
-static const unsigned   MEM_GAP_IX_EXPAND_FACTOR        = 2;    //MEM_EXPAND_FACTOR;
+static const unsigned   MEM_ADDR_MAP_INIT_CAPACITY      = 64;   // power of 2
+static const float      MEM_ADDR_MAP_FILL_FACTOR        = 0.75; //MEM_FILL_FACTOR;
+static const unsigned   MEM_ADDR_MAP_EXPAND_FACTOR      = 2;    //MEM_EXPAND_FACTOR;
+static const unsigned   MEM_ADDR_MAP_EMPTY              = UINT_MAX;
+
+// segregated fit: each power-of-two size range (first level) is split
+// linearly into 2^MEM_SEG_SL_LOG2 size classes (second level)
+#define MEM_SEG_SL_LOG2     4
+#define MEM_SEG_SL_COUNT    (1 << MEM_SEG_SL_LOG2)
+#define MEM_SEG_FL_COUNT    (64 - MEM_SEG_SL_LOG2 + 1)
+// the most gaps of the request's own class looked at when no class above it
+// has a gap, so that a lookup stays O(1) however many gaps the class holds
+static const unsigned   MEM_SEG_FIT_SCAN                = 4;
+
+// boundary-tag pools: block sizes are multiples of MEM_TAG_ALIGN, which leaves
+// the low bits of the size word in the header free for the flags
+static const size_t     MEM_TAG_ALIGN                   = sizeof(size_t);
+static const size_t     MEM_TAG_ALLOCATED               = 1;
+static const size_t     MEM_TAG_PREV_ALLOCATED          = 2;
+static const size_t     MEM_TAG_FLAGS                   = sizeof(size_t) - 1;
+#define MEM_TAG_MIN_BLOCK   (sizeof(tag_t) + sizeof(size_t)) // header + footer of a gap
+static const size_t     MEM_TAG_NONE                    = SIZE_MAX; // gap link to no gap
+
+// per-thread caches: requests up to MEM_CACHE_MAX_SIZE bytes are rounded up to
+// a multiple of MEM_CACHE_GRAIN, and each such size has a list of cached blocks
+#define MEM_CACHE_GRAIN     16
+#define MEM_CACHE_MAX_SIZE  512
+#define MEM_CACHE_CLASSES   (MEM_CACHE_MAX_SIZE / MEM_CACHE_GRAIN)
+static const unsigned   MEM_CACHE_BOUND                 = 64;   // blocks per size class
+static const unsigned   MEM_CACHE_BATCH                 = 16;   // blocks per refill or flush
+
+// mapped pools: pools with huge pages start at a multiple of MEM_HUGE_PAGE_SIZE
+static const size_t     MEM_HUGE_PAGE_SIZE              = (size_t) 2 << 20;
+
+// aligned allocations: the most gap index nodes visited in search of the
+// first gap that holds a block once it is aligned
+static const unsigned   MEM_ALIGNED_SCAN                = 64;
+
+// growable pools: the most extents a pool adds to the memory it is opened with
+#define MEM_MAX_EXTENTS     64
+
+// file-backed pools: the first bytes of the file
+static const char       MEM_FILE_MAGIC[8]               = { 'm', 'e', 'm', 'p', 'o', 'o', 'l', '1' };
+
+// arena pools: every block starts at a multiple of MEM_ARENA_ALIGN
+static const size_t     MEM_ARENA_ALIGN                 = sizeof(size_t);
+
+// sharded pools: how many pools a thread remembers its arena in
+#define MEM_SHARD_HINTS     4
+
+// NUMA pools: the most nodes a pool can be bound to or spread over, and how
+// many allocations a thread makes before it looks up its node again
+#define MEM_NUMA_MAX_NODES  64
+static const unsigned   MEM_NUMA_RECHECK                = 64;
+static const int        MEM_NUMA_MPOL_BIND              = 2; // MPOL_BIND of <linux/mempolicy.h>
+
+// handle pools: the handle table starts with room for MEM_HANDLES_INIT_CAPACITY
+// handles, and an entry of a free handle holds the next free one | MEM_HANDLE_FREE
+static const unsigned   MEM_HANDLES_INIT_CAPACITY       = 64;
+static const unsigned   MEM_HANDLES_EXPAND_FACTOR       = 2;    //MEM_EXPAND_FACTOR;
+static const unsigned   MEM_HANDLE_FREE                 = 1u << 31;
+
+// lock-free slab pools: the top of the free stack is the low half of the head
+// word, and a new head of the next generation is made from the old one
+#define MEM_SLAB_LF_TOP(head)           ((uint32_t) (head))
+#define MEM_SLAB_LF_NEXT(head, top)     (((((head) >> 32) + 1) << 32) | (uint64_t) (top))
 
 
 
@@ -44,22 +122,138 @@ typedef struct _node {
     unsigned used;
     unsigned allocated;
     struct _node *next, *prev; // doubly-linked list for gap deletion
+    struct _node *gap_left, *gap_right; // gap index links, gaps only (tree children, or
+                                        // prev/next in a size class list for SEGREGATED_FIT)
+    unsigned gap_height;
+    size_t gap_max; // largest gap in the subtree rooted here
+    unsigned extent; // growable pools: first node of an added extent, never merged with the one before
+    alloc_handle_t handle; // handle pools: the handle of a block that may move (0 for one allocated
+                           // by address, which is in the address map instead)
+    unsigned pins; // handle pools: how many pins keep the block where it is
 } node_t, *node_pt;
 
-typedef struct _gap {
+// memory a growable pool has added to the memory it was opened with
+typedef struct _extent {
+    char *mem;
     size_t size;
-    node_pt node;
-} gap_t, *gap_pt;
+    size_t map_size; // as for the pool memory
+} extent_t, *extent_pt;
+
+typedef struct _seg_map {
+    uint64_t fl_bitmap;                 // first-level ranges with a non-empty class
+    unsigned sl_bitmap[MEM_SEG_FL_COUNT]; // non-empty classes in each range
+} seg_map_t, *seg_map_pt;
+
+typedef struct _seg_ix {
+    seg_map_t map;
+    node_pt heads[MEM_SEG_FL_COUNT][MEM_SEG_SL_COUNT];
+} seg_ix_t, *seg_ix_pt;
+
+// header of a block of a boundary-tag pool; a gap also repeats its size in its
+// last word (the footer), so that the block after it can find its start
+typedef struct _tag {
+    union {
+        alloc_t alloc_record;               // allocations: the record handed to the user
+        struct {
+            size_t prev_gap, next_gap; // gaps: links in their size class list, as offsets
+                                       // from the pool memory (MEM_TAG_NONE for none)
+        };
+    };
+    size_t size_flags; // block size (header included) | MEM_TAG_* flags
+} tag_t, *tag_pt;
+
+typedef struct _tag_ix {
+    seg_map_t map;
+    size_t heads[MEM_SEG_FL_COUNT][MEM_SEG_SL_COUNT]; // offsets, like the links
+} tag_ix_t, *tag_ix_pt;
+
+// The start of the file of a file-backed pool, which the pool memory follows
+// at the next page boundary. Nothing in the file but the allocation records
+// depends on where it is mapped.
+typedef struct _file_header {
+    char magic[sizeof(MEM_FILE_MAGIC)];
+    size_t header_size;
+    char *base; // where the file was mapped when it was last open
+    pool_t pool; // the counters of the pool when it was last closed (shared pools: always)
+    size_t root; // offset of the root allocation in the pool memory (MEM_TAG_NONE for none)
+    unsigned open; // processes that have the pool open (or did not close it)
+    unsigned shared;
+    pthread_mutex_t lock; // shared pools: the process-shared pool lock
+    tag_ix_t tag_ix;
+} file_header_t, *file_header_pt;
+
+// the blocks of one size class that a thread keeps for itself
+typedef struct _cache_class {
+    char *head; // linked through the first word of the blocks
+    unsigned count;
+} cache_class_t, *cache_class_pt;
+
+// a thread's cache of one pool; a thread's caches are on a list
+typedef struct _mem_cache {
+    struct _pool_mgr *pool_mgr;
+    unsigned long cache_id; // the cache_id of the pool when the cache was made for it
+    struct _mem_cache *next;
+    cache_class_t classes[MEM_CACHE_CLASSES];
+    cache_stats_t stats;
+} mem_cache_t, *mem_cache_pt;
 
 typedef struct _pool_mgr {
     pool_t pool;
+    pool_kind kind;
+    size_t map_size; // mapped pools: the length of the mapping, 0 if the memory comes from malloc
+    size_t decommit; // gaps of at least this many bytes give their pages back (0 for never)
+    size_t decommitted; // bytes given back so far
+    unsigned long decommits; // calls that gave pages back
+    size_t max_size; // growable pools: the most total_size may grow to (0 if the pool cannot grow)
+    extent_pt extents; // growable pools: the MEM_MAX_EXTENTS extents that can be added
+    unsigned num_extents;
+    pool_opts_t opts; // the options the pool was opened with, to map extents as the pool memory
+    file_header_pt file; // file-backed pools: the start of the mapping, which map_size covers
+    unsigned shared; // shared pools: the lock and the counters are those in the file
     node_pt node_heap;
     unsigned total_nodes;
     unsigned used_nodes;
-    gap_pt gap_ix;
-    unsigned gap_ix_capacity;
+    node_pt free_nodes; // stack of unused nodes, linked through next
+    unsigned *addr_map; // open-addressing hash of allocation mem -> node heap index
+    unsigned addr_map_capacity;
+    node_pt gap_ix; // root of the gap index tree, ordered by (size, mem) for BEST_FIT, by mem otherwise
+    node_pt rover; // NEXT_FIT: the node the next gap search starts at (null for the top of the pool)
+    seg_ix_pt seg_ix; // segregated free lists, used instead of the tree for SEGREGATED_FIT
+    tag_ix_pt tag_ix; // segregated free lists of a boundary-tag pool (which has no node heap)
+    size_t slab_size; // slab pools: the size of a slot (the object size, aligned)
+    unsigned slab_slots;
+    unsigned slab_unused; // slots from this one on have never been handed out
+    char *slab_free; // free slots, linked through their first word
+    alloc_pt slab_records; // allocation record of each slot, size 0 while it is free
+    unsigned lock_free;
+    uint64_t slab_head; // lock-free slab pools: generation and top of the free stack
+    uint32_t *slab_next; // lock-free slab pools: the slot below each one on the free stack
+    size_t arena_top; // arena pools: offset of the first byte that has not been handed out
+    unsigned thread_safe;
+    pthread_mutex_t lock; // thread-safe pools: held by every call that reads or changes the pool
+    unsigned thread_cache;
+    unsigned long cache_id; // thread-cached pools: unique among all the pools ever opened
+    unsigned num_shards; // sharded pools: the arenas, which own consecutive parts of the memory
+    struct _pool_mgr **shards;
+    size_t *shard_bounds; // offset at which each arena starts, and the pool size
+    unsigned next_shard; // the arena of the next thread to use the pool
+    unsigned remote_free;
+    pthread_t owner; // remote-free pools: the thread that opened the pool
+    char *remote_frees; // deallocations queued by other threads, linked through the blocks
+    unsigned num_nodes; // NUMA-local pools: the pool of each node id, null for nodes that are not online
+    struct _pool_mgr **nodes;
+    unsigned *handles; // handle pools: the node heap index of the block of each handle (handle 1 first)
+    unsigned handle_capacity;
+    unsigned num_handles; // handles handed out so far, free ones included
+    alloc_handle_t free_handle; // first free handle (0 for none)
 } pool_mgr_t, *pool_mgr_pt;
 
+// the arena a thread uses in a sharded pool
+typedef struct _shard_hint {
+    pool_mgr_pt pool_mgr;
+    unsigned shard;
+} shard_hint_t, *shard_hint_pt;
+
 
 
 /***************************/
@@ -70,6 +264,15 @@ typedef struct _pool_mgr {
 static pool_mgr_pt *pool_store = NULL; // an array of pointers, only expand
 static unsigned pool_store_size = 0;
 static unsigned pool_store_capacity = 0;
+static pthread_mutex_t pool_store_lock = PTHREAD_MUTEX_INITIALIZER; // held by open and close only
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key; // the calling thread's list of caches
+static int cache_key_status = -1;
+static unsigned long cache_ids = 0; // the cache_id of the last thread-cached pool opened
+static _Thread_local shard_hint_t shard_hints[MEM_SHARD_HINTS];
+static _Thread_local unsigned shard_hint_next;
+static _Thread_local unsigned numa_thread_node; // the node the calling thread last ran on
+static _Thread_local unsigned numa_thread_calls;
 
 
 
@@ -79,8 +282,27 @@ static unsigned pool_store_capacity = 0;
 /*                                          */
 /********************************************/
 static alloc_status _mem_resize_pool_store();
+static pool_mgr_pt _mem_new_pool_mgr(size_t mem_pool_size, const pool_opts_t *opts);
+static void _mem_free_pool_mgr(pool_mgr_pt pool_mgr);
+static char *_mem_alloc_extent(size_t size, const pool_opts_t *opts, size_t *map_size);
+static void _mem_free_extent(char *mem, size_t map_size);
+static void _mem_free_pool_mem(pool_mgr_pt pool_mgr);
+static void _mem_decommit(pool_mgr_pt pool_mgr, char *gap, char *gap_end, char *from, char *to);
+static alloc_status _mem_resident(const char *mem, size_t size, size_t *resident);
+static void _mem_lock(pool_mgr_pt pool_mgr);
+static void _mem_unlock(pool_mgr_pt pool_mgr);
+static alloc_pt _mem_new_alloc(pool_mgr_pt pool_mgr, size_t req_size);
+static alloc_status _mem_del_alloc(pool_mgr_pt pool_mgr, const char *mem);
+static alloc_pt _mem_new_alloc_aligned(pool_mgr_pt pool_mgr, size_t req_size, size_t alignment);
+static alloc_pt _mem_alloc_in_gap(pool_mgr_pt pool_mgr, node_pt alloc_node, size_t pad, size_t req_size);
+static alloc_status _mem_new_alloc_batch(pool_mgr_pt pool_mgr, const size_t sizes[], unsigned n, char *out[]);
+static alloc_status _mem_del_alloc_batch(pool_mgr_pt pool_mgr, char *mems[], unsigned n);
+static char *_mem_realloc(pool_mgr_pt pool_mgr, char *mem, size_t size);
+static void _mem_inspect_node_heap(pool_mgr_pt pool_mgr, pool_segment_pt *segments, unsigned *num_segments);
+static alloc_status _mem_init_node_heap(pool_mgr_pt pool_mgr);
 static alloc_status _mem_resize_node_heap(pool_mgr_pt pool_mgr);
-static alloc_status _mem_resize_gap_ix(pool_mgr_pt pool_mgr);
+static alloc_status _mem_reserve_nodes(pool_mgr_pt pool_mgr, unsigned count);
+static alloc_status _mem_expand_node_heap(pool_mgr_pt pool_mgr);
 static alloc_status
         _mem_add_to_gap_ix(pool_mgr_pt pool_mgr,
                            size_t size,
@@ -89,9 +311,83 @@ static alloc_status
         _mem_remove_from_gap_ix(pool_mgr_pt pool_mgr,
                                 size_t size,
                                 node_pt node);
-static alloc_status _mem_sort_gap_ix(pool_mgr_pt pool_mgr);
+static node_pt _mem_find_gap_ix(pool_mgr_pt pool_mgr, size_t size);
+static void _mem_rebase_node_heap(pool_mgr_pt pool_mgr, uintptr_t old_base);
+static void _mem_release_nodes(pool_mgr_pt pool_mgr, unsigned first, unsigned last);
+static node_pt _mem_acquire_node(pool_mgr_pt pool_mgr);
+static void _mem_release_node(pool_mgr_pt pool_mgr, node_pt node);
+static node_pt _gap_insert(node_pt root, node_pt node, alloc_policy order);
+static node_pt _gap_remove(node_pt root, node_pt node, int *found, alloc_policy order);
+static node_pt _gap_find_first(node_pt root, const char *from, size_t size);
+static node_pt _gap_find_aligned(node_pt root, size_t size, size_t alignment, unsigned *budget);
+static void _seg_insert(seg_ix_pt seg_ix, node_pt node);
+static void _seg_remove(seg_ix_pt seg_ix, node_pt node);
+static node_pt _seg_find(seg_ix_pt seg_ix, size_t size);
+static alloc_status _mem_resize_addr_map(pool_mgr_pt pool_mgr);
+static alloc_status _mem_expand_addr_map(pool_mgr_pt pool_mgr);
+static void _mem_add_to_addr_map(pool_mgr_pt pool_mgr, node_pt node);
+static void _mem_remove_from_addr_map(pool_mgr_pt pool_mgr, node_pt node);
+static node_pt _mem_find_addr_map(pool_mgr_pt pool_mgr, const char *mem);
+static alloc_status _mem_del_node(pool_mgr_pt pool_mgr, node_pt del_node);
+static alloc_status _mem_resize_node(pool_mgr_pt pool_mgr, node_pt node, size_t size);
+static unsigned _mem_empty_pool_gaps(pool_mgr_pt pool_mgr);
+static unsigned _mem_buddy_top_blocks(size_t size);
+static alloc_status _mem_init_buddy(pool_mgr_pt pool_mgr);
+static node_pt _mem_new_buddy(pool_mgr_pt pool_mgr, size_t size);
+static alloc_status _mem_del_buddy(pool_mgr_pt pool_mgr, node_pt del_node);
 static void insert_node_heap(node_pt first_node, node_pt insert_node);
 static node_pt merge_gaps(pool_mgr_pt pool_mgr, node_pt first_node, node_pt next_node);
+static void _mem_absorb_node(pool_mgr_pt pool_mgr, node_pt first_node, node_pt next_node);
+static alloc_status _mem_grow(pool_mgr_pt pool_mgr, size_t size);
+static alloc_status _mem_shrink(pool_mgr_pt pool_mgr, node_pt gap);
+static alloc_status _tag_init_pool(pool_mgr_pt pool_mgr);
+static tag_pt _tag_new_alloc(pool_mgr_pt pool_mgr, size_t size);
+static alloc_status _tag_del_alloc(pool_mgr_pt pool_mgr, tag_pt tag);
+static alloc_status _tag_resize_alloc(pool_mgr_pt pool_mgr, tag_pt tag, size_t size);
+static tag_pt _tag_find_alloc(pool_mgr_pt pool_mgr, const char *mem);
+static size_t _tag_size(tag_pt tag);
+static void _tag_inspect_pool(pool_mgr_pt pool_mgr, pool_segment_pt *segments, unsigned *num_segments);
+static alloc_status _slab_init_pool(pool_mgr_pt pool_mgr, size_t obj_size);
+static alloc_pt _slab_new_alloc(pool_mgr_pt pool_mgr, size_t size);
+static alloc_status _slab_del_alloc(pool_mgr_pt pool_mgr, alloc_pt record);
+static alloc_pt _slab_find_alloc(pool_mgr_pt pool_mgr, const char *mem);
+static void _slab_inspect_pool(pool_mgr_pt pool_mgr, pool_segment_pt *segments, unsigned *num_segments);
+static alloc_status _slab_lf_init_pool(pool_mgr_pt pool_mgr);
+static alloc_pt _slab_lf_new_alloc(pool_mgr_pt pool_mgr, size_t size);
+static alloc_status _slab_lf_del_alloc(pool_mgr_pt pool_mgr, const char *mem);
+static alloc_status _arena_init_pool(pool_mgr_pt pool_mgr);
+static char *_arena_new_block(pool_mgr_pt pool_mgr, size_t size, size_t header);
+static alloc_pt _arena_new_alloc(pool_mgr_pt pool_mgr, size_t size);
+static alloc_status _arena_del_alloc(pool_mgr_pt pool_mgr, const char *mem);
+static alloc_status _arena_reset(pool_mgr_pt pool_mgr, const arena_mark_t *mark);
+static void _arena_inspect_pool(pool_mgr_pt pool_mgr, pool_segment_pt *segments, unsigned *num_segments);
+static mem_cache_pt _cache_get(pool_mgr_pt pool_mgr, int create);
+static void _cache_flush(mem_cache_pt cache);
+static void _cache_release(mem_cache_pt cache);
+static alloc_pt _cache_new_alloc(pool_mgr_pt pool_mgr, size_t req_size);
+static alloc_status _cache_del_alloc(pool_mgr_pt pool_mgr, char *mem);
+static alloc_status _shard_init_pool(pool_mgr_pt pool_mgr, unsigned num_shards);
+static void _shard_free(pool_mgr_pt pool_mgr);
+static alloc_pt _shard_new_alloc(pool_mgr_pt pool_mgr, size_t size, char **mem);
+static alloc_status _shard_del_alloc(pool_mgr_pt pool_mgr, const char *mem);
+static void _shard_inspect_pool(pool_mgr_pt pool_mgr, pool_segment_pt *segments, unsigned *num_segments);
+static alloc_status _remote_push(pool_mgr_pt pool_mgr, char *mem);
+static void _remote_drain(pool_mgr_pt pool_mgr);
+static alloc_status _file_open_pool(pool_mgr_pt pool_mgr, const char *path);
+static void _file_close_pool(pool_mgr_pt pool_mgr);
+static uint64_t _numa_online(void);
+static alloc_status _numa_bind(char *mem, size_t size, unsigned node);
+static pool_mgr_pt _numa_open_pool(size_t size, const pool_opts_t *opts);
+static alloc_pt _numa_new_alloc(pool_mgr_pt pool_mgr, size_t size, char **mem);
+static alloc_status _numa_del_alloc(pool_mgr_pt pool_mgr, const char *mem);
+static char *_numa_realloc(pool_mgr_pt pool_mgr, char *mem, size_t size);
+static void _numa_inspect_pool(pool_mgr_pt pool_mgr, pool_segment_pt *segments, unsigned *num_segments);
+static alloc_status _handle_init_pool(pool_mgr_pt pool_mgr);
+static node_pt _handle_find(pool_mgr_pt pool_mgr, alloc_handle_t handle);
+static alloc_handle_t _handle_new_alloc(pool_mgr_pt pool_mgr, size_t size);
+static alloc_status _handle_del_alloc(pool_mgr_pt pool_mgr, alloc_handle_t handle);
+static alloc_status _handle_compact(pool_mgr_pt pool_mgr);
+static void _handle_move_node(pool_mgr_pt pool_mgr, node_pt from, node_pt to);
 
 
 /****************************************/
@@ -139,86 +435,105 @@ alloc_status mem_free() {
 }
 
 pool_pt mem_pool_open(size_t mem_pool_size, alloc_policy policy) {
+    pool_opts_t opts = { .policy = policy, .kind = POOL_NODE_HEAP };
 
-    // make sure there the pool store is allocated
-    if (pool_store == NULL){
-        printf("pool store not open\n");
+    return mem_pool_open_opts(mem_pool_size, &opts);
+}
+
+pool_pt mem_pool_open_opts(size_t mem_pool_size, const pool_opts_t *opts) {
+
+    if (opts == NULL){
         return NULL;
     }
-    // expand the pool store, if necessary
-    _mem_resize_pool_store();
-
-    // allocate a new mem pool mgr
-    pool_mgr_pt new_pool_mgr = (pool_mgr_pt) malloc(sizeof(pool_mgr_t));
-    // check success, on error return null
-    // any other cases which would fail?
-    if (new_pool_mgr == NULL){
+    // boundary-tag pools keep their gaps on in-band size class lists only
+    if (opts->kind == POOL_BOUNDARY_TAG && opts->policy != SEGREGATED_FIT){
         return NULL;
     }
-
-    // initialize pool memory block, check success, on error deallocate mgr and return null
-    char* new_mem_pool = (char*) malloc(sizeof(mem_pool_size));
-
-    if (new_mem_pool == NULL){
-        free(new_pool_mgr);
+    // a cached block has to be given back without the pool lock, so its
+    // record must not move: only boundary-tag and slab pools can be cached
+    if (opts->thread_cache && (!opts->thread_safe
+                               || (opts->kind != POOL_BOUNDARY_TAG && opts->kind != POOL_SLAB))){
         return NULL;
     }
-
-    // allocate a new node heap
-    node_pt new_node_heap = (node_pt) calloc(MEM_NODE_HEAP_INIT_CAPACITY, sizeof(node_t));
-
-    // check success, on error deallocate mgr/pool and return null
-    if (new_node_heap == NULL){
-        free(new_pool_mgr->pool.mem);
-        free(new_pool_mgr);
+    // sharded pools are made of node heap arenas, whose boundaries move
+    if (opts->shards > 1 && (opts->kind != POOL_NODE_HEAP || opts->policy == BUDDY
+                             || opts->thread_cache || mem_pool_size < opts->shards)){
         return NULL;
     }
-
-    // allocate a new gap index
-    gap_pt new_gap_index = (gap_pt) calloc(MEM_GAP_IX_INIT_CAPACITY, sizeof(gap_t));
-    // check success, on error deallocate mgr/pool/heap and return null
-    if (new_gap_index == NULL){
-        free(new_pool_mgr->pool.mem);
-        free(new_pool_mgr);
-        free(new_node_heap);
+    // queued deallocations go straight to the pool (neither through a cache nor to an arena)
+    if (opts->remote_free && (opts->thread_cache || opts->shards > 1)){
+        return NULL;
+    }
+    // lock-free pools have a single slot size and no lock to take
+    if (opts->lock_free && (opts->kind != POOL_SLAB || opts->thread_cache || opts->remote_free)){
+        return NULL;
+    }
+    // growable pools mark where their extents start in the node list; a queued
+    // deallocation is checked against the pool range without the lock, so it
+    // cannot look at the extents
+    if (opts->max_size != 0 && (opts->kind != POOL_NODE_HEAP || opts->policy == BUDDY
+                                || opts->shards > 1 || opts->remote_free
+                                || opts->max_size < mem_pool_size)){
+        return NULL;
+    }
+    // file-backed pools keep all of their metadata in the file, which only a
+    // boundary-tag pool can; the file decides the mapping
+    if (opts->path != NULL && (opts->kind != POOL_BOUNDARY_TAG || opts->thread_cache
+                               || opts->huge_pages || opts->prefault)){
+        return NULL;
+    }
+    // a shared pool is a file-backed one, and its queue would be process-private
+    if (opts->shared && (opts->path == NULL || opts->remote_free)){
+        return NULL;
+    }
+    // a NUMA-bound pool is mapped, on a node that is online
+    if (opts->numa_bind && (opts->path != NULL || opts->numa_node >= MEM_NUMA_MAX_NODES
+                            || ((_numa_online() >> opts->numa_node) & 1) == 0)){
+        return NULL;
+    }
+    // a NUMA-local pool is made of a locked pool per node, and finds the pool
+    // of a block by its address
+    if (opts->numa_local && (opts->kind == POOL_ARENA || opts->numa_bind || opts->shards > 1
+                             || opts->thread_cache || opts->remote_free || opts->lock_free
+                             || opts->max_size != 0 || opts->path != NULL)){
+        return NULL;
+    }
+    // a block that compaction moves is found by its handle alone, so its pool
+    // has to be a single node heap that is locked as a whole
+    if (opts->handles && (opts->kind != POOL_NODE_HEAP || opts->policy == BUDDY || opts->shards > 1
+                          || opts->max_size != 0 || opts->numa_local)){
+        return NULL;
+    }
+    // set up the pool (or the pool of each node)
+    pool_mgr_pt new_pool_mgr = opts->numa_local ? _numa_open_pool(mem_pool_size, opts)
+                                                : _mem_new_pool_mgr(mem_pool_size, opts);
+    if (new_pool_mgr == NULL){
         return NULL;
     }
 
-    // assign all the pointers and update meta data:
-    //   initialize top node of node heap
-    new_node_heap[0].alloc_record.size = mem_pool_size;
-    new_node_heap[0].alloc_record.mem = new_mem_pool;
-    new_node_heap[0].used = 1;
-    new_node_heap[0].allocated = 0;
-    new_node_heap[0].next = NULL;
-    new_node_heap[0].prev = NULL;
-
-    //   initialize top node of gap index
-    new_gap_index[0].size = mem_pool_size;
-    new_gap_index[0].node = new_node_heap;
-
-    //   initialize pool mgr pool
-    new_pool_mgr->pool.mem = new_mem_pool;
-    new_pool_mgr->pool.total_size = mem_pool_size;
-    new_pool_mgr->pool.alloc_size = 0;
-    new_pool_mgr->pool.policy = policy;
-    new_pool_mgr->pool.num_allocs = 0;
-    new_pool_mgr->pool.num_gaps = 1;
-
-    // initialize pool mgr
-    new_pool_mgr->node_heap = new_node_heap;
-    new_pool_mgr->total_nodes = MEM_NODE_HEAP_INIT_CAPACITY;
-    new_pool_mgr->used_nodes = 1;
-    new_pool_mgr->gap_ix = new_gap_index;
-    new_pool_mgr->gap_ix_capacity = MEM_GAP_IX_INIT_CAPACITY;
-
-    //   link pool mgr to pool store
+    //   link pool mgr to pool store (the only part that other pools share)
+    pthread_mutex_lock(&pool_store_lock);
+    // make sure there the pool store is allocated
+    if (pool_store == NULL){
+        pthread_mutex_unlock(&pool_store_lock);
+        printf("pool store not open\n");
+        _mem_free_pool_mgr(new_pool_mgr);
+        return NULL;
+    }
+    // expand the pool store, if necessary
+    if (_mem_resize_pool_store() != ALLOC_OK){
+        pthread_mutex_unlock(&pool_store_lock);
+        _mem_free_pool_mgr(new_pool_mgr);
+        return NULL;
+    }
     pool_store[pool_store_size] = new_pool_mgr;
+    pool_store_size++;
+    pthread_mutex_unlock(&pool_store_lock);
 
 
 
     //assert(sizeof(new_pool_mgr->pool.mem) == mem_pool_size);
-    assert(((int)new_pool_mgr->gap_ix->size) == ((int)mem_pool_size));
+    assert(new_pool_mgr->pool.num_gaps >= 1);
     // return the address of the mgr, cast to (pool_pt)
     return (pool_pt)new_pool_mgr;
 }
@@ -231,31 +546,38 @@ alloc_status mem_pool_close(pool_pt pool) {
     pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
     // check if this pool is allocated
 
-    // check if pool has only one gap
-    if (pool->num_gaps != 1){
+    // carry out the deallocations other threads have queued
+    _remote_drain(pool_mgr);
+    // an arena is released as a whole, however much of it is in use
+    if (pool_mgr->kind == POOL_ARENA){
+        _arena_reset(pool_mgr, NULL);
+    }
+
+    // check if pool has only one gap (or as many as it had when it was opened),
+    // unless it keeps its allocations in a file
+    if (pool_mgr->file == NULL && pool->num_gaps != _mem_empty_pool_gaps(pool_mgr)){
         return ALLOC_NOT_FREED;
     }
     // check if it has zero allocations
-    if (pool->num_allocs != 0){
+    if (pool_mgr->file == NULL && pool->num_allocs != 0){
         return ALLOC_NOT_FREED;
     }
-    // free memory pool
-    // free node heap
-    // free gap index
-    free(pool->mem);
-    free(pool_mgr->node_heap);
-    free(pool_mgr->gap_ix);
+    // the closing thread's cache is empty by now (other threads free theirs when they exit)
+    if (pool_mgr->thread_cache){
+        mem_cache_flush(pool);
+    }
     // find mgr in pool store and set to null
-    unsigned i = 0;
-    while(i < pool_store_size){
+    pthread_mutex_lock(&pool_store_lock);
+    for (unsigned i = 0; i < pool_store_size; i++){
         if (pool_store[i] == pool_mgr){
             pool_store[i] = NULL;
-            i = pool_store_size;
+            break;
         }
     }
+    pthread_mutex_unlock(&pool_store_lock);
     // note: don't decrement pool_store_size, because it only grows
-    // free mgr
-    free(pool_mgr);
+    // free memory pool, node heap (the gap index lives inside it) and mgr
+    _mem_free_pool_mgr(pool_mgr);
 
     return ALLOC_OK;
 }
@@ -263,419 +585,4008 @@ alloc_status mem_pool_close(pool_pt pool) {
 alloc_pt mem_new_alloc(pool_pt pool, size_t req_size) {
     // get mgr from pool by casting the pointer to (pool_mgr_pt)
     pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
-    // check if any gaps, return null if none
-    if (pool->num_gaps == 0){
-        return NULL;
-    }
-    // expand heap node, if necessary, quit on error
-    alloc_status status =_mem_resize_node_heap(pool_mgr);
-    assert(status != ALLOC_FAIL);
+    alloc_pt alloc;
 
-    // Find a large enough node for allocation:
-    // if FIRST_FIT, then find the first sufficient node in the node heap
-    node_pt alloc_node = NULL;
-    if (pool->policy == FIRST_FIT){
-        node_pt current_node = pool_mgr->node_heap;
-        while (current_node != NULL){
-            if (current_node->used == 1 && current_node->allocated == 0
-                && current_node->alloc_record.size >= req_size){
-                alloc_node = current_node;
-                current_node = NULL;
-            }
-            else{
-                current_node = current_node->next;
-            }
-        }
+    if (pool_mgr->num_nodes != 0){
+        return _numa_new_alloc(pool_mgr, req_size, NULL);
     }
-    // if BEST_FIT, then find the first sufficient node in the gap index
-    if (pool->policy == BEST_FIT){
-        gap_pt gap_array = pool_mgr->gap_ix;
-        int i = 0;
-        while(alloc_node == NULL && i < pool_mgr->gap_ix_capacity){
-            if(gap_array[i].size >= req_size){
-                alloc_node = gap_array[i].node;
-                if(i < pool_mgr->gap_ix_capacity-1 && gap_array[i+1].size == alloc_node->alloc_record.size){
-                    node_pt current_node = pool_mgr->node_heap;
-                    while (current_node != NULL){
-                        if (current_node->used == 1 && current_node->allocated == 0
-                            && current_node->alloc_record.size == alloc_node->alloc_record.size){
-                            alloc_node = current_node;
-                            current_node = NULL;
-                        }
-                        else{
-                            current_node = current_node->next;
-                        }
-                    }
-                }
-            }
-            i++;
-        }
+    if (pool_mgr->num_shards != 0){
+        return _shard_new_alloc(pool_mgr, req_size, NULL);
+    }
+    if (pool_mgr->thread_cache){
+        return _cache_new_alloc(pool_mgr, req_size);
+    }
+    if (pool_mgr->lock_free){
+        return _slab_lf_new_alloc(pool_mgr, req_size);
     }
+    _mem_lock(pool_mgr);
+    alloc = _mem_new_alloc(pool_mgr, req_size);
+    _mem_unlock(pool_mgr);
 
+    return alloc;
+}
 
-    // if no node found there is not enough space so return null
-    if (alloc_node == NULL){
+alloc_pt mem_new_alloc_aligned(pool_pt pool, size_t size, size_t alignment) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_pt alloc;
+
+    // only the gaps of a node heap pool can be split at any offset, and
+    // pools that are not locked as a whole are not
+    if (pool_mgr->kind != POOL_NODE_HEAP || pool->policy == BUDDY || pool_mgr->num_shards != 0
+        || pool_mgr->num_nodes != 0 || size == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0){
         return NULL;
     }
-    //assert(alloc_node != NULL);
+    _mem_lock(pool_mgr);
+    alloc = _mem_new_alloc_aligned(pool_mgr, size, alignment);
+    _mem_unlock(pool_mgr);
 
-    // calculate the size of the remaining gap, if any
-    size_t new_gap_size = alloc_node->alloc_record.size - req_size;
+    return alloc;
+}
 
+alloc_status mem_del_alloc(pool_pt pool, alloc_pt del_alloc) {
+    // get mgr from pool by casting the pointer to (pool_mgr_pt)
+    pool_mgr_pt pool_mgr = (pool_mgr_pt)pool;
+    alloc_status status = ALLOC_FAIL;
 
-    // If req alloc is exactly the same size as gap simply convert
-    // to gap node to an alloc node and remove the gap index
-    if (new_gap_size == 0){
-        alloc_node->allocated = 1;
-        status = _mem_remove_from_gap_ix(pool_mgr, alloc_node->alloc_record.size, alloc_node);
-        assert(status != ALLOC_FAIL);
+    if (pool_mgr->num_nodes != 0){
+        return (del_alloc == NULL) ? ALLOC_FAIL : _numa_del_alloc(pool_mgr, del_alloc->mem);
     }
-    else{
-        // Find an unused node in heap
-        node_pt new_gap_node = NULL;
-        node_pt heap_array = pool_mgr->node_heap;
-        int i = 0;
-        while (i < pool_mgr->total_nodes){
-            if (heap_array[i].used == 0){
-                new_gap_node = &heap_array[i];
-                i = pool_mgr->total_nodes;
-            }
-            else{
-                i++;
-            }
-        }
+    if (pool_mgr->num_shards != 0){
+        return (del_alloc == NULL) ? ALLOC_FAIL : _shard_del_alloc(pool_mgr, del_alloc->mem);
+    }
+    if (pool_mgr->thread_cache){
+        return (del_alloc == NULL) ? ALLOC_FAIL : _cache_del_alloc(pool_mgr, del_alloc->mem);
+    }
+    if (pool_mgr->remote_free && !pthread_equal(pthread_self(), pool_mgr->owner)){
+        return (del_alloc == NULL) ? ALLOC_FAIL : _remote_push(pool_mgr, del_alloc->mem);
+    }
+    if (pool_mgr->lock_free){
+        return (del_alloc == NULL) ? ALLOC_FAIL : _slab_lf_del_alloc(pool_mgr, del_alloc->mem);
+    }
+    _mem_lock(pool_mgr);
+    if (del_alloc != NULL){
+        status = _mem_del_alloc(pool_mgr, del_alloc->mem);
+    }
+    _mem_unlock(pool_mgr);
 
-        assert(new_gap_node != NULL);
+    return status;
+}
 
-        // update alloc records for new alloc & remove old gap from gap index
-        alloc_node->allocated = 1;
-        alloc_node->alloc_record.size = req_size;
-        _mem_remove_from_gap_ix(pool_mgr, alloc_node->alloc_record.size, alloc_node);
-        // update alloc records for new gap & insert into gap index
-        new_gap_node->used = 1;
-        new_gap_node->alloc_record.mem = alloc_node->alloc_record.mem + req_size;
-        new_gap_node->alloc_record.size = new_gap_size;
-        _mem_add_to_gap_ix(pool_mgr, new_gap_size, new_gap_node);
+char *mem_new_alloc_addr(pool_pt pool, size_t size) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt)pool;
+    alloc_pt alloc;
+    char *mem;
 
-        //insert gap node into list
-        insert_node_heap(alloc_node, new_gap_node);
+    if (pool_mgr->num_nodes != 0){
+        _numa_new_alloc(pool_mgr, size, &mem);
+        return mem;
     }
-
-    // Update pool variables
-    if (new_gap_size > 0){
-        pool_mgr->used_nodes++;
+    if (pool_mgr->num_shards != 0){
+        _shard_new_alloc(pool_mgr, size, &mem);
+        return mem;
     }
-    pool->alloc_size += req_size;
-    pool->num_allocs++;
-
-    // adjust node heap:
-    //   if remaining gap, need a new node
-    //   find an unused one in the node heap
-    //   make sure one was found
-    //   initialize it to a gap node
-    //   update metadata (used_nodes)
-    //   update linked list (new node right after the node for allocation)
-    //   add to gap index
-    //   check if successful
-    // return allocation record by casting the node to (alloc_pt)
+    // cached and slab pools have no node heap, so their records stay put
+    if (pool_mgr->thread_cache){
+        alloc = _cache_new_alloc(pool_mgr, size);
+        return (alloc == NULL) ? NULL : alloc->mem;
+    }
+    if (pool_mgr->lock_free){
+        alloc = _slab_lf_new_alloc(pool_mgr, size);
+        return (alloc == NULL) ? NULL : alloc->mem;
+    }
+    // the allocation record is only read before the node heap can move again
+    _mem_lock(pool_mgr);
+    if (pool_mgr->kind == POOL_ARENA){
+        // an arena block only needs a record for mem_new_alloc
+        mem = _arena_new_block(pool_mgr, size, 0);
+    }
+    else{
+        alloc = _mem_new_alloc(pool_mgr, size);
+        mem = (alloc == NULL) ? NULL : alloc->mem;
+    }
+    _mem_unlock(pool_mgr);
 
-    return (alloc_pt)alloc_node;
+    return mem;
 }
 
-alloc_status mem_del_alloc(pool_pt pool, alloc_pt del_alloc) {
-    // get mgr from pool by casting the pointer to (pool_mgr_pt)
-    // get node from alloc by casting the pointer to (node_pt)
+alloc_status mem_del_alloc_addr(pool_pt pool, char *mem) {
     pool_mgr_pt pool_mgr = (pool_mgr_pt)pool;
-    node_pt del_node = (node_pt)del_alloc;
     alloc_status status;
-    // find the node in the node heap
-    node_pt c_node = pool_mgr->node_heap;
-    while (c_node != NULL && c_node->used == 1){
-        if (del_node->alloc_record.mem == c_node->alloc_record.mem){
-            del_node = c_node;
-            c_node = NULL;
-            status = ALLOC_OK;
-        }
-        else {
-            c_node = c_node->next;
-        }
-    }
-    assert(status == ALLOC_OK);
-    // this is node-to-delete
-    // make sure it's found
-    // convert to gap node
-
-    del_node->allocated = 0;
-    pool->alloc_size -= del_node->alloc_record.size;
-    pool->num_allocs--;
 
-    // update metadata (num_allocs, alloc_size)
+    if (pool_mgr->num_nodes != 0){
+        return _numa_del_alloc(pool_mgr, mem);
+    }
+    if (pool_mgr->num_shards != 0){
+        return _shard_del_alloc(pool_mgr, mem);
+    }
+    if (pool_mgr->thread_cache){
+        return _cache_del_alloc(pool_mgr, mem);
+    }
+    if (pool_mgr->remote_free && !pthread_equal(pthread_self(), pool_mgr->owner)){
+        return _remote_push(pool_mgr, mem);
+    }
+    if (pool_mgr->lock_free){
+        return _slab_lf_del_alloc(pool_mgr, mem);
+    }
+    _mem_lock(pool_mgr);
+    status = _mem_del_alloc(pool_mgr, mem);
+    _mem_unlock(pool_mgr);
 
+    return status;
+}
 
-    node_pt final_node = del_node;
-    _mem_add_to_gap_ix(pool_mgr, final_node->alloc_record.size, final_node);
+alloc_status mem_new_alloc_batch(pool_pt pool, const size_t sizes[], unsigned n, char *out[]) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_status status;
 
-    // if the next node in the list is also a gap, merge into final_node
-    if (del_node->next != NULL && del_node->next->used == 1 && del_node->next->allocated == 0){
-        final_node = merge_gaps(pool_mgr, del_node, del_node->next);
+    // pools that are not locked as a whole allocate one block at a time
+    if (pool_mgr->num_nodes != 0 || pool_mgr->num_shards != 0 || pool_mgr->thread_cache
+        || pool_mgr->lock_free){
+        for (unsigned i = 0; i < n; i++){
+            out[i] = mem_new_alloc_addr(pool, sizes[i]);
+            if (out[i] == NULL){
+                // all or nothing
+                for (unsigned j = 0; j < i; j++){
+                    mem_del_alloc_addr(pool, out[j]);
+                    out[j] = NULL;
+                }
+                return ALLOC_FAIL;
+            }
+        }
+        return ALLOC_OK;
     }
+    _mem_lock(pool_mgr);
+    status = _mem_new_alloc_batch(pool_mgr, sizes, n, out);
+    _mem_unlock(pool_mgr);
 
-    // if previous node in list is also gap merge the nodes
-    if (final_node->prev != NULL && final_node->prev->allocated == 0){
-        final_node = merge_gaps(pool_mgr, final_node->prev, final_node);
+    return status;
+}
+
+alloc_status mem_del_alloc_batch(pool_pt pool, char *mems[], unsigned n) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_status status = ALLOC_OK;
 
+    if (pool_mgr->num_nodes != 0 || pool_mgr->num_shards != 0 || pool_mgr->thread_cache
+        || pool_mgr->lock_free || (pool_mgr->remote_free && !pthread_equal(pthread_self(), pool_mgr->owner))){
+        for (unsigned i = 0; i < n; i++){
+            if (mem_del_alloc_addr(pool, mems[i]) != ALLOC_OK)
+                status = ALLOC_FAIL;
+        }
+        return status;
     }
+    _mem_lock(pool_mgr);
+    status = _mem_del_alloc_batch(pool_mgr, mems, n);
+    _mem_unlock(pool_mgr);
 
+    return status;
+}
 
-    // this merged node-to-delete might need to be added to the gap index
-    // but one more thing to check...
-    // if the previous node in the list is also a gap, merge into previous!
-    //   remove the previous node from gap index
-    //   check success
-    //   add the size of node-to-delete to the previous
-    //   update node-to-delete as unused
-    //   update metadata (used_nodes)
-    //   update linked list
-    /*
-                    if (node_to_del->next) {
-                        prev->next = node_to_del->next;
-                        node_to_del->next->prev = prev;
-                    } else {
-                        prev->next = NULL;
-                    }
-                    node_to_del->next = NULL;
-                    node_to_del->prev = NULL;
-     */
-    //   change the node to add to the previous node!
-    // add the resulting node to the gap index
-    // check success
+char *mem_realloc(pool_pt pool, char *mem, size_t size) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    char *new_mem;
 
-    return ALLOC_OK;
+    if (mem == NULL){
+        return mem_new_alloc_addr(pool, size);
+    }
+    // pools that are not locked as a whole cannot look at a block and its
+    // neighbours at once, and an empty request would leave nothing to return
+    if (pool_mgr->num_shards != 0 || pool_mgr->thread_cache || pool_mgr->lock_free || size == 0){
+        return NULL;
+    }
+    // a block of a NUMA-local pool stays on its node
+    if (pool_mgr->num_nodes != 0){
+        return _numa_realloc(pool_mgr, mem, size);
+    }
+    _mem_lock(pool_mgr);
+    new_mem = _mem_realloc(pool_mgr, mem, size);
+    _mem_unlock(pool_mgr);
+
+    return new_mem;
 }
 
 void mem_inspect_pool(pool_pt pool,
                       pool_segment_pt *segments,
                       unsigned *num_segments) {
-    // get the mgr from the pool
-    // allocate the segments array with size == used_nodes
-    // check successful
-    // loop through the node heap and the segments array
-    //    for each node, write the size and allocated in the segment
-    // "return" the values:
-    /*
-                    *segments = segs;
-                    *num_segments = pool_mgr->used_nodes;
-     */
-
     pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
-    pool_segment_pt segs = (pool_segment_pt) calloc(pool_mgr->used_nodes, sizeof(pool_segment_t));
-
-    node_pt current_node = pool_mgr->node_heap;
 
-    unsigned i = 0;
-    while (current_node != NULL && current_node->used == 1){
-        segs[i].size = current_node->alloc_record.size;
-        segs[i].allocated = current_node->allocated;
-        i++;
-        current_node = current_node->next;
+    if (pool_mgr->num_nodes != 0){
+        _numa_inspect_pool(pool_mgr, segments, num_segments);
+        return;
     }
-    //("%d\n", i);
-    //printf("%d\n", pool_mgr->used_nodes);
-    //assert(i == pool_mgr->used_nodes);
-    *segments = segs;
-    *num_segments = pool_mgr->used_nodes;
+    if (pool_mgr->num_shards != 0){
+        _shard_inspect_pool(pool_mgr, segments, num_segments);
+        return;
+    }
+    _mem_lock(pool_mgr);
+    _remote_drain(pool_mgr);
+    if (pool_mgr->kind == POOL_BOUNDARY_TAG){
+        _tag_inspect_pool(pool_mgr, segments, num_segments);
+    }
+    else if (pool_mgr->kind == POOL_SLAB){
+        _slab_inspect_pool(pool_mgr, segments, num_segments);
+    }
+    else if (pool_mgr->kind == POOL_ARENA){
+        _arena_inspect_pool(pool_mgr, segments, num_segments);
+    }
+    else{
+        _mem_inspect_node_heap(pool_mgr, segments, num_segments);
+    }
+    _mem_unlock(pool_mgr);
 }
 
+alloc_status mem_cache_flush(pool_pt pool) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    mem_cache_pt cache;
 
-
-/***********************************/
-/*                                 */
-/* Definitions of static functions */
-/*                                 */
-/***********************************/
-// Checks if pool size is within the capacity fill factor. If pool is too large its size
-// is expanded by the mem expand factor.
-static alloc_status _mem_resize_pool_store() {
-    // check if necessary
-    if (((float) pool_store_size / pool_store_capacity)
-        > MEM_POOL_STORE_FILL_FACTOR) {
-        pool_store = (pool_mgr_pt*) realloc(pool_store, (sizeof(pool_mgr_pt)*pool_store_capacity
-                                                         * MEM_EXPAND_FACTOR));
-        pool_store_capacity = pool_store_capacity*MEM_EXPAND_FACTOR;
+    if (pool_mgr == NULL || pool_mgr->thread_cache == 0){
+        return ALLOC_FAIL;
+    }
+    // the calling thread may not have a cache of this pool
+    cache = _cache_get(pool_mgr, 0);
+    if (cache != NULL){
+        _cache_release(cache);
     }
-    // don't forget to update capacity variables
     return ALLOC_OK;
 }
 
-static alloc_status _mem_resize_node_heap(pool_mgr_pt pool_mgr) {
-    if (((float)pool_mgr->used_nodes / pool_mgr->total_nodes) > MEM_NODE_HEAP_FILL_FACTOR){
-        node_pt new_node_heap = (node_pt) realloc(pool_mgr->node_heap,
-                                                (sizeof(node_t) * pool_mgr->total_nodes*MEM_NODE_HEAP_EXPAND_FACTOR));
-        if (new_node_heap != NULL) {
-            pool_mgr->total_nodes = pool_mgr->total_nodes * MEM_NODE_HEAP_EXPAND_FACTOR;
-            pool_mgr->node_heap = new_node_heap;
-            return ALLOC_OK;
-        }
+alloc_status mem_cache_stats(pool_pt pool, cache_stats_pt stats) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    mem_cache_pt cache;
+
+    if (pool_mgr == NULL || pool_mgr->thread_cache == 0 || stats == NULL){
+        return ALLOC_FAIL;
+    }
+    cache = _cache_get(pool_mgr, 0);
+    if (cache != NULL){
+        *stats = cache->stats;
+    }
+    else{
+        memset(stats, 0, sizeof(cache_stats_t));
+    }
+    return ALLOC_OK;
+}
+
+alloc_status mem_arena_mark(pool_pt pool, arena_mark_pt mark) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+
+    if (pool_mgr == NULL || pool_mgr->kind != POOL_ARENA || mark == NULL){
+        return ALLOC_FAIL;
+    }
+    _mem_lock(pool_mgr);
+    mark->top = pool_mgr->arena_top;
+    mark->alloc_size = pool->alloc_size;
+    mark->num_allocs = pool->num_allocs;
+    _mem_unlock(pool_mgr);
+
+    return ALLOC_OK;
+}
+
+alloc_status mem_arena_reset(pool_pt pool, const arena_mark_t *mark) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_status status;
+
+    if (pool_mgr == NULL || pool_mgr->kind != POOL_ARENA){
+        return ALLOC_FAIL;
+    }
+    _mem_lock(pool_mgr);
+    status = _arena_reset(pool_mgr, mark);
+    _mem_unlock(pool_mgr);
+
+    return status;
+}
+
+alloc_status mem_rss_stats(pool_pt pool, rss_stats_pt stats) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_status status = ALLOC_OK;
+    size_t size;
+
+    if (pool_mgr == NULL || stats == NULL){
+        return ALLOC_FAIL;
+    }
+    memset(stats, 0, sizeof(rss_stats_t));
+    // a NUMA-local pool adds up the pools of its nodes
+    for (unsigned i = 0; i < pool_mgr->num_nodes; i++){
+        rss_stats_t node_stats;
+
+        if (pool_mgr->nodes[i] == NULL)
+            continue;
+        if (mem_rss_stats((pool_pt) pool_mgr->nodes[i], &node_stats) != ALLOC_OK)
+            return ALLOC_FAIL;
+        stats->resident += node_stats.resident;
+        stats->decommitted += node_stats.decommitted;
+        stats->decommits += node_stats.decommits;
+    }
+    if (pool_mgr->num_nodes != 0){
+        return ALLOC_OK;
+    }
+    _mem_lock(pool_mgr);
+    // the total size of a growable pool includes the extents it has added
+    size = pool_mgr->pool.total_size;
+    for (unsigned i = 0; i < pool_mgr->num_extents; i++){
+        size -= pool_mgr->extents[i].size;
+        if (_mem_resident(pool_mgr->extents[i].mem, pool_mgr->extents[i].size, &stats->resident) != ALLOC_OK)
+            status = ALLOC_FAIL;
+    }
+    if (_mem_resident(pool_mgr->pool.mem, size, &stats->resident) != ALLOC_OK)
+        status = ALLOC_FAIL;
+    _mem_unlock(pool_mgr);
+    if (status != ALLOC_OK){
+        return ALLOC_FAIL;
+    }
+    // the arenas of a sharded pool count what they give back themselves
+    for (unsigned i = 0; i < pool_mgr->num_shards; i++){
+        pool_mgr_pt arena = pool_mgr->shards[i];
+
+        _mem_lock(arena);
+        stats->decommitted += arena->decommitted;
+        stats->decommits += arena->decommits;
+        _mem_unlock(arena);
+    }
+    _mem_lock(pool_mgr);
+    stats->decommitted += pool_mgr->decommitted;
+    stats->decommits += pool_mgr->decommits;
+    _mem_unlock(pool_mgr);
+
+    return ALLOC_OK;
+}
+
+
+alloc_status mem_pool_set_root(pool_pt pool, const char *mem) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_status status = ALLOC_OK;
+
+    if (pool_mgr == NULL || pool_mgr->file == NULL){
+        return ALLOC_FAIL;
+    }
+    _mem_lock(pool_mgr);
+    if (mem == NULL)
+        pool_mgr->file->root = MEM_TAG_NONE;
+    else if (_tag_find_alloc(pool_mgr, mem) != NULL)
+        pool_mgr->file->root = (size_t) (mem - pool->mem);
+    else
+        status = ALLOC_FAIL;
+    _mem_unlock(pool_mgr);
+
+    return status;
+}
+
+char *mem_pool_get_root(pool_pt pool) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    char *mem = NULL;
+
+    if (pool_mgr == NULL || pool_mgr->file == NULL){
+        return NULL;
+    }
+    _mem_lock(pool_mgr);
+    if (pool_mgr->file->root != MEM_TAG_NONE)
+        mem = pool->mem + pool_mgr->file->root;
+    _mem_unlock(pool_mgr);
+
+    return mem;
+}
+
+alloc_handle_t mem_new_handle(pool_pt pool, size_t size) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_handle_t handle;
+
+    if (pool_mgr == NULL || pool_mgr->handles == NULL){
+        return 0;
+    }
+    _mem_lock(pool_mgr);
+    handle = _handle_new_alloc(pool_mgr, size);
+    _mem_unlock(pool_mgr);
+
+    return handle;
+}
+
+alloc_status mem_del_handle(pool_pt pool, alloc_handle_t handle) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_status status;
+
+    if (pool_mgr == NULL || pool_mgr->handles == NULL){
+        return ALLOC_FAIL;
+    }
+    _mem_lock(pool_mgr);
+    status = _handle_del_alloc(pool_mgr, handle);
+    _mem_unlock(pool_mgr);
+
+    return status;
+}
+
+// the block stays at the address returned until it is unpinned as many times as it is pinned
+char *mem_pin(pool_pt pool, alloc_handle_t handle) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    char *mem = NULL;
+    node_pt node;
+
+    if (pool_mgr == NULL || pool_mgr->handles == NULL){
+        return NULL;
+    }
+    _mem_lock(pool_mgr);
+    node = _handle_find(pool_mgr, handle);
+    if (node != NULL){
+        node->pins++;
+        mem = node->alloc_record.mem;
+    }
+    _mem_unlock(pool_mgr);
+
+    return mem;
+}
+
+alloc_status mem_unpin(pool_pt pool, alloc_handle_t handle) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_status status = ALLOC_FAIL;
+    node_pt node;
+
+    if (pool_mgr == NULL || pool_mgr->handles == NULL){
+        return ALLOC_FAIL;
+    }
+    _mem_lock(pool_mgr);
+    node = _handle_find(pool_mgr, handle);
+    if (node != NULL && node->pins != 0){
+        node->pins--;
+        status = ALLOC_OK;
+    }
+    _mem_unlock(pool_mgr);
+
+    return status;
+}
+
+alloc_status mem_pool_compact(pool_pt pool) {
+    pool_mgr_pt pool_mgr = (pool_mgr_pt) pool;
+    alloc_status status;
+
+    if (pool_mgr == NULL || pool_mgr->handles == NULL){
+        return ALLOC_FAIL;
+    }
+    _mem_lock(pool_mgr);
+    status = _handle_compact(pool_mgr);
+    _mem_unlock(pool_mgr);
+
+    return status;
+}
+
+
+
+/***********************************/
+/*                                 */
+/* Definitions of static functions */
+/*                                 */
+/***********************************/
+// Allocates a pool mgr with its pool memory and segment metadata, and its lock
+// if it is thread-safe; it is not linked to the pool store. The options have
+// been checked. Returns null on failure.
+static pool_mgr_pt _mem_new_pool_mgr(size_t mem_pool_size, const pool_opts_t *opts) {
+    // allocate a new mem pool mgr
+    pool_mgr_pt new_pool_mgr = (pool_mgr_pt) calloc(1, sizeof(pool_mgr_t));
+    // check success, on error return null
+    // any other cases which would fail?
+    if (new_pool_mgr == NULL){
+        return NULL;
+    }
+
+    // initialize pool memory block, check success, on error deallocate mgr and return null
+    // (a file-backed pool maps its file below)
+    if (opts->path == NULL){
+        new_pool_mgr->pool.mem = _mem_alloc_extent(mem_pool_size, opts, &new_pool_mgr->map_size);
+        if (new_pool_mgr->pool.mem == NULL){
+            free(new_pool_mgr);
+            return NULL;
+        }
+    }
+
+    //   initialize pool mgr pool
+    new_pool_mgr->pool.total_size = mem_pool_size;
+    new_pool_mgr->pool.alloc_size = 0;
+    new_pool_mgr->pool.policy = opts->policy;
+    new_pool_mgr->pool.num_allocs = 0;
+    new_pool_mgr->pool.num_gaps = 0;
+    new_pool_mgr->kind = opts->kind;
+    new_pool_mgr->decommit = opts->decommit;
+    new_pool_mgr->opts = *opts;
+    new_pool_mgr->shared = opts->shared ? 1 : 0;
+    new_pool_mgr->remote_free = opts->remote_free ? 1 : 0;
+    new_pool_mgr->owner = pthread_self();
+
+    // set up the segment metadata, which makes the whole pool the first gap
+    alloc_status status;
+    switch (opts->kind){
+        case POOL_NODE_HEAP:
+            if (opts->shards > 1)
+                status = _shard_init_pool(new_pool_mgr, opts->shards);
+            else
+                status = _mem_init_node_heap(new_pool_mgr);
+            if (status == ALLOC_OK && opts->max_size != 0){
+                new_pool_mgr->extents = (extent_pt) calloc(MEM_MAX_EXTENTS, sizeof(extent_t));
+                new_pool_mgr->max_size = opts->max_size;
+                status = (new_pool_mgr->extents == NULL) ? ALLOC_FAIL : ALLOC_OK;
+            }
+            if (status == ALLOC_OK && opts->handles)
+                status = _handle_init_pool(new_pool_mgr);
+            break;
+        case POOL_BOUNDARY_TAG:
+            if (opts->path != NULL)
+                status = _file_open_pool(new_pool_mgr, opts->path);
+            else
+                status = _tag_init_pool(new_pool_mgr);
+            break;
+        case POOL_SLAB:
+            status = _slab_init_pool(new_pool_mgr, opts->obj_size);
+            if (status == ALLOC_OK && opts->lock_free)
+                status = _slab_lf_init_pool(new_pool_mgr);
+            break;
+        case POOL_ARENA:
+            status = _arena_init_pool(new_pool_mgr);
+            break;
+        default:
+            status = ALLOC_FAIL;
+            break;
+    }
+    if (status != ALLOC_OK){
+        _mem_free_pool_mem(new_pool_mgr);
+        free(new_pool_mgr);
+        return NULL;
+    }
+
+    // a thread-safe pool gets its own lock (the arenas of a sharded pool have
+    // theirs, and a shared pool uses the one in its file)
+    if (opts->thread_safe && new_pool_mgr->num_shards == 0 && !new_pool_mgr->shared){
+        if (pthread_mutex_init(&new_pool_mgr->lock, NULL) != 0){
+            _mem_free_pool_mgr(new_pool_mgr);
+            return NULL;
+        }
+        new_pool_mgr->thread_safe = 1;
+        new_pool_mgr->thread_cache = opts->thread_cache ? 1 : 0;
+        if (new_pool_mgr->thread_cache){
+            new_pool_mgr->cache_id = __atomic_add_fetch(&cache_ids, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    return new_pool_mgr;
+}
+
+// frees everything a pool mgr owns, and the mgr itself
+static void _mem_free_pool_mgr(pool_mgr_pt pool_mgr) {
+    _mem_free_pool_mem(pool_mgr);
+    free(pool_mgr->node_heap);
+    free(pool_mgr->addr_map);
+    free(pool_mgr->seg_ix);
+    if (pool_mgr->file == NULL)
+        free(pool_mgr->tag_ix); // a file-backed pool has its lists in the file
+    free(pool_mgr->slab_records);
+    free(pool_mgr->slab_next);
+    _shard_free(pool_mgr);
+    for (unsigned i = 0; i < pool_mgr->num_nodes; i++){
+        if (pool_mgr->nodes[i] != NULL)
+            _mem_free_pool_mgr(pool_mgr->nodes[i]);
+    }
+    free(pool_mgr->nodes);
+    free(pool_mgr->handles);
+    if (pool_mgr->thread_safe)
+        pthread_mutex_destroy(&pool_mgr->lock);
+    free(pool_mgr);
+}
+
+// Gets size bytes of pool memory from malloc (with *map_size 0), or maps them
+// if the options ask for mmap, huge pages, prefaulting, decommitting or a NUMA
+// node. Huge pages are asked for with madvise, which the kernel may ignore, on
+// a mapping aligned to MEM_HUGE_PAGE_SIZE. A prefaulted mapping is populated
+// by mmap, or, with huge pages or a node, touched after madvise and mbind, so
+// that it is faulted in as huge pages on the node. Returns null on failure.
+static char *_mem_alloc_extent(size_t size, const pool_opts_t *opts, size_t *map_size) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t align, lead, extra;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    int touch = 0;
+    char *mem;
+
+    *map_size = 0;
+    if (!opts->mmap && !opts->huge_pages && !opts->prefault && !opts->decommit && !opts->numa_bind){
+        return (char *) malloc(size);
+    }
+    align = opts->huge_pages ? MEM_HUGE_PAGE_SIZE : page;
+    if (size > SIZE_MAX - 2 * align){
+        return NULL;
+    }
+    size = (size == 0) ? align : (size + align - 1) & ~(align - 1);
+    if (opts->prefault){
+#ifdef MAP_POPULATE
+        if (opts->huge_pages || opts->numa_bind)
+            touch = 1;
         else
+            flags |= MAP_POPULATE;
+#else
+        touch = 1;
+#endif
+    }
+
+    // map enough to find an aligned range, and unmap the rest
+    extra = align - page;
+    mem = (char *) mmap(NULL, size + extra, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mem == MAP_FAILED){
+        return NULL;
+    }
+    lead = (align - (uintptr_t) mem % align) % align;
+    if (lead != 0)
+        munmap(mem, lead);
+    if (extra - lead != 0)
+        munmap(mem + lead + size, extra - lead);
+    mem += lead;
+
+    if (opts->numa_bind && _numa_bind(mem, size, opts->numa_node) != ALLOC_OK){
+        munmap(mem, size);
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (opts->huge_pages)
+        madvise(mem, size, MADV_HUGEPAGE);
+#endif
+    if (touch){
+        for (size_t offset = 0; offset < size; offset += page)
+            mem[offset] = 0;
+    }
+
+    *map_size = size;
+    return mem;
+}
+
+static void _mem_free_extent(char *mem, size_t map_size) {
+    if (map_size != 0)
+        munmap(mem, map_size);
+    else
+        free(mem);
+}
+
+// frees the pool memory, and the extents a growable pool has added to it
+// (or closes the file of a file-backed pool)
+static void _mem_free_pool_mem(pool_mgr_pt pool_mgr) {
+    if (pool_mgr->file != NULL){
+        _file_close_pool(pool_mgr);
+        return;
+    }
+    _mem_free_extent(pool_mgr->pool.mem, pool_mgr->map_size);
+    for (unsigned i = 0; i < pool_mgr->num_extents; i++)
+        _mem_free_extent(pool_mgr->extents[i].mem, pool_mgr->extents[i].map_size);
+    free(pool_mgr->extents);
+}
+
+// Gives the whole pages of [from, to) that lie in the gap [gap, gap_end) back
+// to the OS, if the gap is at least the decommit threshold. The pages read as
+// zeros afterwards, and are faulted back in when they are next written. The
+// callers pass the part of the gap that has not been given back before.
+static void _mem_decommit(pool_mgr_pt pool_mgr, char *gap, char *gap_end, char *from, char *to) {
+    uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t start, end;
+
+    if (pool_mgr->decommit == 0 || (size_t) (gap_end - gap) < pool_mgr->decommit){
+        return;
+    }
+    start = ((uintptr_t) gap + page - 1) & ~(page - 1);
+    if (start < ((uintptr_t) from & ~(page - 1)))
+        start = (uintptr_t) from & ~(page - 1);
+    end = (uintptr_t) gap_end & ~(page - 1);
+    if (end > (((uintptr_t) to + page - 1) & ~(page - 1)))
+        end = ((uintptr_t) to + page - 1) & ~(page - 1);
+    if (end > start && madvise((void *) start, end - start, MADV_DONTNEED) == 0){
+        pool_mgr->decommitted += end - start;
+        pool_mgr->decommits++;
+    }
+}
+
+// adds the bytes of the pages of [mem, mem + size) that are in RAM to *resident
+static alloc_status _mem_resident(const char *mem, size_t size, size_t *resident) {
+    uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) mem & ~(page - 1);
+    uintptr_t end = ((uintptr_t) mem + size + page - 1) & ~(page - 1);
+    size_t num_pages = (end - start) / page;
+    unsigned char *pages = (unsigned char *) malloc(num_pages + 1);
+
+    if (pages == NULL){
+        return ALLOC_FAIL;
+    }
+    if (num_pages != 0 && mincore((void *) start, end - start, pages) != 0){
+        free(pages);
+        return ALLOC_FAIL;
+    }
+    for (size_t i = 0; i < num_pages; i++){
+        if (pages[i] & 1)
+            *resident += page;
+    }
+    free(pages);
+
+    return ALLOC_OK;
+}
+
+// takes the lock of a thread-safe pool; a shared pool also picks up the
+// counters other processes have left in the file
+static void _mem_lock(pool_mgr_pt pool_mgr) {
+    if (pool_mgr->shared){
+        pthread_mutex_lock(&pool_mgr->file->lock);
+        pool_mgr->pool.alloc_size = pool_mgr->file->pool.alloc_size;
+        pool_mgr->pool.num_allocs = pool_mgr->file->pool.num_allocs;
+        pool_mgr->pool.num_gaps = pool_mgr->file->pool.num_gaps;
+    }
+    else if (pool_mgr->thread_safe)
+        pthread_mutex_lock(&pool_mgr->lock);
+}
+
+static void _mem_unlock(pool_mgr_pt pool_mgr) {
+    if (pool_mgr->shared){
+        pool_mgr->file->pool.alloc_size = pool_mgr->pool.alloc_size;
+        pool_mgr->file->pool.num_allocs = pool_mgr->pool.num_allocs;
+        pool_mgr->file->pool.num_gaps = pool_mgr->pool.num_gaps;
+        pthread_mutex_unlock(&pool_mgr->file->lock);
+    }
+    else if (pool_mgr->thread_safe)
+        pthread_mutex_unlock(&pool_mgr->lock);
+}
+
+// allocates req_size bytes from the pool as its kind and policy say
+static alloc_pt _mem_new_alloc(pool_mgr_pt pool_mgr, size_t req_size) {
+    pool_pt pool = (pool_pt) pool_mgr;
+
+    // carry out queued deallocations first; every block has to be able to
+    // hold the link of the queue
+    if (pool_mgr->remote_free){
+        _remote_drain(pool_mgr);
+        if (req_size != 0 && req_size < sizeof(char *))
+            req_size = sizeof(char *);
+    }
+    // check if any gaps, return null if none (or if the request is empty);
+    // a growable pool may still add an extent
+    if ((pool->num_gaps == 0 && pool_mgr->max_size == 0) || req_size == 0){
+        return NULL;
+    }
+    // boundary-tag pools hand out the record in the block header
+    if (pool_mgr->kind == POOL_BOUNDARY_TAG){
+        return (alloc_pt) _tag_new_alloc(pool_mgr, req_size);
+    }
+    if (pool_mgr->kind == POOL_SLAB){
+        return _slab_new_alloc(pool_mgr, req_size);
+    }
+    if (pool_mgr->kind == POOL_ARENA){
+        return _arena_new_alloc(pool_mgr, req_size);
+    }
+    // expand heap node and address map, if necessary, quit on error
+    alloc_status status =_mem_resize_node_heap(pool_mgr);
+    if (status != ALLOC_OK || _mem_resize_addr_map(pool_mgr) != ALLOC_OK){
+        return NULL;
+    }
+    // a buddy pool splits a block down to the power of two that holds the request
+    if (pool->policy == BUDDY){
+        return (alloc_pt) _mem_new_buddy(pool_mgr, req_size);
+    }
+
+    // Find a large enough node for allocation:
+    // if FIRST_FIT, then find the topmost sufficient gap in the gap index
+    // if NEXT_FIT, then find the first sufficient gap at or after the rover,
+    // wrapping around to the top of the pool
+    // if BEST_FIT, then find the smallest sufficient gap in the gap index
+    // (ties are broken by address, so this is also the topmost such gap)
+    // if SEGREGATED_FIT, then take the first gap of the smallest non-empty
+    // size class that is guaranteed to fit
+    node_pt alloc_node = _mem_find_gap_ix(pool_mgr, req_size);
+
+    // a growable pool adds an extent, in which the gap is found
+    if (alloc_node == NULL && pool_mgr->max_size != 0 && _mem_grow(pool_mgr, req_size) == ALLOC_OK){
+        alloc_node = _mem_find_gap_ix(pool_mgr, req_size);
+    }
+
+    // if no node found there is not enough space so return null
+    if (alloc_node == NULL){
+        return NULL;
+    }
+    //assert(alloc_node != NULL);
+
+    return _mem_alloc_in_gap(pool_mgr, alloc_node, 0, req_size);
+}
+
+// allocates req_size bytes (at least one) at a multiple of alignment (a power
+// of two) in a node heap pool other than BUDDY; the caller has checked both
+static alloc_pt _mem_new_alloc_aligned(pool_mgr_pt pool_mgr, size_t req_size, size_t alignment) {
+    node_pt alloc_node;
+    unsigned budget;
+
+    if (pool_mgr->remote_free){
+        _remote_drain(pool_mgr);
+        if (req_size < sizeof(char *))
+            req_size = sizeof(char *);
+    }
+    if (req_size > SIZE_MAX - alignment){
+        return NULL;
+    }
+    // the pad in front and the rest behind may each take a node (and so may
+    // the gap of an extent)
+    if (_mem_reserve_nodes(pool_mgr, 3) != ALLOC_OK){
+        return NULL;
+    }
+    // the trees of FIRST_FIT (and NEXT_FIT) and BEST_FIT are walked in order,
+    // which finds the topmost or the smallest gap that holds the block once it
+    // is aligned; if that takes too long, or for SEGREGATED_FIT, the gap is
+    // the one the policy finds among those that hold the request and the
+    // largest pad
+    budget = MEM_ALIGNED_SCAN;
+    alloc_node = (pool_mgr->seg_ix != NULL) ? NULL
+                                            : _gap_find_aligned(pool_mgr->gap_ix, req_size, alignment, &budget);
+    if (alloc_node == NULL)
+        alloc_node = _mem_find_gap_ix(pool_mgr, req_size + alignment - 1);
+    if (alloc_node == NULL && pool_mgr->max_size != 0
+        && _mem_grow(pool_mgr, req_size + alignment - 1) == ALLOC_OK){
+        alloc_node = _mem_find_gap_ix(pool_mgr, req_size + alignment - 1);
+    }
+    if (alloc_node == NULL){
+        return NULL;
+    }
+
+    return _mem_alloc_in_gap(pool_mgr, alloc_node,
+                             (size_t) (-(uintptr_t) alloc_node->alloc_record.mem) & (alignment - 1),
+                             req_size);
+}
+
+// Allocates req_size bytes at offset pad in a gap of a node heap pool that
+// holds them. A pad is left as a gap of its own in front of the allocation,
+// and the rest of the gap, if any, as one behind it; the node heap has room
+// for both.
+static alloc_pt _mem_alloc_in_gap(pool_mgr_pt pool_mgr, node_pt alloc_node, size_t pad, size_t req_size) {
+    pool_pt pool = (pool_pt) pool_mgr;
+    alloc_status status;
+
+    // remove the gap from the gap index (while its key is intact)
+    status = _mem_remove_from_gap_ix(pool_mgr, alloc_node->alloc_record.size, alloc_node);
+    assert(status != ALLOC_FAIL);
+
+    // the pad stays in the gap, and the allocation goes into a new node after it
+    if (pad != 0){
+        node_pt pad_node = alloc_node;
+
+        alloc_node = _mem_acquire_node(pool_mgr);
+        assert(alloc_node != NULL);
+        alloc_node->alloc_record.mem = pad_node->alloc_record.mem + pad;
+        alloc_node->alloc_record.size = pad_node->alloc_record.size - pad;
+        pad_node->alloc_record.size = pad;
+        _mem_add_to_gap_ix(pool_mgr, pad, pad_node);
+        insert_node_heap(pad_node, alloc_node);
+    }
+
+    // calculate the size of the remaining gap, if any
+    size_t new_gap_size = alloc_node->alloc_record.size - req_size;
+
+
+    // If req alloc is exactly the same size as gap simply convert
+    // to gap node to an alloc node
+    if (new_gap_size == 0){
+        alloc_node->allocated = 1;
+    }
+    else{
+        // Take an unused node off the free node stack
+        node_pt new_gap_node = _mem_acquire_node(pool_mgr);
+
+        assert(new_gap_node != NULL);
+
+        // update alloc records for new alloc
+        alloc_node->allocated = 1;
+        alloc_node->alloc_record.size = req_size;
+        // update alloc records for new gap & insert into gap index
+        new_gap_node->alloc_record.mem = alloc_node->alloc_record.mem + req_size;
+        new_gap_node->alloc_record.size = new_gap_size;
+        _mem_add_to_gap_ix(pool_mgr, new_gap_size, new_gap_node);
+
+        //insert gap node into list
+        insert_node_heap(alloc_node, new_gap_node);
+    }
+
+    // Update pool variables
+    pool->alloc_size += req_size;
+    pool->num_allocs++;
+    _mem_add_to_addr_map(pool_mgr, alloc_node);
+
+    // the next search resumes right after the allocation
+    if (pool->policy == NEXT_FIT){
+        pool_mgr->rover = alloc_node->next;
+    }
+
+    // adjust node heap:
+    //   if remaining gap, need a new node
+    //   find an unused one in the node heap
+    //   make sure one was found
+    //   initialize it to a gap node
+    //   update metadata (used_nodes)
+    //   update linked list (new node right after the node for allocation)
+    //   add to gap index
+    //   check if successful
+    // return allocation record by casting the node to (alloc_pt)
+
+    return (alloc_pt)alloc_node;
+}
+
+// deallocates the allocation starting at mem, if there is one
+static alloc_status _mem_del_alloc(pool_mgr_pt pool_mgr, const char *mem) {
+    if (pool_mgr->kind == POOL_BOUNDARY_TAG){
+        return _tag_del_alloc(pool_mgr, _tag_find_alloc(pool_mgr, mem));
+    }
+    if (pool_mgr->kind == POOL_SLAB){
+        return _slab_del_alloc(pool_mgr, _slab_find_alloc(pool_mgr, mem));
+    }
+    if (pool_mgr->kind == POOL_ARENA){
+        return _arena_del_alloc(pool_mgr, mem);
+    }
+    // find the node in the address map (this also rejects foreign or stale records)
+    if (pool_mgr->pool.policy == BUDDY){
+        return _mem_del_buddy(pool_mgr, _mem_find_addr_map(pool_mgr, mem));
+    }
+    return _mem_del_node(pool_mgr, _mem_find_addr_map(pool_mgr, mem));
+}
+
+// allocates a block for each of the sizes, or none of them
+static alloc_status _mem_new_alloc_batch(pool_mgr_pt pool_mgr, const size_t sizes[], unsigned n, char *out[]) {
+    arena_mark_t mark = { pool_mgr->arena_top, pool_mgr->pool.alloc_size, pool_mgr->pool.num_allocs };
+    alloc_pt alloc;
+    unsigned i;
+
+    // a node heap pool makes room for the whole batch at once, so that the
+    // node heap and the address map are not resized halfway through it
+    if (pool_mgr->kind == POOL_NODE_HEAP && _mem_reserve_nodes(pool_mgr, n) != ALLOC_OK){
+        return ALLOC_FAIL;
+    }
+    for (i = 0; i < n; i++){
+        alloc = _mem_new_alloc(pool_mgr, sizes[i]);
+        if (alloc == NULL){
+            break;
+        }
+        out[i] = alloc->mem;
+    }
+    if (i == n){
+        return ALLOC_OK;
+    }
+    // arena blocks are only released by a reset
+    if (pool_mgr->kind == POOL_ARENA)
+        _arena_reset(pool_mgr, &mark);
+    else
+        _mem_del_alloc_batch(pool_mgr, out, i);
+    for (unsigned j = 0; j < n; j++){
+        out[j] = NULL;
+    }
+    return ALLOC_FAIL;
+}
+
+// Deallocates a batch of allocations. In a node heap pool (other than a buddy
+// pool) the nodes are first all turned into gaps that are not in the gap index
+// yet (gap_height 0, where a gap in the index has at least 1), and then each
+// run of adjacent gaps is coalesced in a single sweep along the node list, so
+// that it goes into the gap index once, instead of every node being added and
+// merged on its own.
+static alloc_status _mem_del_alloc_batch(pool_mgr_pt pool_mgr, char *mems[], unsigned n) {
+    pool_pt pool = (pool_pt) pool_mgr;
+    alloc_status status = ALLOC_OK;
+    node_pt *nodes = NULL;
+    unsigned num_nodes = 0;
+
+    if (pool_mgr->kind == POOL_NODE_HEAP && pool->policy != BUDDY && n > 1){
+        nodes = (node_pt *) malloc(n * sizeof(node_pt));
+    }
+    // other pools (or no memory for the node list) deallocate one block at a time
+    if (nodes == NULL){
+        for (unsigned i = 0; i < n; i++){
+            if (_mem_del_alloc(pool_mgr, mems[i]) != ALLOC_OK)
+                status = ALLOC_FAIL;
+        }
+        return status;
+    }
+
+    // a block named twice is only found the first time
+    for (unsigned i = 0; i < n; i++){
+        node_pt node = _mem_find_addr_map(pool_mgr, mems[i]);
+
+        if (node == NULL){
+            status = ALLOC_FAIL;
+            continue;
+        }
+        _mem_remove_from_addr_map(pool_mgr, node);
+        node->allocated = 0;
+        node->gap_height = 0;
+        pool->alloc_size -= node->alloc_record.size;
+        pool->num_allocs--;
+        nodes[num_nodes++] = node;
+    }
+
+    for (unsigned i = 0; i < num_nodes; i++){
+        node_pt gap = nodes[i];
+
+        // skip the nodes that an earlier run has absorbed (and released), or started
+        if (gap->used == 0 || gap->gap_height != 0){
+            continue;
+        }
+        // back up to the first gap of the run (which ends at the start of an extent)
+        while (gap->extent == 0 && gap->prev != NULL && gap->prev->allocated == 0){
+            gap = gap->prev;
+        }
+        // the part of the run that may still have its pages (see _mem_del_node)
+        char *from = NULL, *to = NULL;
+        for (node_pt piece = gap; pool_mgr->decommit != 0 && piece != NULL && piece->allocated == 0
+                                  && (piece == gap || piece->extent == 0);
+             piece = piece->next){
+            if (piece->gap_height == 0 || piece->alloc_record.size < pool_mgr->decommit){
+                if (from == NULL)
+                    from = piece->alloc_record.mem;
+                to = piece->alloc_record.mem + piece->alloc_record.size;
+            }
+        }
+        if (gap->gap_height != 0){
+            _mem_remove_from_gap_ix(pool_mgr, gap->alloc_record.size, gap);
+        }
+        while (gap->next != NULL && gap->next->allocated == 0 && gap->next->extent == 0){
+            if (gap->next->gap_height != 0){
+                _mem_remove_from_gap_ix(pool_mgr, gap->next->alloc_record.size, gap->next);
+            }
+            _mem_absorb_node(pool_mgr, gap, gap->next);
+        }
+        _mem_add_to_gap_ix(pool_mgr, gap->alloc_record.size, gap);
+        if (_mem_shrink(pool_mgr, gap) == ALLOC_OK){
+            continue;
+        }
+        if (from != NULL){
+            _mem_decommit(pool_mgr, gap->alloc_record.mem,
+                          gap->alloc_record.mem + gap->alloc_record.size, from, to);
+        }
+    }
+    free(nodes);
+
+    return status;
+}
+
+// Resizes the allocation at mem to size bytes and returns its address. The
+// block stays where it is if it can hold size bytes: a node heap or
+// boundary-tag allocation shrinks into, or grows into, the gap that follows
+// it, a buddy or slab block has to be large enough already. Otherwise the
+// contents move to a new block and the old one is deallocated. Returns null,
+// and leaves the allocation as it was, if mem is not an allocation or there
+// is no room.
+static char *_mem_realloc(pool_mgr_pt pool_mgr, char *mem, size_t size) {
+    pool_pt pool = (pool_pt) pool_mgr;
+    size_t old_size;
+    char *new_mem;
+
+    if (pool_mgr->remote_free){
+        _remote_drain(pool_mgr);
+        if (size < sizeof(char *))
+            size = sizeof(char *);
+    }
+    if (pool_mgr->kind == POOL_BOUNDARY_TAG){
+        tag_pt tag = _tag_find_alloc(pool_mgr, mem);
+
+        if (tag == NULL){
+            return NULL;
+        }
+        old_size = tag->alloc_record.size;
+        if (_tag_resize_alloc(pool_mgr, tag, size) == ALLOC_OK){
+            return mem;
+        }
+    }
+    else if (pool_mgr->kind == POOL_SLAB){
+        alloc_pt record = _slab_find_alloc(pool_mgr, mem);
+
+        if (record == NULL){
+            return NULL;
+        }
+        old_size = record->size;
+        if (size <= pool_mgr->slab_size){
+            record->size = size;
+            pool->alloc_size = pool->alloc_size - old_size + size;
+            return mem;
+        }
+    }
+    else if (pool_mgr->kind == POOL_ARENA){
+        // the block size is not kept, so copy up to the top of the arena
+        if (mem < pool->mem || mem >= pool->mem + pool_mgr->arena_top){
+            return NULL;
+        }
+        old_size = pool_mgr->arena_top - (size_t) (mem - pool->mem);
+        new_mem = _arena_new_block(pool_mgr, size, 0);
+        if (new_mem != NULL){
+            memcpy(new_mem, mem, (size < old_size) ? size : old_size);
+        }
+        return new_mem;
+    }
+    else{
+        // a shrink may take a node for the tail, so resize before finding the node
+        if (_mem_resize_node_heap(pool_mgr) != ALLOC_OK){
+            return NULL;
+        }
+        node_pt node = _mem_find_addr_map(pool_mgr, mem);
+
+        if (node == NULL){
+            return NULL;
+        }
+        old_size = node->alloc_record.size;
+        // a buddy block is never split or joined in place
+        if (pool->policy == BUDDY){
+            if (size <= old_size)
+                return mem;
+        }
+        else if (_mem_resize_node(pool_mgr, node, size) == ALLOC_OK){
+            return mem;
+        }
+    }
+
+    // move the contents, which may resize the node heap
+    alloc_pt alloc = _mem_new_alloc(pool_mgr, size);
+
+    if (alloc == NULL){
+        return NULL;
+    }
+    new_mem = alloc->mem;
+    memcpy(new_mem, mem, (size < old_size) ? size : old_size);
+    _mem_del_alloc(pool_mgr, mem);
+
+    return new_mem;
+}
+
+static void _mem_inspect_node_heap(pool_mgr_pt pool_mgr,
+                                   pool_segment_pt *segments,
+                                   unsigned *num_segments) {
+    // get the mgr from the pool
+    // allocate the segments array with size == used_nodes
+    // check successful
+    // loop through the node heap and the segments array
+    //    for each node, write the size and allocated in the segment
+    // "return" the values:
+    /*
+                    *segments = segs;
+                    *num_segments = pool_mgr->used_nodes;
+     */
+
+    pool_segment_pt segs = (pool_segment_pt) calloc(pool_mgr->used_nodes, sizeof(pool_segment_t));
+
+    node_pt current_node = pool_mgr->node_heap;
+
+    unsigned i = 0;
+    while (current_node != NULL && current_node->used == 1){
+        segs[i].size = current_node->alloc_record.size;
+        segs[i].allocated = current_node->allocated;
+        i++;
+        current_node = current_node->next;
+    }
+    //("%d\n", i);
+    //printf("%d\n", pool_mgr->used_nodes);
+    //assert(i == pool_mgr->used_nodes);
+    *segments = segs;
+    *num_segments = pool_mgr->used_nodes;
+}
+
+// Checks if pool size is within the capacity fill factor. If pool is too large its size
+// is expanded by the mem expand factor.
+static alloc_status _mem_resize_pool_store() {
+    // check if necessary
+    if (((float) pool_store_size / pool_store_capacity)
+        > MEM_POOL_STORE_FILL_FACTOR) {
+        pool_mgr_pt *new_pool_store = (pool_mgr_pt*) realloc(pool_store, (sizeof(pool_mgr_pt)*pool_store_capacity
+                                                         * MEM_POOL_STORE_EXPAND_FACTOR));
+        if (new_pool_store == NULL)
+            return ALLOC_FAIL;
+        pool_store = new_pool_store;
+        pool_store_capacity = pool_store_capacity*MEM_POOL_STORE_EXPAND_FACTOR;
+    }
+    // don't forget to update capacity variables
+    return ALLOC_OK;
+}
+
+// Allocates the node heap, the address map and, for SEGREGATED_FIT, the size
+// class lists of a new pool, and makes the whole pool memory its first gap.
+static alloc_status _mem_init_node_heap(pool_mgr_pt pool_mgr) {
+    size_t mem_pool_size = pool_mgr->pool.total_size;
+
+    // allocate a new node heap
+    node_pt new_node_heap = (node_pt) calloc(MEM_NODE_HEAP_INIT_CAPACITY, sizeof(node_t));
+
+    // check success, on error deallocate what has been allocated so far
+    if (new_node_heap == NULL){
+        return ALLOC_FAIL;
+    }
+
+    // allocate a new address map (all slots empty)
+    unsigned *new_addr_map = (unsigned *) malloc(MEM_ADDR_MAP_INIT_CAPACITY * sizeof(unsigned));
+    if (new_addr_map == NULL){
+        free(new_node_heap);
+        return ALLOC_FAIL;
+    }
+    memset(new_addr_map, 0xff, MEM_ADDR_MAP_INIT_CAPACITY * sizeof(unsigned));
+
+    // allocate the segregated free lists, if that is the gap index for the policy
+    // (every power of two is a size class of its own, so they are the buddy lists too)
+    seg_ix_pt new_seg_ix = NULL;
+    if (pool_mgr->pool.policy == SEGREGATED_FIT || pool_mgr->pool.policy == BUDDY){
+        new_seg_ix = (seg_ix_pt) calloc(1, sizeof(seg_ix_t));
+        if (new_seg_ix == NULL){
+            free(new_addr_map);
+            free(new_node_heap);
+            return ALLOC_FAIL;
+        }
+    }
+
+    // assign all the pointers and update meta data:
+    //   initialize top node of node heap
+    new_node_heap[0].alloc_record.size = mem_pool_size;
+    new_node_heap[0].alloc_record.mem = pool_mgr->pool.mem;
+    new_node_heap[0].used = 1;
+    new_node_heap[0].allocated = 0;
+    new_node_heap[0].next = NULL;
+    new_node_heap[0].prev = NULL;
+
+    // initialize pool mgr
+    pool_mgr->node_heap = new_node_heap;
+    pool_mgr->total_nodes = MEM_NODE_HEAP_INIT_CAPACITY;
+    pool_mgr->used_nodes = 1;
+    pool_mgr->free_nodes = NULL;
+    _mem_release_nodes(pool_mgr, 1, MEM_NODE_HEAP_INIT_CAPACITY);
+    pool_mgr->addr_map = new_addr_map;
+    pool_mgr->addr_map_capacity = MEM_ADDR_MAP_INIT_CAPACITY;
+    pool_mgr->gap_ix = NULL;
+    pool_mgr->seg_ix = new_seg_ix;
+
+    //   the whole pool is the first gap
+    _mem_add_to_gap_ix(pool_mgr, mem_pool_size, new_node_heap);
+
+    // which a buddy pool cuts into power-of-two blocks
+    if (pool_mgr->pool.policy == BUDDY && _mem_init_buddy(pool_mgr) != ALLOC_OK){
+        free(pool_mgr->seg_ix);
+        free(pool_mgr->addr_map);
+        free(pool_mgr->node_heap);
+        return ALLOC_FAIL;
+    }
+    return ALLOC_OK;
+}
+
+// Expands the node heap when it is past its fill factor.
+static alloc_status _mem_resize_node_heap(pool_mgr_pt pool_mgr) {
+    if (((float)pool_mgr->used_nodes / pool_mgr->total_nodes) > MEM_NODE_HEAP_FILL_FACTOR){
+        return _mem_expand_node_heap(pool_mgr);
+    }
+    return ALLOC_OK;
+}
+
+// Makes room for count more allocations in the node heap and the address map,
+// so that neither has to be resized while they are made.
+static alloc_status _mem_reserve_nodes(pool_mgr_pt pool_mgr, unsigned count) {
+    while (((float) pool_mgr->used_nodes + count) / pool_mgr->total_nodes > MEM_NODE_HEAP_FILL_FACTOR){
+        if (_mem_expand_node_heap(pool_mgr) != ALLOC_OK)
+            return ALLOC_FAIL;
+    }
+    while (((float) pool_mgr->pool.num_allocs + count + 1) / pool_mgr->addr_map_capacity
+           > MEM_ADDR_MAP_FILL_FACTOR){
+        if (_mem_expand_addr_map(pool_mgr) != ALLOC_OK)
+            return ALLOC_FAIL;
+    }
+    return ALLOC_OK;
+}
+
+// Expands the node heap by its expand factor. Since realloc may move the heap,
+// all node pointers held by the list, the gap index and the mgr are rebased.
+static alloc_status _mem_expand_node_heap(pool_mgr_pt pool_mgr) {
+    uintptr_t old_base = (uintptr_t) pool_mgr->node_heap;
+    unsigned new_total = pool_mgr->total_nodes * MEM_NODE_HEAP_EXPAND_FACTOR;
+    node_pt new_node_heap = (node_pt) realloc(pool_mgr->node_heap,
+                                            (sizeof(node_t) * new_total));
+    if (new_node_heap == NULL)
+        return ALLOC_FAIL;
+
+    memset(new_node_heap + pool_mgr->total_nodes, 0,
+           sizeof(node_t) * (new_total - pool_mgr->total_nodes));
+    pool_mgr->node_heap = new_node_heap;
+    _mem_rebase_node_heap(pool_mgr, old_base);
+    _mem_release_nodes(pool_mgr, pool_mgr->total_nodes, new_total);
+    pool_mgr->total_nodes = new_total;
+    return ALLOC_OK;
+}
+
+// re-points a node pointer that referred into the heap previously located at old_base
+static node_pt _mem_rebase_node(node_pt node, uintptr_t old_base, node_pt new_base) {
+    if (node == NULL)
+        return NULL;
+    return new_base + (((uintptr_t) node - old_base) / sizeof(node_t));
+}
+
+static void _mem_rebase_node_heap(pool_mgr_pt pool_mgr, uintptr_t old_base) {
+    node_pt heap = pool_mgr->node_heap;
+
+    if ((uintptr_t) heap == old_base)
+        return;
+
+    for (unsigned i = 0; i < pool_mgr->total_nodes; i++){
+        heap[i].next = _mem_rebase_node(heap[i].next, old_base, heap);
+        heap[i].prev = _mem_rebase_node(heap[i].prev, old_base, heap);
+        heap[i].gap_left = _mem_rebase_node(heap[i].gap_left, old_base, heap);
+        heap[i].gap_right = _mem_rebase_node(heap[i].gap_right, old_base, heap);
+    }
+    pool_mgr->free_nodes = _mem_rebase_node(pool_mgr->free_nodes, old_base, heap);
+    pool_mgr->gap_ix = _mem_rebase_node(pool_mgr->gap_ix, old_base, heap);
+    pool_mgr->rover = _mem_rebase_node(pool_mgr->rover, old_base, heap);
+    if (pool_mgr->seg_ix != NULL){
+        for (unsigned fl = 0; fl < MEM_SEG_FL_COUNT; fl++){
+            for (unsigned sl = 0; sl < MEM_SEG_SL_COUNT; sl++){
+                pool_mgr->seg_ix->heads[fl][sl] =
+                        _mem_rebase_node(pool_mgr->seg_ix->heads[fl][sl], old_base, heap);
+            }
+        }
+    }
+}
+
+// pushes the (zeroed) nodes first..last-1 of the heap onto the free node stack,
+// so that the lowest of them comes off first
+static void _mem_release_nodes(pool_mgr_pt pool_mgr, unsigned first, unsigned last) {
+    for (unsigned i = last; i > first; i--){
+        pool_mgr->node_heap[i - 1].next = pool_mgr->free_nodes;
+        pool_mgr->free_nodes = &pool_mgr->node_heap[i - 1];
+    }
+}
+
+// pops an unused node off the free node stack and marks it used
+static node_pt _mem_acquire_node(pool_mgr_pt pool_mgr) {
+    node_pt node = pool_mgr->free_nodes;
+
+    if (node == NULL)
+        return NULL;
+    pool_mgr->free_nodes = node->next;
+    node->next = NULL;
+    node->used = 1;
+    pool_mgr->used_nodes++;
+    return node;
+}
+
+// clears a node that has been unlinked from the list and pushes it onto the free node stack
+static void _mem_release_node(pool_mgr_pt pool_mgr, node_pt node) {
+    memset(node, 0, sizeof(node_t));
+    node->next = pool_mgr->free_nodes;
+    pool_mgr->free_nodes = node;
+    pool_mgr->used_nodes--;
+}
+
+static alloc_status _mem_add_to_gap_ix(pool_mgr_pt pool_mgr,
+                                       size_t size,
+                                       node_pt node) {
+    // the tree is keyed on the node's own record, so it has to match
+    assert(node->alloc_record.size == size);
+
+    node->gap_left = NULL;
+    node->gap_right = NULL;
+    node->gap_height = 1;
+    node->gap_max = size;
+    if (pool_mgr->seg_ix != NULL)
+        _seg_insert(pool_mgr->seg_ix, node);
+    else
+        pool_mgr->gap_ix = _gap_insert(pool_mgr->gap_ix, node, pool_mgr->pool.policy);
+
+    // update metadata (num_gaps)
+    ((pool_pt) pool_mgr)->num_gaps++;
+
+    return ALLOC_OK;
+}
+
+// note: the gap must be removed before its size is changed, since the size is its key
+static alloc_status _mem_remove_from_gap_ix(pool_mgr_pt pool_mgr,
+                                            size_t size,
+                                            node_pt alloc_node) {
+    int found = 0;
+
+    assert(alloc_node->alloc_record.size == size);
+
+    if (pool_mgr->seg_ix != NULL){
+        // the lists are unlinked in place, so only a gap can be removed
+        if (alloc_node->used == 1 && alloc_node->allocated == 0){
+            _seg_remove(pool_mgr->seg_ix, alloc_node);
+            found = 1;
+        }
+    }
+    else
+        pool_mgr->gap_ix = _gap_remove(pool_mgr->gap_ix, alloc_node, &found, pool_mgr->pool.policy);
+    if (found == 1) {
+        ((pool_pt) pool_mgr)->num_gaps--;
+        return ALLOC_OK;
+    }
+    else
+        return ALLOC_FAIL;
+}
+
+// returns the gap of at least size bytes that the pool's policy picks, or null
+// if there is none: the topmost one for FIRST_FIT, the topmost one at or after
+// the rover (else the topmost one) for NEXT_FIT, the smallest one (topmost on
+// ties) for BEST_FIT, one from the smallest suitable class for SEGREGATED_FIT
+static node_pt _mem_find_gap_ix(pool_mgr_pt pool_mgr, size_t size) {
+    node_pt best = NULL;
+    node_pt current = pool_mgr->gap_ix;
+
+    if (pool_mgr->seg_ix != NULL)
+        return _seg_find(pool_mgr->seg_ix, size);
+
+    if (pool_mgr->pool.policy == FIRST_FIT){
+        // descend towards the lowest address, guided by the subtree maxima
+        while (current != NULL){
+            if (current->gap_left != NULL && current->gap_left->gap_max >= size)
+                current = current->gap_left;
+            else if (current->alloc_record.size >= size)
+                return current;
+            else if (current->gap_right != NULL && current->gap_right->gap_max >= size)
+                current = current->gap_right;
+            else
+                return NULL;
+        }
+        return NULL;
+    }
+
+    if (pool_mgr->pool.policy == NEXT_FIT){
+        if (pool_mgr->rover != NULL){
+            best = _gap_find_first(current, pool_mgr->rover->alloc_record.mem, size);
+            if (best != NULL)
+                return best;
+        }
+        return _gap_find_first(current, pool_mgr->pool.mem, size);
+    }
+
+    while (current != NULL){
+        if (current->alloc_record.size >= size){
+            best = current;
+            current = current->gap_left;
+        }
+        else{
+            current = current->gap_right;
+        }
+    }
+    return best;
+}
+
+// Expands the address map when it is past its fill factor.
+static alloc_status _mem_resize_addr_map(pool_mgr_pt pool_mgr) {
+    if (((float) (pool_mgr->pool.num_allocs + 1) / pool_mgr->addr_map_capacity)
+        > MEM_ADDR_MAP_FILL_FACTOR) {
+        return _mem_expand_addr_map(pool_mgr);
+    }
+    return ALLOC_OK;
+}
+
+// Expands the address map by its expand factor, rehashing every entry.
+static alloc_status _mem_expand_addr_map(pool_mgr_pt pool_mgr) {
+    unsigned *old_map = pool_mgr->addr_map;
+    unsigned old_capacity = pool_mgr->addr_map_capacity;
+    unsigned new_capacity = old_capacity * MEM_ADDR_MAP_EXPAND_FACTOR;
+    unsigned *new_map = (unsigned *) malloc(new_capacity * sizeof(unsigned));
+
+    if (new_map == NULL)
+        return ALLOC_FAIL;
+    memset(new_map, 0xff, new_capacity * sizeof(unsigned));
+    pool_mgr->addr_map = new_map;
+    pool_mgr->addr_map_capacity = new_capacity;
+    for (unsigned i = 0; i < old_capacity; i++){
+        if (old_map[i] != MEM_ADDR_MAP_EMPTY)
+            _mem_add_to_addr_map(pool_mgr, &pool_mgr->node_heap[old_map[i]]);
+    }
+    free(old_map);
+    return ALLOC_OK;
+}
+
+// home slot of an allocation address (Fibonacci hashing of the address itself,
+// since the start of an arena of a sharded pool can move)
+static unsigned _mem_addr_map_slot(pool_mgr_pt pool_mgr, const char *mem) {
+    uint64_t key = (uint64_t) (uintptr_t) mem;
+    return (unsigned) ((key * 11400714819323198485ULL) >> 32) & (pool_mgr->addr_map_capacity - 1);
+}
+
+// note: the map stores node heap indices, which survive node heap resizing
+static void _mem_add_to_addr_map(pool_mgr_pt pool_mgr, node_pt node) {
+    unsigned mask = pool_mgr->addr_map_capacity - 1;
+    unsigned slot = _mem_addr_map_slot(pool_mgr, node->alloc_record.mem);
+
+    while (pool_mgr->addr_map[slot] != MEM_ADDR_MAP_EMPTY)
+        slot = (slot + 1) & mask;
+    pool_mgr->addr_map[slot] = (unsigned) (node - pool_mgr->node_heap);
+}
+
+// removes by shifting back the entries of the probe sequence, so no tombstones are needed
+static void _mem_remove_from_addr_map(pool_mgr_pt pool_mgr, node_pt node) {
+    unsigned mask = pool_mgr->addr_map_capacity - 1;
+    unsigned ix = (unsigned) (node - pool_mgr->node_heap);
+    unsigned slot = _mem_addr_map_slot(pool_mgr, node->alloc_record.mem);
+
+    while (pool_mgr->addr_map[slot] != ix){
+        assert(pool_mgr->addr_map[slot] != MEM_ADDR_MAP_EMPTY);
+        slot = (slot + 1) & mask;
+    }
+    for (unsigned next = (slot + 1) & mask;
+         pool_mgr->addr_map[next] != MEM_ADDR_MAP_EMPTY;
+         next = (next + 1) & mask){
+        unsigned home = _mem_addr_map_slot(pool_mgr,
+                                           pool_mgr->node_heap[pool_mgr->addr_map[next]].alloc_record.mem);
+        // move the entry into the hole unless its home lies cyclically in (slot, next]
+        if (((next - home) & mask) >= ((next - slot) & mask)){
+            pool_mgr->addr_map[slot] = pool_mgr->addr_map[next];
+            slot = next;
+        }
+    }
+    pool_mgr->addr_map[slot] = MEM_ADDR_MAP_EMPTY;
+}
+
+// returns the allocation node starting at mem, or null if there is none
+static node_pt _mem_find_addr_map(pool_mgr_pt pool_mgr, const char *mem) {
+    unsigned mask = pool_mgr->addr_map_capacity - 1;
+    unsigned slot;
+
+    // (the extents of a growable pool lie outside this range)
+    if (pool_mgr->extents == NULL
+        && (mem < pool_mgr->pool.mem || mem >= pool_mgr->pool.mem + pool_mgr->pool.total_size))
+        return NULL;
+    for (slot = _mem_addr_map_slot(pool_mgr, mem);
+         pool_mgr->addr_map[slot] != MEM_ADDR_MAP_EMPTY;
+         slot = (slot + 1) & mask){
+        node_pt node = &pool_mgr->node_heap[pool_mgr->addr_map[slot]];
+        if (node->alloc_record.mem == mem)
+            return node;
+    }
+    return NULL;
+}
+
+// converts an allocation node to a gap, coalescing it with neighboring gaps
+static alloc_status _mem_del_node(pool_mgr_pt pool_mgr, node_pt del_node) {
+    pool_pt pool = (pool_pt) pool_mgr;
+
+    // make sure it's found
+    if (del_node == NULL){
+        return ALLOC_FAIL;
+    }
+    assert(del_node->used == 1 && del_node->allocated == 1);
+
+    // the neighboring gaps to merge with, which are not across the start of an extent
+    node_pt next = del_node->next, prev = del_node->prev;
+    if (next != NULL && (next->allocated == 1 || next->extent)){
+        next = NULL;
+    }
+    if (prev != NULL && (prev->allocated == 1 || del_node->extent)){
+        prev = NULL;
+    }
+
+    // the pages of a neighboring gap of at least the decommit threshold have
+    // been given back already, those of the block and smaller gaps have not
+    char *from = del_node->alloc_record.mem;
+    char *to = from + del_node->alloc_record.size;
+    if (next != NULL && next->alloc_record.size < pool_mgr->decommit){
+        to += next->alloc_record.size;
+    }
+    if (prev != NULL && prev->alloc_record.size < pool_mgr->decommit){
+        from = prev->alloc_record.mem;
+    }
+
+    // convert to gap node & update metadata (num_allocs, alloc_size)
+    // (a block with a handle is not in the address map)
+    if (del_node->handle == 0)
+        _mem_remove_from_addr_map(pool_mgr, del_node);
+    del_node->handle = 0;
+    del_node->allocated = 0;
+    pool->alloc_size -= del_node->alloc_record.size;
+    pool->num_allocs--;
+
+    node_pt final_node = del_node;
+    _mem_add_to_gap_ix(pool_mgr, final_node->alloc_record.size, final_node);
+
+    // if the next node in the list is also a gap, merge into final_node
+    if (next != NULL){
+        final_node = merge_gaps(pool_mgr, del_node, next);
+    }
+
+    // if previous node in list is also gap merge the nodes
+    if (prev != NULL){
+        final_node = merge_gaps(pool_mgr, prev, final_node);
+    }
+    // an extent that is all gap now may go back as a whole
+    if (_mem_shrink(pool_mgr, final_node) != ALLOC_OK){
+        _mem_decommit(pool_mgr, final_node->alloc_record.mem,
+                      final_node->alloc_record.mem + final_node->alloc_record.size, from, to);
+    }
+
+    return ALLOC_OK;
+}
+
+// Resizes an allocation node in place. A shrink gives the tail to the gap
+// after the node, or to a new gap if there is none (so the node heap must have
+// a free node); a growth takes the head of the gap after the node, and fails
+// if there is none or it is too small.
+static alloc_status _mem_resize_node(pool_mgr_pt pool_mgr, node_pt node, size_t size) {
+    pool_pt pool = (pool_pt) pool_mgr;
+    size_t old_size = node->alloc_record.size;
+    node_pt gap = node->next;
+
+    if (gap != NULL && (gap->allocated == 1 || gap->extent)){
+        gap = NULL;
+    }
+    if (size < old_size){
+        size_t tail = old_size - size;
+        char *to = node->alloc_record.mem + old_size;
+
+        // the gap is keyed on its size and address, so it leaves the index first
+        if (gap != NULL){
+            if (gap->alloc_record.size < pool_mgr->decommit)
+                to += gap->alloc_record.size;
+            _mem_remove_from_gap_ix(pool_mgr, gap->alloc_record.size, gap);
+            gap->alloc_record.mem -= tail;
+            gap->alloc_record.size += tail;
+        }
+        else{
+            gap = _mem_acquire_node(pool_mgr);
+            assert(gap != NULL);
+            gap->alloc_record.mem = node->alloc_record.mem + size;
+            gap->alloc_record.size = tail;
+            insert_node_heap(node, gap);
+        }
+        _mem_add_to_gap_ix(pool_mgr, gap->alloc_record.size, gap);
+        _mem_decommit(pool_mgr, gap->alloc_record.mem, gap->alloc_record.mem + gap->alloc_record.size,
+                      gap->alloc_record.mem, to);
+    }
+    else if (size > old_size){
+        size_t extra = size - old_size;
+
+        if (gap == NULL || gap->alloc_record.size < extra){
+            return ALLOC_FAIL;
+        }
+        _mem_remove_from_gap_ix(pool_mgr, gap->alloc_record.size, gap);
+        if (gap->alloc_record.size == extra){
+            // the gap is used up, so unlink it
+            node->next = gap->next;
+            if (gap->next != NULL){
+                gap->next->prev = node;
+            }
+            if (pool_mgr->rover == gap){
+                pool_mgr->rover = node->next;
+            }
+            _mem_release_node(pool_mgr, gap);
+        }
+        else{
+            gap->alloc_record.mem += extra;
+            gap->alloc_record.size -= extra;
+            _mem_add_to_gap_ix(pool_mgr, gap->alloc_record.size, gap);
+        }
+    }
+    node->alloc_record.size = size;
+    pool->alloc_size = pool->alloc_size - old_size + size;
+
+    return ALLOC_OK;
+}
+
+static void insert_node_heap(node_pt first_node, node_pt insert_node) {
+    insert_node->next = first_node->next;
+    if (insert_node->next != NULL) {
+        insert_node->next->prev = insert_node;
+    }
+    first_node->next = insert_node;
+    insert_node->prev = first_node;
+}
+
+static node_pt merge_gaps(pool_mgr_pt pool_mgr, node_pt first_node, node_pt next_node){
+    assert(first_node->allocated == 0);
+    assert(next_node->allocated == 0);
+    // remove both nodes from gap index
+    alloc_status status;
+    status = _mem_remove_from_gap_ix(pool_mgr, next_node->alloc_record.size, next_node);
+    //assert(status == ALLOC_OK);
+    status = _mem_remove_from_gap_ix(pool_mgr, first_node->alloc_record.size, first_node);
+    //assert(status == ALLOC_OK);
+    //   check success
+    //   add the size to the node-to-delete
+    //   update node as unused
+    //   update metadata (used nodes)
+    first_node->alloc_record.size += next_node->alloc_record.size;
+
+    // update node list
+    if (next_node->next != NULL){
+        first_node->next = next_node->next;
+        next_node->next->prev = first_node;
+    }
+    else{
+        first_node->next = NULL;
+    }
+    // the merged gap starts where the rover's gap used to be, or before it
+    if (pool_mgr->rover == next_node){
+        pool_mgr->rover = first_node;
+    }
+    _mem_release_node(pool_mgr, next_node);
+
+    // add merged node back into gap index
+    _mem_add_to_gap_ix(pool_mgr, first_node->alloc_record.size, first_node);
+
+    return first_node;
+}
+
+// merges next_node into first_node like merge_gaps, for gaps that are not in the gap index
+static void _mem_absorb_node(pool_mgr_pt pool_mgr, node_pt first_node, node_pt next_node) {
+    first_node->alloc_record.size += next_node->alloc_record.size;
+    first_node->next = next_node->next;
+    if (next_node->next != NULL){
+        next_node->next->prev = first_node;
+    }
+    if (pool_mgr->rover == next_node){
+        pool_mgr->rover = first_node;
+    }
+    _mem_release_node(pool_mgr, next_node);
+}
+
+// Adds an extent that holds at least size bytes to a growable pool, as a gap
+// at the end of the node list. The extent is as large as the pool is already,
+// so that the pool doubles, as far as max_size allows.
+static alloc_status _mem_grow(pool_mgr_pt pool_mgr, size_t size) {
+    pool_pt pool = (pool_pt) pool_mgr;
+    size_t room = pool_mgr->max_size - pool->total_size;
+    size_t extent_size = (size > pool->total_size) ? size : pool->total_size;
+    extent_pt extent;
+    node_pt gap, last;
+
+    if (size > room || pool_mgr->num_extents == MEM_MAX_EXTENTS){
+        return ALLOC_FAIL;
+    }
+    if (extent_size > room){
+        extent_size = room;
+    }
+    // a node for the extent, and one for what is left of it after the allocation
+    if (_mem_reserve_nodes(pool_mgr, 2) != ALLOC_OK){
+        return ALLOC_FAIL;
+    }
+    extent = &pool_mgr->extents[pool_mgr->num_extents];
+    extent->mem = _mem_alloc_extent(extent_size, &pool_mgr->opts, &extent->map_size);
+    if (extent->mem == NULL){
+        return ALLOC_FAIL;
+    }
+    extent->size = extent_size;
+    pool_mgr->num_extents++;
+
+    // the nodes of an extent follow its first one, up to the next extent
+    for (last = pool_mgr->node_heap; last->next != NULL; last = last->next)
+        ;
+    gap = _mem_acquire_node(pool_mgr);
+    assert(gap != NULL);
+    gap->alloc_record.mem = extent->mem;
+    gap->alloc_record.size = extent_size;
+    gap->extent = 1;
+    insert_node_heap(last, gap);
+    _mem_add_to_gap_ix(pool_mgr, extent_size, gap);
+    pool->total_size += extent_size;
+
+    return ALLOC_OK;
+}
+
+// Releases the extent of a growable pool that gap covers, if it covers all of
+// it and the pool is at most half full without it (so that a pool on the edge
+// does not map and unmap an extent over and over). Returns ALLOC_FAIL if the
+// extent stays.
+static alloc_status _mem_shrink(pool_mgr_pt pool_mgr, node_pt gap) {
+    pool_pt pool = (pool_pt) pool_mgr;
+    size_t size = gap->alloc_record.size;
+    unsigned i;
+
+    if (gap->extent == 0 || (gap->next != NULL && gap->next->extent == 0)){
+        return ALLOC_FAIL;
+    }
+    if (pool->alloc_size > (pool->total_size - size) / 2){
+        return ALLOC_FAIL;
+    }
+    for (i = 0; pool_mgr->extents[i].mem != gap->alloc_record.mem; i++)
+        ;
+    assert(i < pool_mgr->num_extents && pool_mgr->extents[i].size == size);
+
+    // the first node of the pool is never that of an extent, so gap has a prev
+    _mem_remove_from_gap_ix(pool_mgr, size, gap);
+    gap->prev->next = gap->next;
+    if (gap->next != NULL){
+        gap->next->prev = gap->prev;
+    }
+    if (pool_mgr->rover == gap){
+        pool_mgr->rover = gap->next;
+    }
+    _mem_release_node(pool_mgr, gap);
+    pool->total_size -= size;
+
+    _mem_free_extent(pool_mgr->extents[i].mem, pool_mgr->extents[i].map_size);
+    pool_mgr->extents[i] = pool_mgr->extents[--pool_mgr->num_extents];
+
+    return ALLOC_OK;
+}
+
+
+
+// number of gaps of a pool without allocations
+static unsigned _mem_empty_pool_gaps(pool_mgr_pt pool_mgr) {
+    unsigned num_gaps = 0;
+
+    if (pool_mgr->num_nodes != 0){
+        for (unsigned i = 0; i < pool_mgr->num_nodes; i++){
+            if (pool_mgr->nodes[i] != NULL)
+                num_gaps += _mem_empty_pool_gaps(pool_mgr->nodes[i]);
+        }
+        return num_gaps;
+    }
+    if (pool_mgr->num_shards != 0)
+        return pool_mgr->num_shards;
+    if (pool_mgr->kind == POOL_SLAB)
+        return pool_mgr->slab_slots;
+    if (pool_mgr->pool.policy == BUDDY)
+        return _mem_buddy_top_blocks(pool_mgr->pool.total_size);
+    return 1 + pool_mgr->num_extents;
+}
+
+// number of top-level blocks (one per bit set in the size) of a buddy pool
+static unsigned _mem_buddy_top_blocks(size_t size) {
+    return (unsigned) __builtin_popcountll((unsigned long long) size);
+}
+
+// cuts the single gap of a new buddy pool into power-of-two blocks, largest
+// first, so that every block is aligned to its size relative to the pool start
+static alloc_status _mem_init_buddy(pool_mgr_pt pool_mgr) {
+    node_pt block;
+
+    while (pool_mgr->total_nodes - pool_mgr->used_nodes
+           < _mem_buddy_top_blocks(pool_mgr->pool.total_size)){
+        if (_mem_expand_node_heap(pool_mgr) != ALLOC_OK)
+            return ALLOC_FAIL;
+    }
+
+    block = pool_mgr->node_heap;
+    while ((block->alloc_record.size & (block->alloc_record.size - 1)) != 0){
+        size_t size = block->alloc_record.size;
+        size_t top = (size_t) 1 << (63 - __builtin_clzll((unsigned long long) size));
+        node_pt rest = _mem_acquire_node(pool_mgr);
+
+        _mem_remove_from_gap_ix(pool_mgr, size, block);
+        block->alloc_record.size = top;
+        _mem_add_to_gap_ix(pool_mgr, top, block);
+
+        rest->alloc_record.mem = block->alloc_record.mem + top;
+        rest->alloc_record.size = size - top;
+        _mem_add_to_gap_ix(pool_mgr, size - top, rest);
+        insert_node_heap(block, rest);
+        block = rest;
+    }
+    return ALLOC_OK;
+}
+
+// allocates a block of the smallest power of two that holds size bytes, taking
+// the smallest free block that does and halving it as often as needed (the
+// upper halves become gaps); the allocation record holds the block size
+static node_pt _mem_new_buddy(pool_mgr_pt pool_mgr, size_t size) {
+    size_t block_size;
+    node_pt alloc_node;
+    unsigned splits;
+
+    if (size > ((size_t) 1 << 63)){
+        return NULL;
+    }
+    block_size = (size == 1) ? 1 : (size_t) 1 << (64 - __builtin_clzll((unsigned long long) (size - 1)));
+
+    alloc_node = _mem_find_gap_ix(pool_mgr, block_size);
+    if (alloc_node == NULL){
+        return NULL;
+    }
+
+    // every split takes a node, so make sure there are enough (the heap may move)
+    splits = (unsigned) (__builtin_ctzll((unsigned long long) alloc_node->alloc_record.size)
+                         - __builtin_ctzll((unsigned long long) block_size));
+    while (pool_mgr->total_nodes - pool_mgr->used_nodes < splits){
+        unsigned ix = (unsigned) (alloc_node - pool_mgr->node_heap);
+        if (_mem_expand_node_heap(pool_mgr) != ALLOC_OK)
+            return NULL;
+        alloc_node = &pool_mgr->node_heap[ix];
+    }
+
+    _mem_remove_from_gap_ix(pool_mgr, alloc_node->alloc_record.size, alloc_node);
+    while (alloc_node->alloc_record.size > block_size){
+        node_pt buddy = _mem_acquire_node(pool_mgr);
+
+        alloc_node->alloc_record.size /= 2;
+        buddy->alloc_record.mem = alloc_node->alloc_record.mem + alloc_node->alloc_record.size;
+        buddy->alloc_record.size = alloc_node->alloc_record.size;
+        _mem_add_to_gap_ix(pool_mgr, buddy->alloc_record.size, buddy);
+        insert_node_heap(alloc_node, buddy);
+    }
+    alloc_node->allocated = 1;
+
+    pool_mgr->pool.alloc_size += block_size;
+    pool_mgr->pool.num_allocs++;
+    _mem_add_to_addr_map(pool_mgr, alloc_node);
+
+    return alloc_node;
+}
+
+// converts a buddy block to a gap and merges it with its buddy (the block at
+// its offset XOR its size) for as long as the buddy is a whole free block, which
+// is the case when the list neighbor on that side is a gap of the same size
+static alloc_status _mem_del_buddy(pool_mgr_pt pool_mgr, node_pt del_node) {
+    pool_pt pool = (pool_pt) pool_mgr;
+
+    if (del_node == NULL){
+        return ALLOC_FAIL;
+    }
+    assert(del_node->used == 1 && del_node->allocated == 1);
+
+    _mem_remove_from_addr_map(pool_mgr, del_node);
+    del_node->allocated = 0;
+    pool->alloc_size -= del_node->alloc_record.size;
+    pool->num_allocs--;
+    _mem_add_to_gap_ix(pool_mgr, del_node->alloc_record.size, del_node);
+
+    for (;;){
+        size_t size = del_node->alloc_record.size;
+        size_t offset = (size_t) (del_node->alloc_record.mem - pool->mem);
+        node_pt buddy = (offset & size) ? del_node->prev : del_node->next;
+
+        if (buddy == NULL || buddy->allocated == 1 || buddy->alloc_record.size != size){
+            break;
+        }
+        assert((size_t) (buddy->alloc_record.mem - pool->mem) == (offset ^ size));
+        del_node = (offset & size) ? merge_gaps(pool_mgr, buddy, del_node)
+                                   : merge_gaps(pool_mgr, del_node, buddy);
+    }
+    _mem_decommit(pool_mgr, del_node->alloc_record.mem, del_node->alloc_record.mem + del_node->alloc_record.size,
+                  del_node->alloc_record.mem, del_node->alloc_record.mem + del_node->alloc_record.size);
+    return ALLOC_OK;
+}
+
+
+
+/***********************************/
+/*                                 */
+/* Gap index (AVL tree) primitives */
+/*                                 */
+/***********************************/
+// The gap index is an AVL tree threaded through the gap nodes of the node heap.
+// It is ordered by (size, mem) for BEST_FIT and by mem otherwise, so every
+// key is unique, and each node caches the largest gap size in its subtree.
+
+static unsigned _gap_height(node_pt node) {
+    return (node == NULL) ? 0 : node->gap_height;
+}
+
+static void _gap_update(node_pt node) {
+    unsigned left = _gap_height(node->gap_left);
+    unsigned right = _gap_height(node->gap_right);
+    node->gap_height = 1 + ((left > right) ? left : right);
+
+    node->gap_max = node->alloc_record.size;
+    if (node->gap_left != NULL && node->gap_left->gap_max > node->gap_max)
+        node->gap_max = node->gap_left->gap_max;
+    if (node->gap_right != NULL && node->gap_right->gap_max > node->gap_max)
+        node->gap_max = node->gap_right->gap_max;
+}
+
+// negative if node a goes before node b in a tree of the given order
+static int _gap_cmp(node_pt a, node_pt b, alloc_policy order) {
+    if (order == BEST_FIT && a->alloc_record.size != b->alloc_record.size)
+        return (a->alloc_record.size < b->alloc_record.size) ? -1 : 1;
+    if (a->alloc_record.mem != b->alloc_record.mem)
+        return (a->alloc_record.mem < b->alloc_record.mem) ? -1 : 1;
+    return 0;
+}
+
+static node_pt _gap_rotate_left(node_pt node) {
+    node_pt pivot = node->gap_right;
+    node->gap_right = pivot->gap_left;
+    pivot->gap_left = node;
+    _gap_update(node);
+    _gap_update(pivot);
+    return pivot;
+}
+
+static node_pt _gap_rotate_right(node_pt node) {
+    node_pt pivot = node->gap_left;
+    node->gap_left = pivot->gap_right;
+    pivot->gap_right = node;
+    _gap_update(node);
+    _gap_update(pivot);
+    return pivot;
+}
+
+static node_pt _gap_rebalance(node_pt node) {
+    int balance;
+
+    _gap_update(node);
+    balance = (int) _gap_height(node->gap_left) - (int) _gap_height(node->gap_right);
+    if (balance > 1){
+        if (_gap_height(node->gap_left->gap_left) < _gap_height(node->gap_left->gap_right))
+            node->gap_left = _gap_rotate_left(node->gap_left);
+        return _gap_rotate_right(node);
+    }
+    if (balance < -1){
+        if (_gap_height(node->gap_right->gap_right) < _gap_height(node->gap_right->gap_left))
+            node->gap_right = _gap_rotate_right(node->gap_right);
+        return _gap_rotate_left(node);
+    }
+    return node;
+}
+
+// inserts node into the subtree at root, returns the new subtree root
+static node_pt _gap_insert(node_pt root, node_pt node, alloc_policy order) {
+    if (root == NULL)
+        return node;
+    if (_gap_cmp(node, root, order) < 0)
+        root->gap_left = _gap_insert(root->gap_left, node, order);
+    else
+        root->gap_right = _gap_insert(root->gap_right, node, order);
+    return _gap_rebalance(root);
+}
+
+// detaches the leftmost node of the subtree at root into *min
+static node_pt _gap_remove_min(node_pt root, node_pt *min) {
+    if (root->gap_left == NULL){
+        *min = root;
+        return root->gap_right;
+    }
+    root->gap_left = _gap_remove_min(root->gap_left, min);
+    return _gap_rebalance(root);
+}
+
+// removes node from the subtree at root, returns the new subtree root
+static node_pt _gap_remove(node_pt root, node_pt node, int *found, alloc_policy order) {
+    node_pt replacement;
+
+    if (root == NULL)
+        return NULL;
+
+    if (root == node){
+        *found = 1;
+        if (root->gap_left == NULL){
+            replacement = root->gap_right;
+        }
+        else if (root->gap_right == NULL){
+            replacement = root->gap_left;
+        }
+        else{
+            node_pt right = _gap_remove_min(root->gap_right, &replacement);
+            replacement->gap_left = root->gap_left;
+            replacement->gap_right = right;
+            replacement = _gap_rebalance(replacement);
+        }
+        node->gap_left = NULL;
+        node->gap_right = NULL;
+        node->gap_height = 0;
+        return replacement;
+    }
+
+    if (_gap_cmp(node, root, order) < 0)
+        root->gap_left = _gap_remove(root->gap_left, node, found, order);
+    else
+        root->gap_right = _gap_remove(root->gap_right, node, found, order);
+    return _gap_rebalance(root);
+}
+
+
+
+// returns the topmost gap at or after from that holds size bytes, in a tree
+// ordered by mem; the subtree maxima prune every subtree without one, so
+// only the path along from and a single descent are visited
+static node_pt _gap_find_first(node_pt root, const char *from, size_t size) {
+    node_pt found;
+
+    if (root == NULL || root->gap_max < size)
+        return NULL;
+    if (root->alloc_record.mem < from)
+        return _gap_find_first(root->gap_right, from, size);
+    found = _gap_find_first(root->gap_left, from, size);
+    if (found != NULL)
+        return found;
+    if (root->alloc_record.size >= size)
+        return root;
+    return _gap_find_first(root->gap_right, from, size);
+}
+
+// returns the first gap, in the order of the tree, that holds size bytes at a
+// multiple of alignment: the topmost in a tree ordered by mem, the smallest in
+// one ordered by size; the subtree maxima prune every subtree without a gap of
+// size bytes, but gaps that are too small once aligned are visited too, so
+// the search gives up (and returns null) after visiting *budget nodes
+static node_pt _gap_find_aligned(node_pt root, size_t size, size_t alignment, unsigned *budget) {
+    node_pt found;
+    size_t pad;
+
+    if (root == NULL || root->gap_max < size || *budget == 0)
+        return NULL;
+    (*budget)--;
+    found = _gap_find_aligned(root->gap_left, size, alignment, budget);
+    if (found != NULL || *budget == 0)
+        return found;
+    pad = (size_t) (-(uintptr_t) root->alloc_record.mem) & (alignment - 1);
+    if (root->alloc_record.size >= size && root->alloc_record.size - size >= pad)
+        return root;
+    return _gap_find_aligned(root->gap_right, size, alignment, budget);
+}
+
+
+
+/*****************************************/
+/*                                       */
+/* Gap index (segregated fit) primitives */
+/*                                       */
+/*****************************************/
+// Two-level segregated fit (as in TLSF): every gap is on the doubly-linked list
+// of its size class, and two levels of bitmaps record which lists are non-empty,
+// so insertion, removal and lookup take a constant number of steps.
+
+// maps a size to its size class: sizes below MEM_SEG_SL_COUNT get a class each,
+// larger ones get the power-of-two range of their top bit, split linearly
+static void _seg_mapping(size_t size, unsigned *fl, unsigned *sl) {
+    if (size < MEM_SEG_SL_COUNT){
+        *fl = 0;
+        *sl = (unsigned) size;
+    }
+    else{
+        unsigned top = 63 - __builtin_clzll((unsigned long long) size);
+        *sl = (unsigned) (size >> (top - MEM_SEG_SL_LOG2)) ^ MEM_SEG_SL_COUNT;
+        *fl = top - MEM_SEG_SL_LOG2 + 1;
+    }
+}
+
+// marks the class fl/sl as non-empty
+static void _seg_map_set(seg_map_pt map, unsigned fl, unsigned sl) {
+    map->fl_bitmap |= (uint64_t) 1 << fl;
+    map->sl_bitmap[fl] |= 1U << sl;
+}
+
+// marks the class fl/sl as empty
+static void _seg_map_clear(seg_map_pt map, unsigned fl, unsigned sl) {
+    map->sl_bitmap[fl] &= ~(1U << sl);
+    if (map->sl_bitmap[fl] == 0)
+        map->fl_bitmap &= ~((uint64_t) 1 << fl);
+}
+
+// finds the smallest non-empty class all of whose gaps hold size bytes
+static int _seg_map_search(const seg_map_t *map, size_t size, unsigned *fl, unsigned *sl) {
+    unsigned sl_map;
+    uint64_t fl_map;
+    size_t rounded = size;
+
+    // round up to the next class boundary, so any gap in the class found fits
+    if (size >= MEM_SEG_SL_COUNT){
+        unsigned top = 63 - __builtin_clzll((unsigned long long) size);
+        rounded = size + (((size_t) 1 << (top - MEM_SEG_SL_LOG2)) - 1);
+    }
+    if (rounded < size)
+        return 0;
+
+    _seg_mapping(rounded, fl, sl);
+    sl_map = map->sl_bitmap[*fl] & (~0U << *sl);
+    if (sl_map == 0){
+        fl_map = (*fl + 1 < MEM_SEG_FL_COUNT) ? map->fl_bitmap & (~(uint64_t) 0 << (*fl + 1)) : 0;
+        if (fl_map == 0)
+            return 0;
+        *fl = (unsigned) __builtin_ctzll(fl_map);
+        sl_map = map->sl_bitmap[*fl];
+    }
+    *sl = (unsigned) __builtin_ctz(sl_map);
+    return 1;
+}
+
+static void _seg_insert(seg_ix_pt seg_ix, node_pt node) {
+    unsigned fl, sl;
+
+    _seg_mapping(node->alloc_record.size, &fl, &sl);
+    node->gap_left = NULL;
+    node->gap_right = seg_ix->heads[fl][sl];
+    if (node->gap_right != NULL)
+        node->gap_right->gap_left = node;
+    seg_ix->heads[fl][sl] = node;
+    _seg_map_set(&seg_ix->map, fl, sl);
+}
+
+static void _seg_remove(seg_ix_pt seg_ix, node_pt node) {
+    unsigned fl, sl;
+
+    _seg_mapping(node->alloc_record.size, &fl, &sl);
+    if (node->gap_left != NULL)
+        node->gap_left->gap_right = node->gap_right;
+    else
+        seg_ix->heads[fl][sl] = node->gap_right;
+    if (node->gap_right != NULL)
+        node->gap_right->gap_left = node->gap_left;
+    node->gap_left = NULL;
+    node->gap_right = NULL;
+
+    if (seg_ix->heads[fl][sl] == NULL)
+        _seg_map_clear(&seg_ix->map, fl, sl);
+}
+
+static node_pt _seg_find(seg_ix_pt seg_ix, size_t size) {
+    unsigned fl, sl;
+
+    if (_seg_map_search(&seg_ix->map, size, &fl, &sl))
+        return seg_ix->heads[fl][sl];
+
+    // no class above the request has a gap, but the request's own class may
+    // still hold a large enough one (e.g. the whole pool); only its first
+    // MEM_SEG_FIT_SCAN gaps are checked, so a gap further down the list that
+    // would fit may be missed
+    _seg_mapping(size, &fl, &sl);
+    unsigned scan = MEM_SEG_FIT_SCAN;
+    for (node_pt node = seg_ix->heads[fl][sl]; node != NULL && scan-- > 0; node = node->gap_right){
+        if (node->alloc_record.size >= size)
+            return node;
+    }
+    return NULL;
+}
+
+
+
+/********************************/
+/*                              */
+/* Boundary-tag pool primitives */
+/*                              */
+/********************************/
+// A boundary-tag pool has no node heap: the pool memory is tiled with blocks,
+// each starting with a tag_t header that holds its size and flags. A gap also
+// stores its size in its last word, and its successor has MEM_TAG_PREV_ALLOCATED
+// cleared, so both neighbours of a block are found by pointer arithmetic and a
+// deallocation coalesces in constant time. Gaps are on segregated size class
+// lists threaded through their headers, i.e. the pool policy is SEGREGATED_FIT.
+// Two gaps are never adjacent, so the blocks are num_allocs + num_gaps. The
+// lists link gaps by their offsets in the pool memory, so that the only
+// addresses in it are those of the allocation records.
+
+static size_t _tag_size(tag_pt tag) {
+    return tag->size_flags & ~MEM_TAG_FLAGS;
+}
+
+// end of the tiled part of the pool memory (the pool size rounded down)
+static char *_tag_end(pool_mgr_pt pool_mgr) {
+    return pool_mgr->pool.mem + (pool_mgr->pool.total_size & ~MEM_TAG_FLAGS);
+}
+
+// the block after tag, or null if tag is the last block of the pool
+static tag_pt _tag_next(pool_mgr_pt pool_mgr, tag_pt tag) {
+    char *next = (char *) tag + _tag_size(tag);
+    return (next < _tag_end(pool_mgr)) ? (tag_pt) next : NULL;
+}
+
+// the gap at a link offset, or null for MEM_TAG_NONE
+static tag_pt _tag_at(pool_mgr_pt pool_mgr, size_t offset) {
+    return (offset == MEM_TAG_NONE) ? NULL : (tag_pt) (pool_mgr->pool.mem + offset);
+}
+
+static size_t _tag_offset(pool_mgr_pt pool_mgr, tag_pt tag) {
+    return (tag == NULL) ? MEM_TAG_NONE : (size_t) ((char *) tag - pool_mgr->pool.mem);
+}
+
+// the block before tag, which has to be a gap, read from the gap's footer
+static tag_pt _tag_prev_gap(tag_pt tag) {
+    assert((tag->size_flags & MEM_TAG_PREV_ALLOCATED) == 0);
+    return (tag_pt) ((char *) tag - ((size_t *) tag)[-1]);
+}
+
+// puts a gap of the given size at tag, with its footer, on its size class list
+static void _tag_add_gap(pool_mgr_pt pool_mgr, tag_pt tag, size_t size) {
+    tag_ix_pt tag_ix = pool_mgr->tag_ix;
+    unsigned fl, sl;
+
+    // a gap always follows an allocation (or starts the pool)
+    tag->size_flags = size | MEM_TAG_PREV_ALLOCATED;
+    *(size_t *) ((char *) tag + size - sizeof(size_t)) = size;
+
+    _seg_mapping(size, &fl, &sl);
+    tag->prev_gap = MEM_TAG_NONE;
+    tag->next_gap = tag_ix->heads[fl][sl];
+    if (tag->next_gap != MEM_TAG_NONE)
+        _tag_at(pool_mgr, tag->next_gap)->prev_gap = _tag_offset(pool_mgr, tag);
+    tag_ix->heads[fl][sl] = _tag_offset(pool_mgr, tag);
+    _seg_map_set(&tag_ix->map, fl, sl);
+
+    pool_mgr->pool.num_gaps++;
+}
+
+static void _tag_remove_gap(pool_mgr_pt pool_mgr, tag_pt tag) {
+    tag_ix_pt tag_ix = pool_mgr->tag_ix;
+    unsigned fl, sl;
+
+    _seg_mapping(_tag_size(tag), &fl, &sl);
+    if (tag->prev_gap != MEM_TAG_NONE)
+        _tag_at(pool_mgr, tag->prev_gap)->next_gap = tag->next_gap;
+    else
+        tag_ix->heads[fl][sl] = tag->next_gap;
+    if (tag->next_gap != MEM_TAG_NONE)
+        _tag_at(pool_mgr, tag->next_gap)->prev_gap = tag->prev_gap;
+    if (tag_ix->heads[fl][sl] == MEM_TAG_NONE)
+        _seg_map_clear(&tag_ix->map, fl, sl);
+
+    pool_mgr->pool.num_gaps--;
+}
+
+// same lookup as _seg_find
+static tag_pt _tag_find_gap(pool_mgr_pt pool_mgr, size_t size) {
+    tag_ix_pt tag_ix = pool_mgr->tag_ix;
+    unsigned fl, sl;
+
+    if (_seg_map_search(&tag_ix->map, size, &fl, &sl))
+        return _tag_at(pool_mgr, tag_ix->heads[fl][sl]);
+
+    _seg_mapping(size, &fl, &sl);
+    unsigned scan = MEM_SEG_FIT_SCAN;
+    for (tag_pt tag = _tag_at(pool_mgr, tag_ix->heads[fl][sl]); tag != NULL && scan-- > 0;
+         tag = _tag_at(pool_mgr, tag->next_gap)){
+        if (_tag_size(tag) >= size)
+            return tag;
+    }
+    return NULL;
+}
+
+// allocates the size class lists and makes the whole pool memory the first gap
+static alloc_status _tag_init_pool(pool_mgr_pt pool_mgr) {
+    size_t size = pool_mgr->pool.total_size & ~MEM_TAG_FLAGS;
+
+    // the pool memory has to hold at least one block
+    if (size < MEM_TAG_MIN_BLOCK){
+        return ALLOC_FAIL;
+    }
+    // (a file-backed pool has them in the file header already)
+    if (pool_mgr->tag_ix == NULL)
+        pool_mgr->tag_ix = (tag_ix_pt) calloc(1, sizeof(tag_ix_t));
+    if (pool_mgr->tag_ix == NULL){
+        return ALLOC_FAIL;
+    }
+    for (unsigned fl = 0; fl < MEM_SEG_FL_COUNT; fl++){
+        for (unsigned sl = 0; sl < MEM_SEG_SL_COUNT; sl++)
+            pool_mgr->tag_ix->heads[fl][sl] = MEM_TAG_NONE;
+    }
+    _tag_add_gap(pool_mgr, (tag_pt) pool_mgr->pool.mem, size);
+
+    return ALLOC_OK;
+}
+
+static tag_pt _tag_new_alloc(pool_mgr_pt pool_mgr, size_t size) {
+    size_t block_size, gap_size;
+    tag_pt tag, next;
+
+    // the block holds the header and size bytes, rounded up to the alignment
+    if (size > SIZE_MAX - sizeof(tag_t) - MEM_TAG_ALIGN){
+        return NULL;
+    }
+    block_size = (sizeof(tag_t) + size + MEM_TAG_FLAGS) & ~MEM_TAG_FLAGS;
+    if (block_size < MEM_TAG_MIN_BLOCK){
+        block_size = MEM_TAG_MIN_BLOCK;
+    }
+
+    tag = _tag_find_gap(pool_mgr, block_size);
+    if (tag == NULL){
+        return NULL;
+    }
+    _tag_remove_gap(pool_mgr, tag);
+
+    // split off the remainder as a new gap, unless it is too small for one
+    gap_size = _tag_size(tag) - block_size;
+    if (gap_size >= MEM_TAG_MIN_BLOCK){
+        _tag_add_gap(pool_mgr, (tag_pt) ((char *) tag + block_size), gap_size);
+    }
+    else{
+        block_size = _tag_size(tag);
+        next = _tag_next(pool_mgr, tag);
+        if (next != NULL)
+            next->size_flags |= MEM_TAG_PREV_ALLOCATED;
+    }
+    tag->size_flags = block_size | MEM_TAG_ALLOCATED | MEM_TAG_PREV_ALLOCATED;
+    tag->alloc_record.size = size;
+    tag->alloc_record.mem = (char *) (tag + 1);
+
+    pool_mgr->pool.alloc_size += size;
+    pool_mgr->pool.num_allocs++;
+
+    return tag;
+}
+
+// converts an allocated block to a gap, coalescing it with neighboring gaps
+static alloc_status _tag_del_alloc(pool_mgr_pt pool_mgr, tag_pt tag) {
+    tag_pt next;
+    size_t size;
+    char *from, *to;
+
+    if (tag == NULL){
+        return ALLOC_FAIL;
+    }
+    pool_mgr->pool.alloc_size -= tag->alloc_record.size;
+    pool_mgr->pool.num_allocs--;
+
+    // the part of the new gap that may still have its pages (see _mem_del_node)
+    size = _tag_size(tag);
+    from = (char *) tag;
+    to = from + size;
+    next = _tag_next(pool_mgr, tag);
+    if (next != NULL && (next->size_flags & MEM_TAG_ALLOCATED) == 0){
+        _tag_remove_gap(pool_mgr, next);
+        size += _tag_size(next);
+        if (_tag_size(next) < pool_mgr->decommit + MEM_TAG_MIN_BLOCK)
+            to += _tag_size(next);
+    }
+    if ((tag->size_flags & MEM_TAG_PREV_ALLOCATED) == 0){
+        tag_pt prev = _tag_prev_gap(tag);
+        // the header ends up inside the gap, where it must not pass for an allocation
+        tag->size_flags = 0;
+        tag = prev;
+        _tag_remove_gap(pool_mgr, tag);
+        size += _tag_size(tag);
+        if (_tag_size(tag) < pool_mgr->decommit + MEM_TAG_MIN_BLOCK)
+            from = (char *) tag;
+    }
+    _tag_add_gap(pool_mgr, tag, size);
+    // a gap keeps its header and footer
+    _mem_decommit(pool_mgr, (char *) (tag + 1), (char *) tag + size - sizeof(size_t), from, to);
+
+    next = _tag_next(pool_mgr, tag);
+    if (next != NULL)
+        next->size_flags &= ~MEM_TAG_PREV_ALLOCATED;
+
+    return ALLOC_OK;
+}
+
+// resizes an allocated block in place, like _mem_resize_node: the block gives
+// its tail to, or takes the head of, the gap after it (if there is one)
+static alloc_status _tag_resize_alloc(pool_mgr_pt pool_mgr, tag_pt tag, size_t size) {
+    size_t block_size, avail, gap_size;
+    tag_pt next;
+    char *to;
+
+    if (size > SIZE_MAX - sizeof(tag_t) - MEM_TAG_ALIGN){
+        return ALLOC_FAIL;
+    }
+    block_size = (sizeof(tag_t) + size + MEM_TAG_FLAGS) & ~MEM_TAG_FLAGS;
+    if (block_size < MEM_TAG_MIN_BLOCK){
+        block_size = MEM_TAG_MIN_BLOCK;
+    }
+
+    avail = _tag_size(tag);
+    to = (char *) tag + avail;
+    next = _tag_next(pool_mgr, tag);
+    if (next != NULL && (next->size_flags & MEM_TAG_ALLOCATED) == 0){
+        if (block_size > avail + _tag_size(next)){
+            return ALLOC_FAIL;
+        }
+        _tag_remove_gap(pool_mgr, next);
+        avail += _tag_size(next);
+        if (_tag_size(next) < pool_mgr->decommit + MEM_TAG_MIN_BLOCK)
+            to += _tag_size(next);
+    }
+    else if (block_size > avail){
+        return ALLOC_FAIL;
+    }
+
+    // split off the remainder as a new gap, unless it is too small for one
+    gap_size = avail - block_size;
+    if (gap_size >= MEM_TAG_MIN_BLOCK){
+        tag->size_flags = block_size | (tag->size_flags & MEM_TAG_FLAGS);
+        next = (tag_pt) ((char *) tag + block_size);
+        _tag_add_gap(pool_mgr, next, gap_size);
+        _mem_decommit(pool_mgr, (char *) (next + 1), (char *) next + gap_size - sizeof(size_t), (char *) next, to);
+        next = _tag_next(pool_mgr, next);
+        if (next != NULL)
+            next->size_flags &= ~MEM_TAG_PREV_ALLOCATED;
+    }
+    else{
+        tag->size_flags = avail | (tag->size_flags & MEM_TAG_FLAGS);
+        next = _tag_next(pool_mgr, tag);
+        if (next != NULL)
+            next->size_flags |= MEM_TAG_PREV_ALLOCATED;
+    }
+    pool_mgr->pool.alloc_size = pool_mgr->pool.alloc_size - tag->alloc_record.size + size;
+    tag->alloc_record.size = size;
+
+    return ALLOC_OK;
+}
+
+// returns the allocated block whose memory starts at mem, or null if mem is
+// not the address of a live allocation in this pool (as far as can be told
+// from the header in front of it)
+static tag_pt _tag_find_alloc(pool_mgr_pt pool_mgr, const char *mem) {
+    tag_pt tag;
+
+    if (mem < pool_mgr->pool.mem + sizeof(tag_t) || mem >= _tag_end(pool_mgr)
+        || ((mem - pool_mgr->pool.mem) & MEM_TAG_FLAGS) != 0){
+        return NULL;
+    }
+    tag = (tag_pt) (mem - sizeof(tag_t));
+    if ((tag->size_flags & MEM_TAG_ALLOCATED) == 0 || tag->alloc_record.mem != mem){
+        return NULL;
+    }
+    return tag;
+}
+
+// points the allocation records at the blocks they are in, after the pool
+// memory has moved
+static void _tag_relocate(pool_mgr_pt pool_mgr) {
+    for (tag_pt tag = (tag_pt) pool_mgr->pool.mem; tag != NULL; tag = _tag_next(pool_mgr, tag)){
+        if (tag->size_flags & MEM_TAG_ALLOCATED)
+            tag->alloc_record.mem = (char *) (tag + 1);
+    }
+}
+
+// reports the blocks of the pool, headers included, in address order
+static void _tag_inspect_pool(pool_mgr_pt pool_mgr,
+                              pool_segment_pt *segments,
+                              unsigned *num_segments) {
+    unsigned num_blocks = pool_mgr->pool.num_allocs + pool_mgr->pool.num_gaps;
+    pool_segment_pt segs = (pool_segment_pt) calloc(num_blocks, sizeof(pool_segment_t));
+    unsigned i = 0;
+
+    for (tag_pt tag = (tag_pt) pool_mgr->pool.mem;
+         segs != NULL && tag != NULL;
+         tag = _tag_next(pool_mgr, tag)){
+        assert(i < num_blocks);
+        segs[i].size = _tag_size(tag);
+        segs[i].allocated = tag->size_flags & MEM_TAG_ALLOCATED;
+        i++;
+    }
+    *segments = segs;
+    *num_segments = num_blocks;
+}
+
+
+
+/***************************************/
+/*                                     */
+/* File-backed (persistent) primitives */
+/*                                     */
+/***************************************/
+// A file-backed pool is a boundary-tag pool whose memory is a shared mapping
+// of a file, after a file_header_t that holds its size class lists and its
+// counters. The gap links and the lists are offsets, so the file is the whole
+// pool wherever it is mapped. A reopened file is mapped at the address it had
+// if that is free, in which case nothing but the header is read, however many
+// allocations there are; otherwise one walk over the blocks points their
+// allocation records at the new address.
+//
+// A shared pool may be open in several processes at once. Its header holds a
+// process-shared lock, which every call takes instead of a lock of the pool
+// manager, and the counters, which the caller picks up with the lock and
+// leaves there when it lets go. A process that opens a pool that is open
+// elsewhere has to map it at the same address, since the allocation records
+// of the others are not to be moved; if that address is taken, it fails.
+
+// initializes the process-shared lock of a new shared pool
+static alloc_status _file_init_lock(file_header_pt file) {
+    pthread_mutexattr_t attr;
+    alloc_status status = ALLOC_FAIL;
+
+    if (pthread_mutexattr_init(&attr) != 0){
+        return ALLOC_FAIL;
+    }
+    if (pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) == 0
+        && pthread_mutex_init(&file->lock, &attr) == 0){
+        status = ALLOC_OK;
+    }
+    pthread_mutexattr_destroy(&attr);
+
+    return status;
+}
+
+// maps an open file as the memory of a pool, a new pool if the file is empty
+static alloc_status _file_map_pool(pool_mgr_pt pool_mgr, int fd) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t header_size = (sizeof(file_header_t) + page - 1) & ~(page - 1);
+    file_header_t header;
+    struct stat st;
+    char *base = NULL;
+    unsigned attached;
+    int flags = 0;
+    char *map;
+
+    if (fstat(fd, &st) != 0){
+        return ALLOC_FAIL;
+    }
+    if (st.st_size == 0){
+        // the pool memory has to hold at least one block (see _tag_init_pool)
+        if ((pool_mgr->pool.total_size & ~MEM_TAG_FLAGS) < MEM_TAG_MIN_BLOCK
+            || pool_mgr->pool.total_size > SIZE_MAX - header_size
+            || ftruncate(fd, (off_t) (header_size + pool_mgr->pool.total_size)) != 0){
+            return ALLOC_FAIL;
+        }
+    }
+    else{
+        // a private pool that is open, or was not closed, cannot be trusted
+        if (pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)
+            || memcmp(header.magic, MEM_FILE_MAGIC, sizeof(MEM_FILE_MAGIC)) != 0
+            || header.header_size != header_size || header.shared != pool_mgr->shared
+            || (header.open && !pool_mgr->shared)
+            || (size_t) st.st_size != header_size + header.pool.total_size){
+            return ALLOC_FAIL;
+        }
+        pool_mgr->pool.total_size = header.pool.total_size;
+        base = header.base;
+#ifdef MAP_FIXED_NOREPLACE
+        flags = MAP_FIXED_NOREPLACE;
+#endif
+    }
+
+    // a base that is taken now only costs the walk
+    map = (char *) mmap(base, header_size + pool_mgr->pool.total_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | flags, fd, 0);
+    if (map == MAP_FAILED && flags != 0){
+        map = (char *) mmap(NULL, header_size + pool_mgr->pool.total_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+    }
+    if (map == MAP_FAILED){
+        return ALLOC_FAIL;
+    }
+    pool_mgr->file = (file_header_pt) map;
+    pool_mgr->map_size = header_size + pool_mgr->pool.total_size;
+    pool_mgr->pool.mem = map + header_size;
+    pool_mgr->tag_ix = &pool_mgr->file->tag_ix;
+
+    if (st.st_size == 0){
+        if (pool_mgr->shared && _file_init_lock(pool_mgr->file) != ALLOC_OK){
+            munmap(map, pool_mgr->map_size);
+            pool_mgr->file = NULL;
+            return ALLOC_FAIL;
+        }
+        _tag_init_pool(pool_mgr);
+        pool_mgr->file->header_size = header_size;
+        pool_mgr->file->pool = pool_mgr->pool;
+        pool_mgr->file->pool.mem = NULL;
+        pool_mgr->file->root = MEM_TAG_NONE;
+        pool_mgr->file->shared = pool_mgr->shared;
+        memcpy(pool_mgr->file->magic, MEM_FILE_MAGIC, sizeof(MEM_FILE_MAGIC));
+    }
+    else if (pool_mgr->shared){
+        // the lock keeps the processes that have the pool open from closing it meanwhile
+        _mem_lock(pool_mgr);
+        attached = pool_mgr->file->open;
+        if (attached != 0 && map != base){
+            _mem_unlock(pool_mgr);
+            munmap(map, pool_mgr->map_size);
+            pool_mgr->file = NULL;
+            return ALLOC_FAIL;
+        }
+        if (map != base)
+            _tag_relocate(pool_mgr);
+        pool_mgr->file->base = map;
+        pool_mgr->file->open++;
+        _mem_unlock(pool_mgr);
+        return ALLOC_OK;
+    }
+    else{
+        pool_mgr->pool.alloc_size = header.pool.alloc_size;
+        pool_mgr->pool.num_allocs = header.pool.num_allocs;
+        pool_mgr->pool.num_gaps = header.pool.num_gaps;
+        if (map != base)
+            _tag_relocate(pool_mgr);
+    }
+    pool_mgr->file->base = map;
+    pool_mgr->file->open = 1;
+
+    return ALLOC_OK;
+}
+
+// opens (or creates) the file of a file-backed pool and maps it
+static alloc_status _file_open_pool(pool_mgr_pt pool_mgr, const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    alloc_status status;
+
+    if (fd < 0){
+        return ALLOC_FAIL;
+    }
+    // processes open (and create) the pool one at a time
+    flock(fd, LOCK_EX);
+    status = _file_map_pool(pool_mgr, fd);
+    flock(fd, LOCK_UN);
+    // the mapping keeps the file open
+    close(fd);
+
+    return status;
+}
+
+// saves the counters of a file-backed pool in its header, marks it closed
+// (or one process fewer for a shared pool, whose counters are there already),
+// and writes the mapping back to the file
+static void _file_close_pool(pool_mgr_pt pool_mgr) {
+    file_header_pt file = pool_mgr->file;
+
+    if (pool_mgr->shared){
+        _mem_lock(pool_mgr);
+        file->open--;
+        _mem_unlock(pool_mgr);
+    }
+    else{
+        file->pool = pool_mgr->pool;
+        file->pool.mem = NULL;
+        file->open = 0;
+    }
+    msync(file, pool_mgr->map_size, MS_SYNC);
+    munmap(file, pool_mgr->map_size);
+}
+
+
+
+/************************/
+/*                      */
+/* Slab pool primitives */
+/*                      */
+/************************/
+// A slab pool hands out fixed-size slots of its memory. Free slots are on a
+// stack linked through their first word, and slots past slab_unused have never
+// been used, so the stack is filled lazily and the pool memory is not touched
+// when the pool is opened. Each slot has an allocation record in slab_records
+// (there is no node heap), whose size is 0 while the slot is free. Every free
+// slot counts as a gap.
+
+static alloc_status _slab_init_pool(pool_mgr_pt pool_mgr, size_t obj_size) {
+    size_t slot_size = (obj_size < sizeof(char *)) ? sizeof(char *) : obj_size;
+    size_t num_slots;
+
+    // round the slot size up, so that the slots stay aligned for the links
+    if (obj_size == 0 || slot_size > SIZE_MAX - sizeof(char *)){
+        return ALLOC_FAIL;
+    }
+    slot_size = (slot_size + sizeof(char *) - 1) / sizeof(char *) * sizeof(char *);
+    num_slots = pool_mgr->pool.total_size / slot_size;
+    if (num_slots == 0 || num_slots > UINT_MAX){
+        return ALLOC_FAIL;
+    }
+
+    pool_mgr->slab_records = (alloc_pt) calloc(num_slots, sizeof(alloc_t));
+    if (pool_mgr->slab_records == NULL){
+        return ALLOC_FAIL;
+    }
+    pool_mgr->slab_size = slot_size;
+    pool_mgr->slab_slots = (unsigned) num_slots;
+    pool_mgr->slab_unused = 0;
+    pool_mgr->slab_free = NULL;
+    pool_mgr->pool.num_gaps = (unsigned) num_slots;
+
+    return ALLOC_OK;
+}
+
+static alloc_pt _slab_new_alloc(pool_mgr_pt pool_mgr, size_t size) {
+    char *slot;
+    alloc_pt record;
+
+    if (size > pool_mgr->slab_size){
+        return NULL;
+    }
+    if (pool_mgr->slab_free != NULL){
+        slot = pool_mgr->slab_free;
+        pool_mgr->slab_free = *(char **) slot;
+    }
+    else if (pool_mgr->slab_unused < pool_mgr->slab_slots){
+        slot = pool_mgr->pool.mem + (size_t) pool_mgr->slab_unused++ * pool_mgr->slab_size;
+    }
+    else{
+        return NULL;
+    }
+
+    record = &pool_mgr->slab_records[(size_t) (slot - pool_mgr->pool.mem) / pool_mgr->slab_size];
+    record->size = size;
+    record->mem = slot;
+
+    pool_mgr->pool.alloc_size += size;
+    pool_mgr->pool.num_allocs++;
+    pool_mgr->pool.num_gaps--;
+
+    return record;
+}
+
+static alloc_status _slab_del_alloc(pool_mgr_pt pool_mgr, alloc_pt record) {
+    if (record == NULL){
+        return ALLOC_FAIL;
+    }
+    pool_mgr->pool.alloc_size -= record->size;
+    pool_mgr->pool.num_allocs--;
+    pool_mgr->pool.num_gaps++;
+    record->size = 0;
+
+    *(char **) record->mem = pool_mgr->slab_free;
+    pool_mgr->slab_free = record->mem;
+
+    return ALLOC_OK;
+}
+
+// returns the record of the allocated slot starting at mem, or null if there is none
+static alloc_pt _slab_find_alloc(pool_mgr_pt pool_mgr, const char *mem) {
+    size_t offset;
+    alloc_pt record;
+
+    if (mem < pool_mgr->pool.mem){
+        return NULL;
+    }
+    offset = (size_t) (mem - pool_mgr->pool.mem);
+    if (offset % pool_mgr->slab_size != 0 || offset / pool_mgr->slab_size >= pool_mgr->slab_slots){
+        return NULL;
+    }
+    record = &pool_mgr->slab_records[offset / pool_mgr->slab_size];
+    return (record->size == 0) ? NULL : record;
+}
+
+// reports every slot as a segment; the tail of the pool memory that is too
+// small for a slot is left out
+static void _slab_inspect_pool(pool_mgr_pt pool_mgr,
+                               pool_segment_pt *segments,
+                               unsigned *num_segments) {
+    pool_segment_pt segs = (pool_segment_pt) calloc(pool_mgr->slab_slots, sizeof(pool_segment_t));
+
+    for (unsigned i = 0; segs != NULL && i < pool_mgr->slab_slots; i++){
+        segs[i].size = pool_mgr->slab_size;
+        // lock-free pools may be in use by other threads
+        segs[i].allocated = (__atomic_load_n(&pool_mgr->slab_records[i].size, __ATOMIC_RELAXED) != 0);
+    }
+    *segments = segs;
+    *num_segments = pool_mgr->slab_slots;
+}
+
+// A lock-free slab pool puts all of its slots on the free stack when it is
+// opened, since the lazy fill from slab_unused cannot be combined with the
+// stack in a single compare-and-swap. The links are slot indices in the
+// slab_next array rather than in the slots, so that a thread that is about
+// to lose a race never reads a slot that has been handed out. slab_head
+// holds the index of the top slot plus one (0: the stack is empty) in its
+// low half and a generation in its high half, which every push and pop
+// bumps, so a pop whose top was popped and pushed again in the meantime
+// fails its compare-and-swap (ABA). The pool counters are updated with
+// relaxed atomic adds, and are exact whenever no call is in progress.
+
+static alloc_status _slab_lf_init_pool(pool_mgr_pt pool_mgr) {
+    unsigned num_slots = pool_mgr->slab_slots;
+
+    // the top of the stack is stored as index plus one
+    if (num_slots >= UINT32_MAX){
+        return ALLOC_FAIL;
+    }
+    pool_mgr->slab_next = (uint32_t *) calloc(num_slots, sizeof(uint32_t));
+    if (pool_mgr->slab_next == NULL){
+        return ALLOC_FAIL;
+    }
+    for (unsigned i = 0; i < num_slots; i++){
+        pool_mgr->slab_next[i] = (i + 1 < num_slots) ? i + 2 : 0;
+        pool_mgr->slab_records[i].mem = pool_mgr->pool.mem + (size_t) i * pool_mgr->slab_size;
+    }
+    pool_mgr->slab_head = 1;
+    pool_mgr->slab_unused = num_slots;
+    pool_mgr->lock_free = 1;
+
+    return ALLOC_OK;
+}
+
+static alloc_pt _slab_lf_new_alloc(pool_mgr_pt pool_mgr, size_t size) {
+    uint64_t head, next;
+    uint32_t slot;
+
+    if (size == 0 || size > pool_mgr->slab_size){
+        return NULL;
+    }
+    head = __atomic_load_n(&pool_mgr->slab_head, __ATOMIC_ACQUIRE);
+    do {
+        if (MEM_SLAB_LF_TOP(head) == 0){
+            return NULL;
+        }
+        slot = MEM_SLAB_LF_TOP(head) - 1;
+        next = MEM_SLAB_LF_NEXT(head, __atomic_load_n(&pool_mgr->slab_next[slot], __ATOMIC_RELAXED));
+    } while (!__atomic_compare_exchange_n(&pool_mgr->slab_head, &head, next, 1,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    __atomic_store_n(&pool_mgr->slab_records[slot].size, size, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&pool_mgr->pool.alloc_size, size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pool_mgr->pool.num_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&pool_mgr->pool.num_gaps, 1, __ATOMIC_RELAXED);
+
+    return &pool_mgr->slab_records[slot];
+}
+
+static alloc_status _slab_lf_del_alloc(pool_mgr_pt pool_mgr, const char *mem) {
+    uint64_t head, next;
+    size_t offset, size;
+    uint32_t slot;
+
+    if (mem < pool_mgr->pool.mem){
+        return ALLOC_FAIL;
+    }
+    offset = (size_t) (mem - pool_mgr->pool.mem);
+    if (offset % pool_mgr->slab_size != 0 || offset / pool_mgr->slab_size >= pool_mgr->slab_slots){
+        return ALLOC_FAIL;
+    }
+    slot = (uint32_t) (offset / pool_mgr->slab_size);
+    // of two threads deallocating the same slot, only one gets its size
+    size = __atomic_exchange_n(&pool_mgr->slab_records[slot].size, 0, __ATOMIC_ACQ_REL);
+    if (size == 0){
+        return ALLOC_FAIL;
+    }
+    __atomic_fetch_sub(&pool_mgr->pool.alloc_size, size, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&pool_mgr->pool.num_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pool_mgr->pool.num_gaps, 1, __ATOMIC_RELAXED);
+
+    head = __atomic_load_n(&pool_mgr->slab_head, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&pool_mgr->slab_next[slot], MEM_SLAB_LF_TOP(head), __ATOMIC_RELAXED);
+        next = MEM_SLAB_LF_NEXT(head, slot + 1);
+    } while (!__atomic_compare_exchange_n(&pool_mgr->slab_head, &head, next, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    return ALLOC_OK;
+}
+
+
+
+/*************************/
+/*                       */
+/* Arena pool primitives */
+/*                       */
+/*************************/
+// An arena pool hands out its memory from the bottom up: an allocation moves
+// arena_top past the block, to the next multiple of MEM_ARENA_ALIGN, and a
+// deallocation does nothing. The memory only comes back all at once, when the
+// pool is reset to a mark or to empty (or closed). mem_new_alloc puts the
+// allocation record right before the block; the address API needs none. The
+// pool is one allocated segment below arena_top and one gap above it, and its
+// counters count the allocations made since the last reset.
+
+static alloc_status _arena_init_pool(pool_mgr_pt pool_mgr) {
+    pool_mgr->arena_top = 0;
+    pool_mgr->pool.num_gaps = 1;
+
+    return ALLOC_OK;
+}
+
+// bumps the top past a block of size bytes that follows header bytes
+static char *_arena_new_block(pool_mgr_pt pool_mgr, size_t size, size_t header) {
+    pool_pt pool = (pool_pt) pool_mgr;
+    size_t room = pool->total_size - pool_mgr->arena_top;
+    char *mem;
+
+    if (size == 0 || size > room || header > room - size){
+        return NULL;
+    }
+    mem = pool->mem + pool_mgr->arena_top + header;
+    pool_mgr->arena_top += header + size;
+    // the pool memory comes from malloc, so offsets and addresses align alike
+    if (pool_mgr->arena_top % MEM_ARENA_ALIGN != 0){
+        pool_mgr->arena_top += MEM_ARENA_ALIGN - pool_mgr->arena_top % MEM_ARENA_ALIGN;
+        if (pool_mgr->arena_top > pool->total_size)
+            pool_mgr->arena_top = pool->total_size;
+    }
+
+    pool->alloc_size += size;
+    pool->num_allocs++;
+    pool->num_gaps = (pool_mgr->arena_top < pool->total_size) ? 1 : 0;
+
+    return mem;
+}
+
+static alloc_pt _arena_new_alloc(pool_mgr_pt pool_mgr, size_t size) {
+    char *mem = _arena_new_block(pool_mgr, size, sizeof(alloc_t));
+    alloc_pt record;
+
+    if (mem == NULL){
+        return NULL;
+    }
+    record = (alloc_pt) (mem - sizeof(alloc_t));
+    record->size = size;
+    record->mem = mem;
+
+    return record;
+}
+
+// blocks are only released by a reset, so this just checks that mem is in use
+static alloc_status _arena_del_alloc(pool_mgr_pt pool_mgr, const char *mem) {
+    if (mem < pool_mgr->pool.mem || mem >= pool_mgr->pool.mem + pool_mgr->arena_top){
+        return ALLOC_FAIL;
+    }
+    return ALLOC_OK;
+}
+
+// resets the pool to a mark (one that is not past the current top), or to empty
+static alloc_status _arena_reset(pool_mgr_pt pool_mgr, const arena_mark_t *mark) {
+    pool_pt pool = (pool_pt) pool_mgr;
+    size_t old_top = pool_mgr->arena_top;
+
+    if (mark == NULL){
+        pool_mgr->arena_top = 0;
+        pool->alloc_size = 0;
+        pool->num_allocs = 0;
+    }
+    else{
+        if (mark->top > pool_mgr->arena_top || mark->num_allocs > pool->num_allocs){
             return ALLOC_FAIL;
+        }
+        pool_mgr->arena_top = mark->top;
+        pool->alloc_size = mark->alloc_size;
+        pool->num_allocs = mark->num_allocs;
+    }
+    pool->num_gaps = (pool_mgr->arena_top < pool->total_size) ? 1 : 0;
+    _mem_decommit(pool_mgr, pool->mem + pool_mgr->arena_top, pool->mem + pool->total_size,
+                  pool->mem + pool_mgr->arena_top, pool->mem + old_top);
+
+    return ALLOC_OK;
+}
+
+static void _arena_inspect_pool(pool_mgr_pt pool_mgr,
+                                pool_segment_pt *segments,
+                                unsigned *num_segments) {
+    pool_segment_pt segs = (pool_segment_pt) calloc(2, sizeof(pool_segment_t));
+    unsigned num_segs = 0;
+
+    if (segs != NULL && pool_mgr->arena_top > 0){
+        segs[num_segs].size = pool_mgr->arena_top;
+        segs[num_segs++].allocated = 1;
+    }
+    if (segs != NULL && pool_mgr->arena_top < pool_mgr->pool.total_size){
+        segs[num_segs].size = pool_mgr->pool.total_size - pool_mgr->arena_top;
+        segs[num_segs++].allocated = 0;
+    }
+    *segments = segs;
+    *num_segments = num_segs;
+}
+
+
+
+/*******************************/
+/*                             */
+/* Per-thread cache primitives */
+/*                             */
+/*******************************/
+// A thread-cached pool serves small requests from caches that each thread
+// keeps for itself, filled with the blocks the thread deallocates and with
+// batches taken from the pool, so that only refills and flushes take the pool
+// lock. A cached block is still allocated as far as the pool can tell.
+// Requests are rounded up to their size class, and the record of a block has
+// the size of the class. The pool kinds that can be cached have records that
+// never move (block headers, slab records), so a block is recognized and
+// sized from its record without the lock; a block deallocated twice is not
+// caught once it is in a cache.
+
+// thread exit: gives the blocks of all the thread's caches back to their pools
+static void _cache_destroy_list(void *head) {
+    mem_cache_pt cache = (mem_cache_pt) head;
+    mem_cache_pt next;
+
+    for (; cache != NULL; cache = next){
+        next = cache->next;
+        _cache_flush(cache);
+        free(cache);
+    }
+}
+
+static void _cache_make_key() {
+    cache_key_status = pthread_key_create(&cache_key, _cache_destroy_list);
+}
+
+// the calling thread's cache of the pool, created on first use if create is set;
+// a cache left over from a closed pool that had the same address is started
+// over, so that its stats (and any blocks of the closed pool) are forgotten
+static mem_cache_pt _cache_get(pool_mgr_pt pool_mgr, int create) {
+    mem_cache_pt head, cache;
+
+    if (pthread_once(&cache_key_once, _cache_make_key) != 0 || cache_key_status != 0){
+        return NULL;
+    }
+    head = (mem_cache_pt) pthread_getspecific(cache_key);
+    for (cache = head; cache != NULL; cache = cache->next){
+        if (cache->pool_mgr != pool_mgr)
+            continue;
+        if (cache->cache_id != pool_mgr->cache_id){
+            memset(cache->classes, 0, sizeof(cache->classes));
+            memset(&cache->stats, 0, sizeof(cache_stats_t));
+            cache->cache_id = pool_mgr->cache_id;
+        }
+        return cache;
+    }
+    if (!create){
+        return NULL;
+    }
+    cache = (mem_cache_pt) calloc(1, sizeof(mem_cache_t));
+    if (cache == NULL){
+        return NULL;
+    }
+    cache->pool_mgr = pool_mgr;
+    cache->cache_id = pool_mgr->cache_id;
+    cache->next = head;
+    if (pthread_setspecific(cache_key, cache) != 0){
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+// the size a request is rounded up to, or 0 if it bypasses the caches
+static size_t _cache_size(pool_mgr_pt pool_mgr, size_t req_size) {
+    if (req_size == 0){
+        return 0;
+    }
+    if (pool_mgr->kind == POOL_SLAB){
+        return (req_size <= pool_mgr->slab_size) ? pool_mgr->slab_size : 0;
+    }
+    if (req_size > MEM_CACHE_MAX_SIZE){
+        return 0;
+    }
+    return (req_size + MEM_CACHE_GRAIN - 1) / MEM_CACHE_GRAIN * MEM_CACHE_GRAIN;
+}
+
+static unsigned _cache_class(pool_mgr_pt pool_mgr, size_t size) {
+    return (pool_mgr->kind == POOL_SLAB) ? 0 : (unsigned) (size / MEM_CACHE_GRAIN - 1);
+}
+
+// returns the record of the block starting at mem if it is an allocation of
+// a cached size, or null; reads nothing but the record, which belongs to the
+// caller as long as mem is really its allocation
+static alloc_pt _cache_record(pool_mgr_pt pool_mgr, const char *mem) {
+    alloc_pt record;
+    size_t offset;
+
+    if (mem == NULL || mem < pool_mgr->pool.mem){
+        return NULL;
+    }
+    offset = (size_t) (mem - pool_mgr->pool.mem);
+    if (pool_mgr->kind == POOL_SLAB){
+        if (offset % pool_mgr->slab_size != 0 || offset / pool_mgr->slab_size >= pool_mgr->slab_slots){
+            return NULL;
+        }
+        record = &pool_mgr->slab_records[offset / pool_mgr->slab_size];
     }
-    return ALLOC_OK;
+    else{
+        if (offset < sizeof(tag_t) || mem >= _tag_end(pool_mgr) || (offset & MEM_TAG_FLAGS) != 0){
+            return NULL;
+        }
+        record = &((tag_pt) (mem - sizeof(tag_t)))->alloc_record;
+    }
+    if (record->mem != mem || record->size == 0 || _cache_size(pool_mgr, record->size) != record->size){
+        return NULL;
+    }
+    return record;
 }
 
-// checks to see if each entry of the gap index array is used,
-// if full returns alloc_fail otherwise returns alloc_ok
-static alloc_status _mem_resize_gap_ix(pool_mgr_pt pool_mgr) {
-    gap_pt gap_array = pool_mgr->gap_ix;
-    int array_full = 0;
+// gives up to count blocks of the class back to the pool, whose lock the
+// caller holds; returns how many it gave back
+static unsigned _cache_give_back(pool_mgr_pt pool_mgr, cache_class_pt cls, unsigned count) {
+    unsigned given = 0;
+    char *mem;
 
-    for (int i = 0; i < pool_mgr->gap_ix_capacity; i++){
-        if (gap_array[i].node == NULL){
-            array_full = 1;
-            break;
+    while (given < count && cls->head != NULL){
+        // unlink the block before it can become part of a gap
+        mem = cls->head;
+        cls->head = *(char **) mem;
+        cls->count--;
+        _mem_del_alloc(pool_mgr, mem);
+        given++;
+    }
+    return given;
+}
+
+// gives all the blocks of the cache back to the pool (which is not touched
+// if there are none, so that a thread can exit after the pool is closed)
+static void _cache_flush(mem_cache_pt cache) {
+    unsigned num_blocks = 0;
+
+    for (unsigned i = 0; i < MEM_CACHE_CLASSES; i++)
+        num_blocks += cache->classes[i].count;
+    if (num_blocks == 0){
+        return;
+    }
+    _mem_lock(cache->pool_mgr);
+    for (unsigned i = 0; i < MEM_CACHE_CLASSES; i++)
+        _cache_give_back(cache->pool_mgr, &cache->classes[i], cache->classes[i].count);
+    _mem_unlock(cache->pool_mgr);
+}
+
+// flushes the cache, takes it off the calling thread's list and frees it
+static void _cache_release(mem_cache_pt cache) {
+    mem_cache_pt head = (mem_cache_pt) pthread_getspecific(cache_key);
+
+    if (head == cache){
+        pthread_setspecific(cache_key, cache->next);
+    }
+    else{
+        while (head->next != cache)
+            head = head->next;
+        head->next = cache->next;
+    }
+    _cache_flush(cache);
+    free(cache);
+}
+
+static alloc_pt _cache_new_alloc(pool_mgr_pt pool_mgr, size_t req_size) {
+    size_t size = _cache_size(pool_mgr, req_size);
+    mem_cache_pt cache = (size == 0) ? NULL : _cache_get(pool_mgr, 1);
+    cache_class_pt cls;
+    alloc_pt alloc;
+    char *mem;
+
+    // requests that bypass the caches (and threads that could not get one) use the pool
+    if (cache == NULL){
+        _mem_lock(pool_mgr);
+        alloc = _mem_new_alloc(pool_mgr, (size == 0) ? req_size : size);
+        _mem_unlock(pool_mgr);
+        return alloc;
+    }
+
+    cls = &cache->classes[_cache_class(pool_mgr, size)];
+    if (cls->head != NULL){
+        cache->stats.alloc_hits++;
+    }
+    else{
+        // refill the class with a batch of blocks, under a single lock
+        cache->stats.alloc_misses++;
+        _mem_lock(pool_mgr);
+        for (unsigned i = 0; i < MEM_CACHE_BATCH; i++){
+            alloc = _mem_new_alloc(pool_mgr, size);
+            if (alloc == NULL)
+                break;
+            *(char **) alloc->mem = cls->head;
+            cls->head = alloc->mem;
+            cls->count++;
         }
+        _mem_unlock(pool_mgr);
+        if (cls->head == NULL){
+            return NULL;
+        }
+    }
+    mem = cls->head;
+    cls->head = *(char **) mem;
+    cls->count--;
+
+    return _cache_record(pool_mgr, mem);
+}
+
+static alloc_status _cache_del_alloc(pool_mgr_pt pool_mgr, char *mem) {
+    alloc_pt record = _cache_record(pool_mgr, mem);
+    mem_cache_pt cache = _cache_get(pool_mgr, record != NULL);
+    cache_class_pt cls;
+    alloc_status status;
+
+    // blocks that are not of a cached size are checked and deallocated by the pool
+    if (record == NULL || cache == NULL){
+        if (cache != NULL)
+            cache->stats.del_misses++;
+        _mem_lock(pool_mgr);
+        status = _mem_del_alloc(pool_mgr, mem);
+        _mem_unlock(pool_mgr);
+        return status;
+    }
+
+    cls = &cache->classes[_cache_class(pool_mgr, record->size)];
+    *(char **) mem = cls->head;
+    cls->head = mem;
+    cls->count++;
+    cache->stats.del_hits++;
+
+    // a full class gives a batch back to the pool
+    if (cls->count > MEM_CACHE_BOUND){
+        _mem_lock(pool_mgr);
+        cache->stats.flushed += _cache_give_back(pool_mgr, cls, MEM_CACHE_BATCH);
+        _mem_unlock(pool_mgr);
     }
-    if (array_full == 1)
+    return ALLOC_OK;
+}
+
+
+
+/***************************/
+/*                         */
+/* Sharded pool primitives */
+/*                         */
+/***************************/
+// A sharded pool splits its memory into consecutive arenas, each a node heap
+// pool of its own with its own lock, and sends every thread to one of them,
+// so that threads mostly allocate without contending. When a thread's arena
+// is full, the boundary with a neighboring arena is moved into the gap at
+// that end of the neighbor, which makes the stolen part a gap of the thread's
+// arena; failing that, the allocation is made in any arena that has room.
+// Boundaries only ever move through gaps, so an allocation stays in the arena
+// it was made in. The pool_t of a sharded pool sums up the arenas; it is
+// updated with relaxed atomic adds after every change to an arena.
+
+// allocates the arenas, each owning an equal part of the pool memory
+static alloc_status _shard_init_pool(pool_mgr_pt pool_mgr, unsigned num_shards) {
+    size_t total_size = pool_mgr->pool.total_size;
+    pool_mgr_pt arena;
+
+    pool_mgr->shards = (pool_mgr_pt *) calloc(num_shards, sizeof(pool_mgr_pt));
+    pool_mgr->shard_bounds = (size_t *) malloc((num_shards + 1) * sizeof(size_t));
+    if (pool_mgr->shards == NULL || pool_mgr->shard_bounds == NULL){
+        _shard_free(pool_mgr);
         return ALLOC_FAIL;
-    else
-        return ALLOC_OK;
+    }
+    pool_mgr->num_shards = num_shards;
+    for (unsigned i = 0; i < num_shards; i++)
+        pool_mgr->shard_bounds[i] = total_size / num_shards * i;
+    pool_mgr->shard_bounds[num_shards] = total_size;
+
+    for (unsigned i = 0; i < num_shards; i++){
+        arena = (pool_mgr_pt) calloc(1, sizeof(pool_mgr_t));
+        if (arena == NULL){
+            _shard_free(pool_mgr);
+            return ALLOC_FAIL;
+        }
+        pool_mgr->shards[i] = arena;
+        arena->pool.mem = pool_mgr->pool.mem + pool_mgr->shard_bounds[i];
+        arena->pool.total_size = pool_mgr->shard_bounds[i + 1] - pool_mgr->shard_bounds[i];
+        arena->pool.policy = pool_mgr->pool.policy;
+        arena->kind = POOL_NODE_HEAP;
+        arena->decommit = pool_mgr->decommit;
+        if (_mem_init_node_heap(arena) != ALLOC_OK || pthread_mutex_init(&arena->lock, NULL) != 0){
+            _shard_free(pool_mgr);
+            return ALLOC_FAIL;
+        }
+        arena->thread_safe = 1;
+    }
+    pool_mgr->pool.num_gaps = num_shards;
+
+    return ALLOC_OK;
 }
 
-static alloc_status _mem_add_to_gap_ix(pool_mgr_pt pool_mgr,
-                                       size_t size,
-                                       node_pt node) {
-    // expand the gap index, if necessary
-    _mem_resize_gap_ix(pool_mgr);
-
-    // add the entry at the end
-    int i = 0;
-    gap_pt gap_array = pool_mgr->gap_ix;
-    while (i < (pool_mgr->gap_ix_capacity)){
-        if (gap_array[i].size == 0){
-            gap_array[i].size = size;
-            gap_array[i].node = node;
-            i = pool_mgr->gap_ix_capacity;
+// frees the arenas (but not the pool memory, which belongs to the sharded pool)
+static void _shard_free(pool_mgr_pt pool_mgr) {
+    for (unsigned i = 0; i < pool_mgr->num_shards; i++){
+        if (pool_mgr->shards[i] != NULL){
+            pool_mgr->shards[i]->pool.mem = NULL;
+            _mem_free_pool_mgr(pool_mgr->shards[i]);
         }
-        else
-            i++;
     }
-    // update metadata (num_gaps)
-    ((pool_pt) pool_mgr)->num_gaps++;
-    // sort the gap index
-    _mem_sort_gap_ix(pool_mgr);
-    // check success
+    free(pool_mgr->shards);
+    free(pool_mgr->shard_bounds);
+    pool_mgr->shards = NULL;
+    pool_mgr->shard_bounds = NULL;
+    pool_mgr->num_shards = 0;
+}
+
+// the arena of the calling thread; threads get the arenas in turn
+static unsigned _shard_of_thread(pool_mgr_pt pool_mgr) {
+    unsigned shard;
+
+    for (unsigned i = 0; i < MEM_SHARD_HINTS; i++){
+        if (shard_hints[i].pool_mgr == pool_mgr && shard_hints[i].shard < pool_mgr->num_shards)
+            return shard_hints[i].shard;
+    }
+    shard = __atomic_fetch_add(&pool_mgr->next_shard, 1, __ATOMIC_RELAXED) % pool_mgr->num_shards;
+    shard_hints[shard_hint_next].pool_mgr = pool_mgr;
+    shard_hints[shard_hint_next].shard = shard;
+    shard_hint_next = (shard_hint_next + 1) % MEM_SHARD_HINTS;
+
+    return shard;
+}
+
+// adds what has changed in the arena since before to the sharded (or NUMA-local) pool's
+// counters; the caller holds the arena lock
+static void _shard_account(pool_mgr_pt pool_mgr, pool_mgr_pt arena, const pool_t *before) {
+    if (arena->pool.alloc_size != before->alloc_size)
+        __atomic_fetch_add(&pool_mgr->pool.alloc_size,
+                           arena->pool.alloc_size - before->alloc_size, __ATOMIC_RELAXED);
+    if (arena->pool.num_allocs != before->num_allocs)
+        __atomic_fetch_add(&pool_mgr->pool.num_allocs,
+                           arena->pool.num_allocs - before->num_allocs, __ATOMIC_RELAXED);
+    if (arena->pool.num_gaps != before->num_gaps)
+        __atomic_fetch_add(&pool_mgr->pool.num_gaps,
+                           arena->pool.num_gaps - before->num_gaps, __ATOMIC_RELAXED);
+}
+
+// the last node of an arena; a walk of the node list, but only for steals
+static node_pt _shard_tail(pool_mgr_pt arena) {
+    node_pt node = arena->node_heap;
+
+    while (node->next != NULL)
+        node = node->next;
+    return node;
+}
+
+// moves the boundary between neighboring arenas from and to, so that to gets
+// at least size bytes (and up to half) of the gap at from's end next to it;
+// the caller holds the locks of both arenas
+static alloc_status _shard_steal(pool_mgr_pt pool_mgr, unsigned to, unsigned from, size_t size) {
+    pool_mgr_pt to_arena = pool_mgr->shards[to];
+    pool_mgr_pt from_arena = pool_mgr->shards[from];
+    node_pt gap, end;
+    size_t take;
+
+    // the head node of an arena is always node_heap[0], so a gap can only be
+    // handed down when the arena above starts with a gap that it can grow
+    gap = (to < from) ? from_arena->node_heap : _shard_tail(from_arena);
+    end = (to < from) ? NULL : to_arena->node_heap;
+    if (gap->allocated || gap->alloc_record.size <= size || (end != NULL && end->allocated)){
+        return ALLOC_FAIL;
+    }
+    if (to < from && _mem_resize_node_heap(to_arena) != ALLOC_OK){
+        return ALLOC_FAIL;
+    }
+    take = (gap->alloc_record.size / 2 > size) ? gap->alloc_record.size / 2 : size;
+
+    // shrink the gap of the arena that gives
+    _mem_remove_from_gap_ix(from_arena, gap->alloc_record.size, gap);
+    gap->alloc_record.size -= take;
+    if (to < from){
+        gap->alloc_record.mem += take;
+        from_arena->pool.mem += take;
+    }
+    _mem_add_to_gap_ix(from_arena, gap->alloc_record.size, gap);
+    from_arena->pool.total_size -= take;
+
+    // and grow the end of the arena that takes
+    if (to < from){
+        end = _shard_tail(to_arena);
+        if (end->allocated){
+            node_pt new_gap = _mem_acquire_node(to_arena);
+
+            new_gap->alloc_record.mem = to_arena->pool.mem + to_arena->pool.total_size;
+            new_gap->alloc_record.size = 0;
+            new_gap->allocated = 0;
+            insert_node_heap(end, new_gap);
+            end = new_gap;
+        }
+        else{
+            _mem_remove_from_gap_ix(to_arena, end->alloc_record.size, end);
+        }
+    }
+    else{
+        _mem_remove_from_gap_ix(to_arena, end->alloc_record.size, end);
+        end->alloc_record.mem -= take;
+        to_arena->pool.mem -= take;
+    }
+    end->alloc_record.size += take;
+    _mem_add_to_gap_ix(to_arena, end->alloc_record.size, end);
+    to_arena->pool.total_size += take;
+
+    // the boundary is where the upper of the two arenas starts
+    __atomic_store_n(&pool_mgr->shard_bounds[(to < from) ? from : to],
+                     (size_t) (((to < from) ? from_arena : to_arena)->pool.mem - pool_mgr->pool.mem),
+                     __ATOMIC_RELAXED);
 
     return ALLOC_OK;
 }
 
+// allocates in one arena (or in the pool of one node of a NUMA-local pool)
+static alloc_pt _shard_try_alloc(pool_mgr_pt pool_mgr, pool_mgr_pt arena, size_t size, char **mem) {
+    pool_t before;
+    alloc_pt alloc;
 
-// find gap index node
-//    gap_pt gap_index = NULL;
-//    gap_pt gap_array = pool_mgr->gap_ix;
-//    for (int i = 0; i < pool_mgr->gap_ix_capacity; i++){
-//        if (gap_array[i].node == alloc_node){
-//            gap_index = &gap_array[i];
-//        }
-//    }
-//    gap_index->size = 0;
-//    gap_index->node = NULL;
-//    _mem_sort_gap_ix(pool_mgr);
+    _mem_lock(arena);
+    before = arena->pool;
+    alloc = _mem_new_alloc(arena, size);
+    if (alloc != NULL && mem != NULL)
+        *mem = alloc->mem;
+    _shard_account(pool_mgr, arena, &before);
+    _mem_unlock(arena);
 
-static alloc_status _mem_remove_from_gap_ix(pool_mgr_pt pool_mgr,
-                                            size_t size,
-                                            node_pt alloc_node) {
+    return alloc;
+}
 
-    // find the position of the node in the gap index
-    // loop from there to the end of the array:
-    //    pull the entries (i.e. copy over) one position up
-    //    this effectively deletes the chosen node
-    // update metadata (num_gaps)
-    // zero out the element at position num_gaps!
-    gap_pt gap_array = pool_mgr->gap_ix;
-    int found = 0;
-    for (int i = 0; i < pool_mgr->gap_ix_capacity-1; i++) {
-        if (gap_array[i].node == alloc_node) {
-            found = 1;
+// allocates in the calling thread's arena; the address is read into mem
+// (if given) while the arena is still locked
+static alloc_pt _shard_new_alloc(pool_mgr_pt pool_mgr, size_t size, char **mem) {
+    unsigned shard = _shard_of_thread(pool_mgr);
+    unsigned neighbors[2] = { shard + 1, shard - 1 }; // the latter wraps around for arena 0
+    pool_mgr_pt arena = pool_mgr->shards[shard];
+    pool_mgr_pt lower, upper;
+    pool_t arena_before, neighbor_before;
+    alloc_pt alloc;
+
+    if (mem != NULL)
+        *mem = NULL;
+    alloc = _shard_try_alloc(pool_mgr, arena, size, mem);
+    if (alloc != NULL || size == 0){
+        return alloc;
+    }
+
+    // the arena is full: steal from a neighbor, locking the two in address order
+    for (unsigned i = 0; i < 2 && alloc == NULL; i++){
+        if (neighbors[i] >= pool_mgr->num_shards)
+            continue;
+        lower = pool_mgr->shards[(shard < neighbors[i]) ? shard : neighbors[i]];
+        upper = pool_mgr->shards[(shard < neighbors[i]) ? neighbors[i] : shard];
+        _mem_lock(lower);
+        _mem_lock(upper);
+        arena_before = arena->pool;
+        neighbor_before = pool_mgr->shards[neighbors[i]]->pool;
+        // somebody may have made room in the meantime
+        alloc = _mem_new_alloc(arena, size);
+        if (alloc == NULL && _shard_steal(pool_mgr, shard, neighbors[i], size) == ALLOC_OK)
+            alloc = _mem_new_alloc(arena, size);
+        if (alloc != NULL && mem != NULL)
+            *mem = alloc->mem;
+        _shard_account(pool_mgr, arena, &arena_before);
+        _shard_account(pool_mgr, pool_mgr->shards[neighbors[i]], &neighbor_before);
+        _mem_unlock(upper);
+        _mem_unlock(lower);
+    }
+
+    // or else make the allocation in whichever arena has room
+    for (unsigned i = 1; i < pool_mgr->num_shards && alloc == NULL; i++)
+        alloc = _shard_try_alloc(pool_mgr, pool_mgr->shards[(shard + i) % pool_mgr->num_shards], size, mem);
+
+    return alloc;
+}
+
+static alloc_status _shard_del_alloc(pool_mgr_pt pool_mgr, const char *mem) {
+    pool_mgr_pt arena;
+    pool_t before;
+    alloc_status status;
+    size_t offset;
+    unsigned lo, hi, mid;
+
+    if (mem < pool_mgr->pool.mem || mem >= pool_mgr->pool.mem + pool_mgr->pool.total_size){
+        return ALLOC_FAIL;
+    }
+    offset = (size_t) (mem - pool_mgr->pool.mem);
+    for (;;){
+        // the last arena starting at or before mem
+        lo = 0;
+        hi = pool_mgr->num_shards;
+        while (hi - lo > 1){
+            mid = lo + (hi - lo) / 2;
+            if (__atomic_load_n(&pool_mgr->shard_bounds[mid], __ATOMIC_RELAXED) <= offset)
+                lo = mid;
+            else
+                hi = mid;
         }
-        if (found == 1) {
-            gap_array[i] = gap_array[i + 1];
+        arena = pool_mgr->shards[lo];
+        _mem_lock(arena);
+        if (mem >= arena->pool.mem && mem < arena->pool.mem + arena->pool.total_size)
+            break;
+        // a steal has moved the boundary since it was read
+        _mem_unlock(arena);
+    }
+    before = arena->pool;
+    status = _mem_del_alloc(arena, mem);
+    _shard_account(pool_mgr, arena, &before);
+    _mem_unlock(arena);
+
+    return status;
+}
+
+// reports the segments of all arenas in address order; adjacent arenas may
+// both have a gap at their boundary
+static void _shard_inspect_pool(pool_mgr_pt pool_mgr,
+                                pool_segment_pt *segments,
+                                unsigned *num_segments) {
+    pool_segment_pt segs, arena_segs;
+    unsigned num_segs = 0, num_arena_segs;
+
+    for (unsigned i = 0; i < pool_mgr->num_shards; i++){
+        _mem_lock(pool_mgr->shards[i]);
+        num_segs += pool_mgr->shards[i]->used_nodes;
+    }
+    segs = (pool_segment_pt) calloc(num_segs, sizeof(pool_segment_t));
+    num_segs = 0;
+    for (unsigned i = 0; i < pool_mgr->num_shards; i++){
+        _mem_inspect_node_heap(pool_mgr->shards[i], &arena_segs, &num_arena_segs);
+        if (segs != NULL && arena_segs != NULL)
+            memcpy(segs + num_segs, arena_segs, num_arena_segs * sizeof(pool_segment_t));
+        num_segs += num_arena_segs;
+        free(arena_segs);
+        _mem_unlock(pool_mgr->shards[i]);
+    }
+    *segments = segs;
+    *num_segments = num_segs;
+}
+
+
+
+/************************/
+/*                      */
+/* NUMA pool primitives */
+/*                      */
+/************************/
+// A NUMA-bound pool has its memory mapped with an mbind policy, so that its
+// pages are faulted in on one node. A NUMA-local pool is made of one
+// thread-safe pool per online node, each bound to its node and owning an
+// equal part of the size; a thread allocates in the pool of the node it runs
+// on, falling back to the other nodes in turn, and a block is given back to
+// the pool whose memory holds it. The node of a thread is looked up with
+// getcpu every MEM_NUMA_RECHECK allocations, since threads migrate. As for a
+// sharded pool, the pool_t sums up the pools of the nodes; its mem is null.
+// On a machine (or a kernel) without NUMA, there is just node 0: binding to
+// it is a no-op, and a NUMA-local pool is a single thread-safe pool.
+
+// the mask of the online nodes, node 0 alone if the kernel does not list them
+static uint64_t _numa_online(void) {
+    FILE *file = fopen("/sys/devices/system/node/online", "r");
+    uint64_t online = 0;
+    unsigned first, last;
+    int sep;
+
+    // a list of ranges, like "0-1,4"
+    while (file != NULL && fscanf(file, "%u", &first) == 1){
+        last = first;
+        sep = fgetc(file);
+        if (sep == '-' && fscanf(file, "%u", &last) == 1)
+            sep = fgetc(file);
+        for (unsigned node = first; node <= last && node < MEM_NUMA_MAX_NODES; node++)
+            online |= (uint64_t) 1 << node;
+        if (sep != ',')
+            break;
+    }
+    if (file != NULL)
+        fclose(file);
+
+    return (online == 0) ? 1 : online;
+}
+
+// binds the pages of [mem, mem + size) to a node; a kernel without NUMA
+// support, or a sandbox that does not let the call through, leaves them
+// where they fall, as a single-node machine would
+static alloc_status _numa_bind(char *mem, size_t size, unsigned node) {
+    unsigned long mask[MEM_NUMA_MAX_NODES / (CHAR_BIT * sizeof(unsigned long))] = { 0 };
+    unsigned bits = CHAR_BIT * sizeof(unsigned long);
+
+    mask[node / bits] = 1UL << (node % bits);
+#ifdef SYS_mbind
+    // the kernel reads one bit less than it is told
+    if (syscall(SYS_mbind, mem, size, MEM_NUMA_MPOL_BIND, mask, MEM_NUMA_MAX_NODES + 1UL, 0UL) != 0
+        && errno != ENOSYS && errno != EPERM){
+        return ALLOC_FAIL;
+    }
+#else
+    (void) mem;
+    (void) size;
+#endif
+    return ALLOC_OK;
+}
+
+// the node the calling thread runs on, as of its last lookup
+static unsigned _numa_of_thread(void) {
+    unsigned cpu, node;
+
+    if (numa_thread_calls++ % MEM_NUMA_RECHECK == 0){
+        numa_thread_node = 0;
+#ifdef SYS_getcpu
+        if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+            numa_thread_node = node;
+#else
+        (void) cpu;
+        (void) node;
+#endif
+    }
+    return numa_thread_node;
+}
+
+// opens a pool bound to each online node, with the options of the NUMA-local pool
+static pool_mgr_pt _numa_open_pool(size_t size, const pool_opts_t *opts) {
+    uint64_t online = _numa_online();
+    unsigned num_online = (unsigned) __builtin_popcountll((unsigned long long) online);
+    pool_opts_t node_opts = *opts;
+    pool_mgr_pt pool_mgr, node_pool;
+    size_t node_size;
+
+    if (size < num_online){
+        return NULL;
+    }
+    pool_mgr = (pool_mgr_pt) calloc(1, sizeof(pool_mgr_t));
+    if (pool_mgr == NULL){
+        return NULL;
+    }
+    pool_mgr->num_nodes = 64 - (unsigned) __builtin_clzll((unsigned long long) online);
+    pool_mgr->nodes = (pool_mgr_pt *) calloc(pool_mgr->num_nodes, sizeof(pool_mgr_pt));
+    if (pool_mgr->nodes == NULL){
+        free(pool_mgr);
+        return NULL;
+    }
+    pool_mgr->pool.total_size = size;
+    pool_mgr->pool.policy = opts->policy;
+    pool_mgr->kind = opts->kind;
+    pool_mgr->opts = *opts;
+
+    node_opts.numa_local = 0;
+    node_opts.numa_bind = 1;
+    node_opts.thread_safe = 1;
+    for (unsigned node = 0, i = 0; node < pool_mgr->num_nodes; node++){
+        if (((online >> node) & 1) == 0)
+            continue;
+        // the last node also gets what does not divide evenly
+        node_size = size / num_online + ((++i == num_online) ? size % num_online : 0);
+        node_opts.numa_node = node;
+        node_pool = _mem_new_pool_mgr(node_size, &node_opts);
+        if (node_pool == NULL){
+            _mem_free_pool_mgr(pool_mgr);
+            return NULL;
         }
+        pool_mgr->nodes[node] = node_pool;
+        pool_mgr->pool.num_gaps += node_pool->pool.num_gaps;
     }
-    if (found == 1) {
-        int last_entry = ((pool_pt) pool_mgr)->num_gaps;
-        ((pool_pt) pool_mgr)->num_gaps--;
-        gap_array[last_entry].size = 0;
-        gap_array[last_entry].node = NULL;
-        return ALLOC_OK;
+
+    return pool_mgr;
+}
+
+// the pool of the node whose memory holds mem, or null
+static pool_mgr_pt _numa_pool_of(pool_mgr_pt pool_mgr, const char *mem) {
+    pool_mgr_pt node_pool;
+
+    for (unsigned i = 0; i < pool_mgr->num_nodes; i++){
+        node_pool = pool_mgr->nodes[i];
+        if (node_pool != NULL && mem >= node_pool->pool.mem
+            && mem < node_pool->pool.mem + node_pool->pool.total_size)
+            return node_pool;
     }
-    else
+    return NULL;
+}
+
+// allocates on the calling thread's node, or else on the nearest node by id
+// that has room; the address is read into mem (if given) under the lock
+static alloc_pt _numa_new_alloc(pool_mgr_pt pool_mgr, size_t size, char **mem) {
+    unsigned node = _numa_of_thread();
+    pool_mgr_pt node_pool;
+    alloc_pt alloc = NULL;
+
+    if (mem != NULL)
+        *mem = NULL;
+    for (unsigned i = 0; i < pool_mgr->num_nodes && alloc == NULL; i++){
+        node_pool = pool_mgr->nodes[(node + i) % pool_mgr->num_nodes];
+        if (node_pool != NULL)
+            alloc = _shard_try_alloc(pool_mgr, node_pool, size, mem);
+    }
+    return alloc;
+}
+
+static alloc_status _numa_del_alloc(pool_mgr_pt pool_mgr, const char *mem) {
+    pool_mgr_pt node_pool = _numa_pool_of(pool_mgr, mem);
+    alloc_status status;
+    pool_t before;
+
+    if (node_pool == NULL){
         return ALLOC_FAIL;
+    }
+    _mem_lock(node_pool);
+    before = node_pool->pool;
+    status = _mem_del_alloc(node_pool, mem);
+    _shard_account(pool_mgr, node_pool, &before);
+    _mem_unlock(node_pool);
+
+    return status;
+}
+
+// resizes a block in the pool of its node (where a moved block stays too)
+static char *_numa_realloc(pool_mgr_pt pool_mgr, char *mem, size_t size) {
+    pool_mgr_pt node_pool = _numa_pool_of(pool_mgr, mem);
+    char *new_mem;
+    pool_t before;
 
+    if (node_pool == NULL){
+        return NULL;
+    }
+    _mem_lock(node_pool);
+    before = node_pool->pool;
+    new_mem = _mem_realloc(node_pool, mem, size);
+    _shard_account(pool_mgr, node_pool, &before);
+    _mem_unlock(node_pool);
+
+    return new_mem;
 }
 
-// note: only called by _mem_add_to_gap_ix, which appends a single entry
-static alloc_status _mem_sort_gap_ix(pool_mgr_pt pool_mgr) {
-    // the new entry is at the end, so "bubble it up"
-    // loop from num_gaps - 1 until but not including 0:
-    //    if the size of the current entry is less than the previous (u - 1)
-    //    or if the sizes are the same but the current entry points to a
-    //    node with a lower address of pool allocation address (mem)
-    //       swap them (by copying) (remember to use a temporary variable)
-    gap_pt gap_array = pool_mgr->gap_ix;
-    for (int i = pool_mgr->pool.num_gaps-1; i > 0; i--){
-        if (gap_array[i].size < gap_array[i-1].size){
-            size_t temp_size = gap_array[i].size;
-            node_pt temp_node = gap_array[i].node;
-            gap_array[i].size = gap_array[i-1].size;
-            gap_array[i].node = gap_array[i-1].node;
-            gap_array[i-1].size = temp_size;
-            gap_array[i-1].node = temp_node;
+// reports the segments of the pools of all nodes, node by node
+static void _numa_inspect_pool(pool_mgr_pt pool_mgr,
+                               pool_segment_pt *segments,
+                               unsigned *num_segments) {
+    pool_segment_pt segs = NULL, node_segs, grown;
+    unsigned num_segs = 0, num_node_segs;
+
+    for (unsigned i = 0; i < pool_mgr->num_nodes; i++){
+        if (pool_mgr->nodes[i] == NULL)
+            continue;
+        mem_inspect_pool((pool_pt) pool_mgr->nodes[i], &node_segs, &num_node_segs);
+        grown = (pool_segment_pt) realloc(segs, (num_segs + num_node_segs) * sizeof(pool_segment_t));
+        if (grown != NULL && node_segs != NULL){
+            memcpy(grown + num_segs, node_segs, num_node_segs * sizeof(pool_segment_t));
+            segs = grown;
+            num_segs += num_node_segs;
         }
+        else if (grown != NULL){
+            segs = grown;
+        }
+        free(node_segs);
+    }
+    *segments = segs;
+    *num_segments = num_segs;
+}
+
+
+
+/**********************************/
+/*                                */
+/* Remote deallocation primitives */
+/*                                */
+/**********************************/
+// A remote-free pool belongs to the thread that opened it. Other threads do
+// not deallocate in the pool, which would contend with the owner (or corrupt
+// a pool that is not thread-safe), but push the block onto a lock-free stack,
+// linked through the first bytes of the blocks. Pushing is a compare-and-swap
+// and taking is an exchange of the whole stack, so there is no ABA problem.
+// The next allocation takes the stack and deallocates all of it, under a
+// single acquisition of the pool lock if the pool has one. A node heap pool
+// other than BUDDY hands the whole stack to _mem_del_alloc_batch, which marks
+// the blocks and coalesces them in one sweep of the node list; buddy,
+// boundary-tag and slab pools deallocate the blocks one at a time. A queued
+// address is only checked against the pool range; the rest of the checks
+// happen when it is deallocated, and a bad address is then dropped.
+
+static alloc_status _remote_push(pool_mgr_pt pool_mgr, char *mem) {
+    char *head;
+
+    if (mem == NULL || mem < pool_mgr->pool.mem || mem >= pool_mgr->pool.mem + pool_mgr->pool.total_size){
+        return ALLOC_FAIL;
     }
+    head = __atomic_load_n(&pool_mgr->remote_frees, __ATOMIC_RELAXED);
+    do {
+        // allocations may be unaligned, hence memcpy
+        memcpy(mem, &head, sizeof(char *));
+    } while (!__atomic_compare_exchange_n(&pool_mgr->remote_frees, &head, mem, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
     return ALLOC_OK;
 }
 
-static void insert_node_heap(node_pt first_node, node_pt insert_node) {
-    insert_node->next = first_node->next;
-    if (insert_node->next != NULL) {
-        insert_node->next->prev = insert_node;
+// deallocates the queued blocks; the caller is the owner, or holds the pool lock
+static void _remote_drain(pool_mgr_pt pool_mgr) {
+    char *mem, *next, **mems = NULL;
+    unsigned n = 0;
+
+    if (pool_mgr->remote_free == 0
+        || __atomic_load_n(&pool_mgr->remote_frees, __ATOMIC_RELAXED) == NULL){
+        return;
+    }
+    mem = __atomic_exchange_n(&pool_mgr->remote_frees, NULL, __ATOMIC_ACQUIRE);
+    if (pool_mgr->kind == POOL_NODE_HEAP && ((pool_pt) pool_mgr)->policy != BUDDY){
+        for (next = mem; next != NULL; n++)
+            memcpy(&next, next, sizeof(char *));
+        if (n > 1)
+            mems = (char **) malloc(n * sizeof(char *));
+    }
+    if (mems != NULL){
+        // all links are read before the first block becomes part of a gap
+        for (unsigned i = 0; i < n; i++){
+            mems[i] = mem;
+            memcpy(&mem, mem, sizeof(char *));
+        }
+        _mem_del_alloc_batch(pool_mgr, mems, n);
+        free(mems);
+        return;
+    }
+    // buddy, boundary-tag and slab pools (or no memory for the address list)
+    for (; mem != NULL; mem = next){
+        // the link has to be read before the block becomes part of a gap
+        memcpy(&next, mem, sizeof(char *));
+        _mem_del_alloc(pool_mgr, mem);
     }
-    first_node->next = insert_node;
-    insert_node->prev = first_node;
 }
 
-static node_pt merge_gaps(pool_mgr_pt pool_mgr, node_pt first_node, node_pt next_node){
-    assert(first_node->allocated == 0);
-    assert(next_node->allocated == 0);
-    // remove both nodes from gap index
-    alloc_status status;
-    status = _mem_remove_from_gap_ix(pool_mgr, next_node->alloc_record.size, next_node);
-    //assert(status == ALLOC_OK);
-    status = _mem_remove_from_gap_ix(pool_mgr, first_node->alloc_record.size, first_node);
-    //assert(status == ALLOC_OK);
-    //   check success
-    //   add the size to the node-to-delete
-    //   update node as unused
-    //   update metadata (used nodes)
-    first_node->alloc_record.size += next_node->alloc_record.size;
-    next_node->allocated = 0;
-    next_node->alloc_record.size = 0;
-    next_node->alloc_record.mem = NULL;
 
-    next_node->used = 0;
-    pool_mgr->used_nodes--;
-    // update node list
-    if (next_node->next != NULL){
-        first_node->next = next_node->next;
-        next_node->next->prev = first_node;
+
+/**************************/
+/*                        */
+/* Handle pool primitives */
+/*                        */
+/**************************/
+// A handle pool keeps a table that maps each handle to the node heap index of
+// its block, which neither node heap resizing nor compaction changes (but for
+// the first node, see _handle_compact). Blocks with a handle are not in the
+// address map, so that they cannot be deallocated or resized by an address
+// that may have gone stale.
+
+static alloc_status _handle_init_pool(pool_mgr_pt pool_mgr) {
+    pool_mgr->handles = (unsigned *) malloc(MEM_HANDLES_INIT_CAPACITY * sizeof(unsigned));
+    if (pool_mgr->handles == NULL)
+        return ALLOC_FAIL;
+    pool_mgr->handle_capacity = MEM_HANDLES_INIT_CAPACITY;
+    pool_mgr->num_handles = 0;
+    pool_mgr->free_handle = 0;
+    return ALLOC_OK;
+}
+
+// returns the allocation node of a handle, or null if the handle is not in use
+static node_pt _handle_find(pool_mgr_pt pool_mgr, alloc_handle_t handle) {
+    if (handle == 0 || handle > pool_mgr->num_handles || (pool_mgr->handles[handle - 1] & MEM_HANDLE_FREE))
+        return NULL;
+    return &pool_mgr->node_heap[pool_mgr->handles[handle - 1]];
+}
+
+// allocates size bytes as a block that may move, and returns its handle (0 on failure)
+static alloc_handle_t _handle_new_alloc(pool_mgr_pt pool_mgr, size_t size) {
+    alloc_handle_t handle = pool_mgr->free_handle;
+    node_pt node;
+
+    // a free handle is reused, or else the next one is handed out
+    if (handle == 0 && pool_mgr->num_handles == pool_mgr->handle_capacity){
+        unsigned new_capacity = pool_mgr->handle_capacity * MEM_HANDLES_EXPAND_FACTOR;
+        unsigned *new_handles;
+
+        if (new_capacity >= MEM_HANDLE_FREE)
+            return 0;
+        new_handles = (unsigned *) realloc(pool_mgr->handles, new_capacity * sizeof(unsigned));
+        if (new_handles == NULL)
+            return 0;
+        pool_mgr->handles = new_handles;
+        pool_mgr->handle_capacity = new_capacity;
     }
-    else{
-        first_node->next = NULL;
+    node = (node_pt) _mem_new_alloc(pool_mgr, size);
+    if (node == NULL)
+        return 0;
+    if (handle != 0)
+        pool_mgr->free_handle = pool_mgr->handles[handle - 1] & ~MEM_HANDLE_FREE;
+    else
+        handle = ++pool_mgr->num_handles;
+
+    _mem_remove_from_addr_map(pool_mgr, node);
+    node->handle = handle;
+    pool_mgr->handles[handle - 1] = (unsigned) (node - pool_mgr->node_heap);
+
+    return handle;
+}
+
+// deallocates the block of a handle, unless it is pinned, and frees the handle
+static alloc_status _handle_del_alloc(pool_mgr_pt pool_mgr, alloc_handle_t handle) {
+    node_pt node = _handle_find(pool_mgr, handle);
+
+    if (node == NULL || node->pins != 0)
+        return ALLOC_FAIL;
+    pool_mgr->handles[handle - 1] = MEM_HANDLE_FREE | pool_mgr->free_handle;
+    pool_mgr->free_handle = handle;
+
+    return _mem_del_node(pool_mgr, node);
+}
+
+// Slides every block with a handle that is not pinned down to the end of the
+// block before it, in address order. Pinned blocks and blocks allocated by
+// address stay where they are, so the gaps left are those in front of such
+// blocks, and one at the end of the pool. The gaps are taken out of the index
+// and the list while the blocks move, and put back after; since a gap is only
+// left where there was one before, the nodes they free are enough for them.
+static alloc_status _handle_compact(pool_mgr_pt pool_mgr) {
+    pool_pt pool = (pool_pt) pool_mgr;
+    node_pt head = pool_mgr->node_heap;
+    node_pt node, next, prev = NULL;
+    char *top = pool->mem;
+    char *end = pool->mem + pool->total_size;
+
+    for (node = head; node != NULL; node = next){
+        next = node->next;
+        if (node->allocated == 0){
+            _mem_remove_from_gap_ix(pool_mgr, node->alloc_record.size, node);
+            // the first node of the pool stays, so that it is still node_heap[0]
+            if (node == head){
+                prev = node;
+                continue;
+            }
+            prev->next = next;
+            if (next != NULL){
+                next->prev = prev;
+            }
+            _mem_release_node(pool_mgr, node);
+            continue;
+        }
+        if (node->handle != 0 && node->pins == 0 && node->alloc_record.mem != top){
+            memmove(top, node->alloc_record.mem, node->alloc_record.size);
+            node->alloc_record.mem = top;
+        }
+        top = node->alloc_record.mem + node->alloc_record.size;
+        prev = node;
     }
-    next_node->next = NULL;
-    next_node->prev = NULL;
+    pool_mgr->rover = NULL;
 
-    // add merged node back into gap index
-    _mem_add_to_gap_ix(pool_mgr, first_node->alloc_record.size, first_node);
+    // the first gap is empty if a block is at the start of the pool now, and
+    // then the block takes over the first node
+    if (head->allocated == 0){
+        if (head->next == NULL)
+            head->alloc_record.size = pool->total_size;
+        else if (head->next->alloc_record.mem != pool->mem)
+            head->alloc_record.size = (size_t) (head->next->alloc_record.mem - pool->mem);
+        else
+            _handle_move_node(pool_mgr, head->next, head);
+    }
 
-    return first_node;
+    // put the gaps back (the pages of those that are large enough are given
+    // back again, since the blocks that were there have moved away)
+    for (node = head; node != NULL; node = node->next){
+        char *gap_end = (node->next == NULL) ? end : node->next->alloc_record.mem;
+        char *block_end = node->alloc_record.mem + node->alloc_record.size;
+
+        if (node->allocated == 0){
+            _mem_add_to_gap_ix(pool_mgr, node->alloc_record.size, node);
+            _mem_decommit(pool_mgr, node->alloc_record.mem, block_end, node->alloc_record.mem, block_end);
+        }
+        else if (block_end != gap_end){
+            node_pt gap = _mem_acquire_node(pool_mgr);
+
+            assert(gap != NULL);
+            gap->alloc_record.mem = block_end;
+            gap->alloc_record.size = (size_t) (gap_end - block_end);
+            insert_node_heap(node, gap);
+        }
+    }
+
+    return ALLOC_OK;
+}
+
+// moves the allocation node from, the one after the (emptied) first gap to,
+// into to; the block has moved to the start of the pool, so it has a handle
+static void _handle_move_node(pool_mgr_pt pool_mgr, node_pt from, node_pt to) {
+    assert(from->handle != 0);
+    *to = *from;
+    to->prev = NULL;
+    if (to->next != NULL){
+        to->next->prev = to;
+    }
+    pool_mgr->handles[to->handle - 1] = (unsigned) (to - pool_mgr->node_heap);
+    _mem_release_node(pool_mgr, from);
 }
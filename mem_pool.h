@@ -9,7 +9,43 @@
 
 /* type declarations */
 
-typedef enum _alloc_policy { FIRST_FIT, BEST_FIT } alloc_policy;
+typedef enum _alloc_policy { FIRST_FIT, BEST_FIT, SEGREGATED_FIT, NEXT_FIT, BUDDY } alloc_policy;
+
+typedef enum _pool_kind {
+    POOL_NODE_HEAP,     // segment metadata in a separate node heap
+    POOL_BOUNDARY_TAG,  // segment metadata in boundary tags inside the pool memory
+    POOL_SLAB,          // fixed-size objects on a free list inside the pool memory
+    POOL_ARENA          // bump allocation, released all at once or back to a mark
+} pool_kind;
+
+typedef struct _pool_opts {
+    alloc_policy policy;
+    pool_kind kind;
+    size_t obj_size;    // POOL_SLAB: the size of the objects
+    unsigned thread_safe; // non-zero: calls on the pool are serialized by a per-pool lock
+    unsigned thread_cache; // non-zero: small blocks go through per-thread caches (thread-safe
+                           // POOL_BOUNDARY_TAG and POOL_SLAB pools only)
+    unsigned shards;    // more than 1: split into this many locked arenas (POOL_NODE_HEAP only)
+    unsigned remote_free; // non-zero: deallocations by threads other than the one that opens
+                          // the pool are queued, and carried out on the next allocation
+    unsigned lock_free; // non-zero: allocate and deallocate without a lock (POOL_SLAB only)
+    unsigned mmap;      // non-zero: the pool memory is mapped with mmap rather than taken from malloc
+    unsigned huge_pages; // non-zero: mmap, aligned to 2 MiB and advised to use transparent huge pages
+    unsigned prefault;  // non-zero: mmap, with every page faulted in when the pool is opened
+    size_t decommit;    // non-zero: mmap, and gaps of at least this many bytes give their pages back
+    size_t max_size;    // non-zero: grow by further extents, up to this many bytes in all, when
+                        // no gap fits (POOL_NODE_HEAP, not BUDDY or sharded)
+    const char *path;   // non-null: the pool is kept in this file, and reopened from it if the
+                        // file is not empty (POOL_BOUNDARY_TAG only)
+    unsigned shared;    // non-zero: with path, several processes may have the pool open at once
+    unsigned numa_bind; // non-zero: mmap, and bind the pool memory to NUMA node numa_node
+    unsigned numa_node;
+    unsigned numa_local; // non-zero: one pool per NUMA node, each allocation made on the calling
+                         // thread's node (POOL_NODE_HEAP, POOL_BOUNDARY_TAG and POOL_SLAB only)
+    unsigned handles;   // non-zero: blocks may also be allocated by handle, and moved by
+                        // mem_pool_compact (POOL_NODE_HEAP, not BUDDY, growable, sharded or
+                        // NUMA-local)
+} pool_opts_t, *pool_opts_pt;
 
 typedef struct _pool {
     char *mem;
@@ -25,11 +61,30 @@ typedef struct _alloc {
     char *mem;
 } alloc_t, *alloc_pt;
 
+// names a block of a handle pool, which compaction may move (0 for none)
+typedef unsigned alloc_handle_t;
+
 typedef struct _pool_segment {
     size_t size;
     unsigned long allocated; // 1-allocation, 0-gap (note: 8 bytes)
 } pool_segment_t, *pool_segment_pt;
 
+// counters of the calling thread's cache of a pool
+typedef struct _cache_stats {
+    unsigned long alloc_hits;   // allocations taken from the cache
+    unsigned long alloc_misses; // allocations that had to refill the cache from the pool
+    unsigned long del_hits;     // deallocations kept in the cache
+    unsigned long del_misses;   // deallocations that went straight to the pool
+    unsigned long flushed;      // cached blocks given back to the pool because a size class was full
+} cache_stats_t, *cache_stats_pt;
+
+// how much of a pool's memory is in RAM
+typedef struct _rss_stats {
+    size_t resident;            // bytes in pages that are in RAM
+    size_t decommitted;         // bytes in pages that gaps have given back to the OS so far
+    unsigned long decommits;    // calls that gave pages back
+} rss_stats_t, *rss_stats_pt;
+
 typedef enum _alloc_status {
     ALLOC_OK,
     ALLOC_FAIL,
@@ -37,6 +92,13 @@ typedef enum _alloc_status {
     ALLOC_NOT_FREED
 } alloc_status;
 
+// the state of an arena pool to reset it to
+typedef struct _arena_mark {
+    size_t top;
+    size_t alloc_size;
+    unsigned num_allocs;
+} arena_mark_t, *arena_mark_pt;
+
 /* function declarations */
 
 alloc_status
@@ -48,16 +110,73 @@ mem_free();
 pool_pt
 mem_pool_open(size_t size, alloc_policy policy);
 
+pool_pt
+mem_pool_open_opts(size_t size, const pool_opts_t *opts);
+
 alloc_status
 mem_pool_close(pool_pt pool);
 
 alloc_pt
 mem_new_alloc(pool_pt pool, size_t size);
 
+alloc_pt
+mem_new_alloc_aligned(pool_pt pool, size_t size, size_t alignment);
+
 alloc_status
 mem_del_alloc(pool_pt pool, alloc_pt alloc);
 
+char *
+mem_new_alloc_addr(pool_pt pool, size_t size);
+
+alloc_status
+mem_del_alloc_addr(pool_pt pool, char *mem);
+
+alloc_status
+mem_new_alloc_batch(pool_pt pool, const size_t sizes[], unsigned n, char *out[]);
+
+alloc_status
+mem_del_alloc_batch(pool_pt pool, char *mems[], unsigned n);
+
+char *
+mem_realloc(pool_pt pool, char *mem, size_t size);
+
 void
 mem_inspect_pool(pool_pt pool, pool_segment_pt *segments, unsigned *num_segments);
 
+alloc_status
+mem_cache_flush(pool_pt pool);
+
+alloc_status
+mem_cache_stats(pool_pt pool, cache_stats_pt stats);
+
+alloc_status
+mem_arena_mark(pool_pt pool, arena_mark_pt mark);
+
+alloc_status
+mem_arena_reset(pool_pt pool, const arena_mark_t *mark);
+
+alloc_status
+mem_rss_stats(pool_pt pool, rss_stats_pt stats);
+
+alloc_status
+mem_pool_set_root(pool_pt pool, const char *mem);
+
+char *
+mem_pool_get_root(pool_pt pool);
+
+alloc_handle_t
+mem_new_handle(pool_pt pool, size_t size);
+
+alloc_status
+mem_del_handle(pool_pt pool, alloc_handle_t handle);
+
+char *
+mem_pin(pool_pt pool, alloc_handle_t handle);
+
+alloc_status
+mem_unpin(pool_pt pool, alloc_handle_t handle);
+
+alloc_status
+mem_pool_compact(pool_pt pool);
+
 #endif //DENVER_OS_PA_C_MEM_POOL_H
@@ -0,0 +1,1576 @@
+/*
+ * Micro-benchmarks for the mem_pool library.
+ *
+ * The library source is included directly so that the internal structures
+ * (node heap, gap index) can also be driven in isolation.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#define _DEFAULT_SOURCE // for MAP_ANONYMOUS in mem_pool.c
+
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "mem_pool.c"
+
+
+/*****            constants            *****/
+
+static const unsigned BENCH_GAP_COUNTS[]  = { 1000, 10000, 100000 };
+static const unsigned BENCH_GAP_OPS       = 20000;
+static const size_t   BENCH_MAX_GAP_SIZE  = 4096;
+static const size_t   BENCH_MISS_GAP      = 1000;   // a request of one more byte finds no class above
+static const unsigned BENCH_CHURN_LIVE    = 100000;
+static const unsigned BENCH_CHURN_OPS     = 10000;
+static const size_t   BENCH_MAX_ALLOC     = 256;
+static const size_t   BENCH_OBJ_SIZE      = 64;
+static const unsigned BENCH_PAGE_LIVE     = 4096;
+static const size_t   BENCH_PAGE_SIZE     = 4096;
+static const size_t   BENCH_MAX_PAGES     = 8;
+static const unsigned BENCH_FIFO_LIVE     = 10000;
+static const unsigned BENCH_FIFO_OPS      = 200000;
+static const unsigned BENCH_FIFO_KEEP     = 16;     // one message in this many is never freed
+#define BENCH_BATCH_SIZE 256
+static const unsigned BENCH_BATCH_REQUESTS = 1000;
+static const size_t   BENCH_APPEND_STEP   = 64;
+static const size_t   BENCH_APPEND_SIZE   = 4096;
+static const unsigned BENCH_APPEND_BUFS   = 2000;
+static const unsigned BENCH_ALIGNED_BUFS  = 2000;
+static const size_t   BENCH_CACHE_LINE    = 64;
+#define BENCH_COUNTERS 4
+static const unsigned long BENCH_COUNTER_OPS = 20000000;
+static const unsigned BENCH_COMPACT_PINNED = 100;   // one block in this many stays pinned
+static const size_t   BENCH_MAPPED_SIZE   = (size_t) 256 << 20;
+static const unsigned BENCH_MAPPED_READS  = 4000000;
+static const unsigned BENCH_BURST_BLOCKS  = 2000;
+static const size_t   BENCH_BURST_MAX     = (size_t) 128 << 10;
+static const size_t   BENCH_GROWTH_SIZE   = (size_t) 1 << 20;
+static const char     BENCH_FILE_PATH[]   = "mem_pool_bench.pool";
+static const size_t   BENCH_FILE_SIZE     = (size_t) 64 << 20;
+static const unsigned BENCH_FILE_BLOCKS   = 200000;
+static const size_t   BENCH_FILE_MAX      = 256;
+static const char     BENCH_SHARED_PATH[] = "mem_pool_bench_shared.pool";
+static const size_t   BENCH_HANDOFF_POOL  = (size_t) 64 << 20;
+static const unsigned BENCH_HANDOFF_BUFS  = 100000;
+#define BENCH_HANDOFF_SIZE 4096
+static const size_t   BENCH_NUMA_SIZE     = (size_t) 64 << 20;
+static const unsigned BENCH_NUMA_PASSES   = 8;
+static const unsigned BENCH_THREAD_COUNTS[] = { 1, 2, 4, 8 };
+static const unsigned BENCH_THREAD_LIVE   = 10000;
+static const unsigned BENCH_THREAD_OPS    = 200000;
+#define BENCH_RING_SIZE 1024
+static const unsigned BENCH_CONTENTION_COUNTS[] = { 1, 2, 4, 8, 16, 32, 64 };
+#define BENCH_OBJ_LIVE 16
+static const unsigned BENCH_OBJ_OPS       = 100000;
+static const unsigned long BENCH_SEED     = 88172645463325252UL;
+
+
+/*****         helper routines         *****/
+
+static double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned long bench_seed = BENCH_SEED;
+
+static unsigned long bench_rand_r(unsigned long *seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 7;
+    *seed ^= *seed << 17;
+    return *seed;
+}
+
+static unsigned long bench_rand() {
+    return bench_rand_r(&bench_seed);
+}
+
+
+/*****   reference: sorted gap array   *****/
+
+/*
+ * The flat gap index the tree replaced: appended at the end and bubbled into
+ * place on insert, shifted up on removal, and scanned linearly for best fit.
+ */
+typedef struct _ref_gap {
+    size_t size;
+    node_pt node;
+} ref_gap_t, *ref_gap_pt;
+
+static void ref_add(ref_gap_pt gaps, unsigned *num_gaps, node_pt node) {
+    unsigned i = (*num_gaps)++;
+
+    gaps[i].size = node->alloc_record.size;
+    gaps[i].node = node;
+    for (; i > 0; i--){
+        if (gaps[i].size > gaps[i-1].size ||
+            (gaps[i].size == gaps[i-1].size
+             && gaps[i].node->alloc_record.mem > gaps[i-1].node->alloc_record.mem))
+            break;
+        ref_gap_t temp = gaps[i];
+        gaps[i] = gaps[i-1];
+        gaps[i-1] = temp;
+    }
+}
+
+static void ref_remove(ref_gap_pt gaps, unsigned *num_gaps, node_pt node) {
+    unsigned i = 0;
+
+    while (i < *num_gaps && gaps[i].node != node)
+        i++;
+    for (; i + 1 < *num_gaps; i++)
+        gaps[i] = gaps[i+1];
+    (*num_gaps)--;
+}
+
+static node_pt ref_find(ref_gap_pt gaps, unsigned num_gaps, size_t size) {
+    for (unsigned i = 0; i < num_gaps; i++){
+        if (gaps[i].size >= size)
+            return gaps[i].node;
+    }
+    return NULL;
+}
+
+
+/*****           benchmarks            *****/
+
+/*
+ * Times best-fit lookup + removal + reinsertion on a gap index filled with
+ * the given gaps, i.e. the gap index work of an allocation followed by the
+ * deallocation of the same block.
+ */
+static double bench_gap_ix_ops(pool_mgr_pt pool_mgr, node_pt nodes, unsigned num_gaps,
+                               const size_t *reqs) {
+    double start;
+
+    for (unsigned i = 0; i < num_gaps; i++)
+        _mem_add_to_gap_ix(pool_mgr, nodes[i].alloc_record.size, &nodes[i]);
+
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_GAP_OPS; i++){
+        node_pt gap = _mem_find_gap_ix(pool_mgr, reqs[i]);
+        if (gap == NULL)
+            continue;
+        _mem_remove_from_gap_ix(pool_mgr, gap->alloc_record.size, gap);
+        _mem_add_to_gap_ix(pool_mgr, gap->alloc_record.size, gap);
+    }
+    return bench_now() - start;
+}
+
+static void bench_gap_index(unsigned num_gaps) {
+    node_pt nodes = (node_pt) calloc(num_gaps, sizeof(node_t));
+    char *mem = (char *) malloc(num_gaps);
+    size_t *reqs = (size_t *) malloc(BENCH_GAP_OPS * sizeof(size_t));
+    ref_gap_pt ref_gaps = (ref_gap_pt) malloc(num_gaps * sizeof(ref_gap_t));
+    unsigned ref_num_gaps = 0;
+    pool_mgr_t tree_mgr = { 0 };
+    pool_mgr_t seg_mgr = { 0 };
+    double start, tree_time, seg_time, array_time;
+
+    assert(nodes && mem && reqs && ref_gaps);
+
+    for (unsigned i = 0; i < num_gaps; i++){
+        nodes[i].alloc_record.size = 1 + bench_rand() % BENCH_MAX_GAP_SIZE;
+        nodes[i].alloc_record.mem = mem + i;
+        nodes[i].used = 1;
+    }
+    for (unsigned i = 0; i < BENCH_GAP_OPS; i++)
+        reqs[i] = 1 + bench_rand() % BENCH_MAX_GAP_SIZE;
+
+    // tree (BEST_FIT)
+    tree_mgr.pool.policy = BEST_FIT;
+    tree_time = bench_gap_ix_ops(&tree_mgr, nodes, num_gaps, reqs);
+    assert(tree_mgr.pool.num_gaps == num_gaps);
+
+    // segregated lists (SEGREGATED_FIT)
+    seg_mgr.pool.policy = SEGREGATED_FIT;
+    seg_mgr.seg_ix = (seg_ix_pt) calloc(1, sizeof(seg_ix_t));
+    assert(seg_mgr.seg_ix);
+    seg_time = bench_gap_ix_ops(&seg_mgr, nodes, num_gaps, reqs);
+    assert(seg_mgr.pool.num_gaps == num_gaps);
+    free(seg_mgr.seg_ix);
+
+    // array
+    for (unsigned i = 0; i < num_gaps; i++)
+        ref_add(ref_gaps, &ref_num_gaps, &nodes[i]);
+
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_GAP_OPS; i++){
+        node_pt gap = ref_find(ref_gaps, ref_num_gaps, reqs[i]);
+        if (gap == NULL)
+            continue;
+        ref_remove(ref_gaps, &ref_num_gaps, gap);
+        ref_add(ref_gaps, &ref_num_gaps, gap);
+    }
+    array_time = bench_now() - start;
+    assert(ref_num_gaps == num_gaps);
+
+    printf("%-24s %8u gaps: tree %7.1f, segregated %7.1f, array %10.1f ns/op\n",
+           "gap index lookup", num_gaps,
+           tree_time * 1e9 / BENCH_GAP_OPS, seg_time * 1e9 / BENCH_GAP_OPS,
+           array_time * 1e9 / BENCH_GAP_OPS);
+
+    free(ref_gaps);
+    free(reqs);
+    free(mem);
+    free(nodes);
+}
+
+
+/*
+ * Lays out num_gaps gaps, each preceded by an allocation, and times the
+ * topmost-sufficient-gap lookup + removal + reinsertion with the address-ordered
+ * FIRST_FIT tree against a walk of the node list. Like in a fragmented first-fit
+ * pool, the gaps near the top of the pool are small and grow towards the end.
+ */
+static void bench_first_fit(unsigned num_gaps) {
+    node_pt nodes = (node_pt) calloc(2 * num_gaps, sizeof(node_t));
+    char *mem = (char *) malloc(2 * num_gaps);
+    size_t *reqs = (size_t *) malloc(BENCH_GAP_OPS * sizeof(size_t));
+    pool_mgr_t tree_mgr = { 0 };
+    double start, tree_time, list_time;
+    unsigned long checksum = 0;
+
+    assert(nodes && mem && reqs);
+
+    for (unsigned i = 0; i < 2 * num_gaps; i++){
+        nodes[i].alloc_record.size = 1 + bench_rand() % (1 + BENCH_MAX_GAP_SIZE * i / (2 * num_gaps));
+        nodes[i].alloc_record.mem = mem + i;
+        nodes[i].used = 1;
+        nodes[i].allocated = (i % 2 == 0);
+        nodes[i].next = (i + 1 < 2 * num_gaps) ? &nodes[i+1] : NULL;
+        nodes[i].prev = (i > 0) ? &nodes[i-1] : NULL;
+    }
+    for (unsigned i = 0; i < BENCH_GAP_OPS; i++)
+        reqs[i] = 1 + bench_rand() % BENCH_MAX_GAP_SIZE;
+
+    // tree
+    tree_mgr.pool.policy = FIRST_FIT;
+    for (unsigned i = 1; i < 2 * num_gaps; i += 2)
+        _mem_add_to_gap_ix(&tree_mgr, nodes[i].alloc_record.size, &nodes[i]);
+
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_GAP_OPS; i++){
+        node_pt gap = _mem_find_gap_ix(&tree_mgr, reqs[i]);
+        if (gap == NULL)
+            continue;
+        checksum += gap - nodes;
+        _mem_remove_from_gap_ix(&tree_mgr, gap->alloc_record.size, gap);
+        _mem_add_to_gap_ix(&tree_mgr, gap->alloc_record.size, gap);
+    }
+    tree_time = bench_now() - start;
+    assert(tree_mgr.pool.num_gaps == num_gaps);
+
+    // list walk
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_GAP_OPS; i++){
+        node_pt gap = nodes;
+        while (gap != NULL && (gap->allocated == 1 || gap->alloc_record.size < reqs[i]))
+            gap = gap->next;
+        if (gap == NULL)
+            continue;
+        checksum -= gap - nodes;
+    }
+    list_time = bench_now() - start;
+    assert(checksum == 0);
+
+    printf("%-24s %8u gaps: tree %7.1f, list walk %10.1f ns/op\n",
+           "first fit lookup", num_gaps,
+           tree_time * 1e9 / BENCH_GAP_OPS, list_time * 1e9 / BENCH_GAP_OPS);
+
+    free(reqs);
+    free(mem);
+    free(nodes);
+}
+
+/*
+ * Fills a SEGREGATED_FIT pool with about num_gaps gaps of BENCH_MISS_GAP bytes,
+ * each followed by a small allocation, up to its end, and times requests of
+ * one byte more, which no class above the gaps' own can hold, so that every
+ * one of them fails.
+ */
+static double bench_seg_miss_run(const pool_opts_t *opts, unsigned num_gaps) {
+    char **mems = (char **) malloc(2 * num_gaps * sizeof(char *));
+    unsigned num_mems = 0, num_hits = 0;
+    double start, elapsed;
+    pool_pt pool;
+
+    assert(mems);
+    mem_init();
+    pool = mem_pool_open_opts(num_gaps * (BENCH_MISS_GAP + 8), opts);
+    assert(pool);
+    while (num_mems < 2 * num_gaps){
+        mems[num_mems] = mem_new_alloc_addr(pool, (num_mems % 2 == 0) ? BENCH_MISS_GAP : 8);
+        if (mems[num_mems] == NULL)
+            break;
+        num_mems++;
+    }
+    // (a last large block without a small one after it stays, since its gap
+    // would take in the rest of the pool)
+    for (unsigned i = 0; i + 1 < num_mems; i += 2)
+        mem_del_alloc_addr(pool, mems[i]);
+
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_GAP_OPS; i++){
+        char *mem = mem_new_alloc_addr(pool, BENCH_MISS_GAP + 1);
+        if (mem != NULL){
+            mem_del_alloc_addr(pool, mem);
+            num_hits++;
+        }
+    }
+    elapsed = bench_now() - start;
+    assert(num_hits == 0);
+
+    for (unsigned i = 1; i < num_mems; i += 2)
+        mem_del_alloc_addr(pool, mems[i]);
+    if (num_mems % 2 == 1)
+        mem_del_alloc_addr(pool, mems[num_mems - 1]);
+    mem_pool_close(pool);
+    mem_free();
+    free(mems);
+    return elapsed * 1e9 / BENCH_GAP_OPS;
+}
+
+static void bench_seg_miss(unsigned num_gaps) {
+    const pool_opts_t sf_opts = { .policy = SEGREGATED_FIT, .kind = POOL_NODE_HEAP };
+    const pool_opts_t bt_opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG };
+    double seg_time = bench_seg_miss_run(&sf_opts, num_gaps);
+    double tag_time = bench_seg_miss_run(&bt_opts, num_gaps);
+
+    printf("%-24s %8u gaps: SEGREGATED_FIT %7.1f, boundary tags %7.1f ns/op\n",
+           "failing lookup", num_gaps, seg_time, tag_time);
+}
+
+
+/*
+ * Churns a pool holding num_live allocations through the user-facing address
+ * API: each step deallocates a random live allocation and allocates a new one
+ * of a random multiple of unit bytes, up to max_units of them.
+ */
+static void bench_churn(const char *label, unsigned num_live, size_t unit, size_t max_units,
+                        const char *name, const pool_opts_t *opts) {
+    char **live = (char **) malloc(num_live * sizeof(char *));
+    size_t pool_size = 2 * num_live * unit * max_units;
+    pool_pt pool;
+    double start, alloc_time = 0, del_time = 0;
+
+    assert(live);
+    bench_seed = BENCH_SEED;
+    mem_init();
+    pool = mem_pool_open_opts(pool_size, opts);
+    assert(pool);
+
+    for (unsigned i = 0; i < num_live; i++){
+        live[i] = mem_new_alloc_addr(pool, unit * (1 + bench_rand() % max_units));
+        assert(live[i]);
+    }
+
+    for (unsigned i = 0; i < BENCH_CHURN_OPS; i++){
+        unsigned victim = bench_rand() % num_live;
+
+        start = bench_now();
+        mem_del_alloc_addr(pool, live[victim]);
+        del_time += bench_now() - start;
+
+        start = bench_now();
+        live[victim] = mem_new_alloc_addr(pool, unit * (1 + bench_rand() % max_units));
+        alloc_time += bench_now() - start;
+        assert(live[victim]);
+    }
+
+    printf("%-24s %8u live: %-14s alloc %9.1f, free %11.1f ns/op\n",
+           label, num_live, name,
+           alloc_time * 1e9 / BENCH_CHURN_OPS, del_time * 1e9 / BENCH_CHURN_OPS);
+
+    for (unsigned i = 0; i < num_live; i++)
+        mem_del_alloc_addr(pool, live[i]);
+    mem_pool_close(pool);
+    mem_free();
+    free(live);
+}
+
+
+/*
+ * Replays a FIFO message buffer trace: each step deallocates the oldest of
+ * num_live messages and allocates a new one, except that one message in
+ * BENCH_FIFO_KEEP is kept for good, so the long-lived messages accumulate in
+ * the low addresses. Every policy replays the same trace.
+ */
+static void bench_fifo(unsigned num_live, alloc_policy policy, const char *name) {
+    unsigned max_kept = BENCH_FIFO_OPS / BENCH_FIFO_KEEP + 1;
+    char **queue = (char **) malloc(num_live * sizeof(char *));
+    char **kept = (char **) malloc(max_kept * sizeof(char *));
+    size_t pool_size = 2 * (num_live + max_kept) * BENCH_MAX_ALLOC;
+    unsigned head = 0, num_kept = 0;
+    pool_pt pool;
+    double start, time;
+
+    assert(queue && kept);
+    bench_seed = BENCH_SEED;
+    mem_init();
+    pool = mem_pool_open(pool_size, policy);
+    assert(pool);
+
+    for (unsigned i = 0; i < num_live; i++){
+        queue[i] = mem_new_alloc_addr(pool, 1 + bench_rand() % BENCH_MAX_ALLOC);
+        assert(queue[i]);
+    }
+
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_FIFO_OPS; i++){
+        if (bench_rand() % BENCH_FIFO_KEEP == 0)
+            kept[num_kept++] = queue[head];
+        else
+            mem_del_alloc_addr(pool, queue[head]);
+        queue[head] = mem_new_alloc_addr(pool, 1 + bench_rand() % BENCH_MAX_ALLOC);
+        assert(queue[head]);
+        head = (head + 1) % num_live;
+    }
+    time = bench_now() - start;
+
+    printf("%-24s %8u live: %-14s %9.1f ns/op, %6u gaps\n",
+           "fifo trace", num_live, name, time * 1e9 / BENCH_FIFO_OPS, pool->num_gaps);
+
+    for (unsigned i = 0; i < num_live; i++)
+        mem_del_alloc_addr(pool, queue[i]);
+    for (unsigned i = 0; i < num_kept; i++)
+        mem_del_alloc_addr(pool, kept[i]);
+    mem_pool_close(pool);
+    mem_free();
+    free(kept);
+    free(queue);
+}
+
+
+/*
+ * Every thread opens its own pool, churns it like bench_churn and closes it
+ * again, so the threads only share the pool store. With per_pool_lock the
+ * pools are thread-safe; otherwise every call takes one global lock, which is
+ * what wrapping the library in a single mutex would cost. Given a shared
+ * pool, the threads churn that one instead.
+ */
+typedef struct _bench_thread {
+    pthread_t thread;
+    pthread_barrier_t *start;
+    pthread_mutex_t *global_lock; // NULL: the pools lock themselves
+    pool_pt shared;               // NULL: every thread opens a pool of its own
+    unsigned long seed;
+    double time;
+    cache_stats_t stats;
+} bench_thread_t, *bench_thread_pt;
+
+static void bench_thread_lock(bench_thread_pt arg) {
+    if (arg->global_lock != NULL)
+        pthread_mutex_lock(arg->global_lock);
+}
+
+static void bench_thread_unlock(bench_thread_pt arg) {
+    if (arg->global_lock != NULL)
+        pthread_mutex_unlock(arg->global_lock);
+}
+
+static void *bench_thread_churn(void *p) {
+    bench_thread_pt arg = (bench_thread_pt) p;
+    const pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_NODE_HEAP,
+                               .thread_safe = (arg->global_lock == NULL) };
+    char **live = (char **) malloc(BENCH_THREAD_LIVE * sizeof(char *));
+    pool_pt pool;
+    double start;
+
+    assert(live);
+    pool = arg->shared;
+    if (pool == NULL)
+        pool = mem_pool_open_opts(2 * BENCH_THREAD_LIVE * BENCH_MAX_ALLOC, &opts);
+    assert(pool);
+    for (unsigned i = 0; i < BENCH_THREAD_LIVE; i++){
+        live[i] = mem_new_alloc_addr(pool, 1 + bench_rand_r(&arg->seed) % BENCH_MAX_ALLOC);
+        assert(live[i]);
+    }
+
+    pthread_barrier_wait(arg->start);
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_THREAD_OPS; i++){
+        unsigned victim = bench_rand_r(&arg->seed) % BENCH_THREAD_LIVE;
+        size_t size = 1 + bench_rand_r(&arg->seed) % BENCH_MAX_ALLOC;
+
+        bench_thread_lock(arg);
+        mem_del_alloc_addr(pool, live[victim]);
+        bench_thread_unlock(arg);
+
+        bench_thread_lock(arg);
+        live[victim] = mem_new_alloc_addr(pool, size);
+        bench_thread_unlock(arg);
+        assert(live[victim]);
+    }
+    arg->time = bench_now() - start;
+    mem_cache_stats(pool, &arg->stats);
+
+    for (unsigned i = 0; i < BENCH_THREAD_LIVE; i++)
+        mem_del_alloc_addr(pool, live[i]);
+    if (arg->shared == NULL)
+        mem_pool_close(pool);
+    free(live);
+    return NULL;
+}
+
+static double bench_thread_run(unsigned num_threads, pthread_mutex_t *global_lock,
+                               pool_pt shared, cache_stats_pt stats) {
+    bench_thread_pt threads = (bench_thread_pt) calloc(num_threads, sizeof(bench_thread_t));
+    pthread_barrier_t start;
+    double time = 0;
+
+    assert(threads);
+    pthread_barrier_init(&start, NULL, num_threads);
+    for (unsigned i = 0; i < num_threads; i++){
+        threads[i].start = &start;
+        threads[i].global_lock = global_lock;
+        threads[i].shared = shared;
+        threads[i].seed = BENCH_SEED + i;
+        pthread_create(&threads[i].thread, NULL, bench_thread_churn, &threads[i]);
+    }
+    for (unsigned i = 0; i < num_threads; i++){
+        pthread_join(threads[i].thread, NULL);
+        if (threads[i].time > time)
+            time = threads[i].time;
+        if (stats != NULL){
+            stats->alloc_hits += threads[i].stats.alloc_hits;
+            stats->alloc_misses += threads[i].stats.alloc_misses;
+        }
+    }
+    pthread_barrier_destroy(&start);
+    free(threads);
+
+    // allocations and deallocations per second, over all threads
+    return 2.0 * num_threads * BENCH_THREAD_OPS / time;
+}
+
+static void bench_threads(unsigned num_threads) {
+    pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+    double pool_rate, global_rate;
+
+    mem_init();
+    pool_rate = bench_thread_run(num_threads, NULL, NULL, NULL);
+    global_rate = bench_thread_run(num_threads, &global_lock, NULL, NULL);
+    mem_free();
+
+    printf("%-24s %8u threads: per-pool lock %6.2f, global lock %6.2f Mops/s\n",
+           "thread churn", num_threads, pool_rate * 1e-6, global_rate * 1e-6);
+}
+
+/*
+ * All threads churn one boundary-tag pool, locked on every call, or with
+ * per-thread caches in front of it.
+ */
+static void bench_shared(unsigned num_threads) {
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG, .thread_safe = 1 };
+    size_t pool_size = 4 * num_threads * BENCH_THREAD_LIVE * BENCH_MAX_ALLOC;
+    cache_stats_t stats = { 0 };
+    double locked_rate, cached_rate;
+    pool_pt pool;
+
+    mem_init();
+    pool = mem_pool_open_opts(pool_size, &opts);
+    assert(pool);
+    locked_rate = bench_thread_run(num_threads, NULL, pool, NULL);
+    mem_pool_close(pool);
+
+    opts.thread_cache = 1;
+    pool = mem_pool_open_opts(pool_size, &opts);
+    assert(pool);
+    cached_rate = bench_thread_run(num_threads, NULL, pool, &stats);
+    mem_pool_close(pool);
+    mem_free();
+
+    printf("%-24s %8u threads: locked %6.2f, cached %6.2f Mops/s, %5.1f%% cache hits\n",
+           "shared churn", num_threads, locked_rate * 1e-6, cached_rate * 1e-6,
+           100.0 * stats.alloc_hits / (stats.alloc_hits + stats.alloc_misses));
+}
+
+
+/*
+ * All threads churn one node heap pool, either behind a single lock or split
+ * into one arena per thread.
+ */
+static void bench_sharded(unsigned num_threads) {
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_NODE_HEAP, .thread_safe = 1 };
+    size_t pool_size = 4 * num_threads * BENCH_THREAD_LIVE * BENCH_MAX_ALLOC;
+    double locked_rate, sharded_rate;
+    pool_pt pool;
+
+    mem_init();
+    pool = mem_pool_open_opts(pool_size, &opts);
+    assert(pool);
+    locked_rate = bench_thread_run(num_threads, NULL, pool, NULL);
+    mem_pool_close(pool);
+
+    opts.shards = num_threads;
+    pool = mem_pool_open_opts(pool_size, &opts);
+    assert(pool);
+    sharded_rate = bench_thread_run(num_threads, NULL, pool, NULL);
+    mem_pool_close(pool);
+    mem_free();
+
+    printf("%-24s %8u threads: one lock %6.2f, %2u arenas %6.2f Mops/s\n",
+           "sharded churn", num_threads, locked_rate * 1e-6, num_threads, sharded_rate * 1e-6);
+}
+
+
+/*
+ * The producer (the thread that opens the pool) allocates messages and hands
+ * them round-robin to the consumers through single-producer rings; the
+ * consumers free them. The pool is either thread-safe, so that every free
+ * takes its lock, or remote-free, so that the frees are queued and carried
+ * out by the producer.
+ */
+typedef struct _bench_ring {
+    pthread_t thread;
+    pool_pt pool;
+    char *slots[BENCH_RING_SIZE];
+    unsigned head; // next slot the consumer reads
+    unsigned tail; // next slot the producer writes
+} bench_ring_t, *bench_ring_pt;
+
+static void *bench_consume(void *p) {
+    bench_ring_pt ring = (bench_ring_pt) p;
+    char *mem;
+
+    for (;;){
+        unsigned head = ring->head;
+
+        while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head)
+            sched_yield();
+        mem = ring->slots[head % BENCH_RING_SIZE];
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+        // the producer ends the run with NULL
+        if (mem == NULL)
+            return NULL;
+        mem_del_alloc_addr(ring->pool, mem);
+    }
+}
+
+static void bench_produce(bench_ring_pt ring, char *mem) {
+    unsigned tail = ring->tail;
+
+    while (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == BENCH_RING_SIZE)
+        sched_yield();
+    ring->slots[tail % BENCH_RING_SIZE] = mem;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static double bench_remote_run(unsigned num_consumers, const pool_opts_t *opts) {
+    bench_ring_pt rings = (bench_ring_pt) calloc(num_consumers, sizeof(bench_ring_t));
+    unsigned long seed = BENCH_SEED;
+    double start, time;
+    alloc_status status;
+    pool_pt pool;
+
+    assert(rings);
+    pool = mem_pool_open_opts(4 * (num_consumers + 1) * BENCH_RING_SIZE * BENCH_MAX_ALLOC, opts);
+    assert(pool);
+    start = bench_now();
+    for (unsigned i = 0; i < num_consumers; i++){
+        rings[i].pool = pool;
+        pthread_create(&rings[i].thread, NULL, bench_consume, &rings[i]);
+    }
+    for (unsigned i = 0; i < BENCH_THREAD_OPS; i++){
+        char *mem = mem_new_alloc_addr(pool, 1 + bench_rand_r(&seed) % BENCH_MAX_ALLOC);
+
+        assert(mem);
+        bench_produce(&rings[i % num_consumers], mem);
+    }
+    for (unsigned i = 0; i < num_consumers; i++)
+        bench_produce(&rings[i], NULL);
+    for (unsigned i = 0; i < num_consumers; i++)
+        pthread_join(rings[i].thread, NULL);
+    time = bench_now() - start;
+    status = mem_pool_close(pool);
+    assert(status == ALLOC_OK);
+    free(rings);
+
+    // messages per second
+    return BENCH_THREAD_OPS / time;
+}
+
+static void bench_remote(unsigned num_consumers) {
+    const pool_opts_t locked_opts = { .policy = SEGREGATED_FIT, .kind = POOL_NODE_HEAP, .thread_safe = 1 };
+    const pool_opts_t remote_opts = { .policy = SEGREGATED_FIT, .kind = POOL_NODE_HEAP, .remote_free = 1 };
+    double locked_rate, remote_rate;
+
+    mem_init();
+    locked_rate = bench_remote_run(num_consumers, &locked_opts);
+    remote_rate = bench_remote_run(num_consumers, &remote_opts);
+    mem_free();
+
+    printf("%-24s %8u consumers: locked frees %6.2f, remote frees %6.2f Mmsgs/s\n",
+           "producer/consumer", num_consumers, locked_rate * 1e-6, remote_rate * 1e-6);
+}
+
+
+/*
+ * All threads churn one slab pool of 64-byte objects, each with a few live
+ * objects, so that nearly every call contends: behind the pool lock, or on
+ * the lock-free free stack.
+ */
+static void *bench_object_churn(void *p) {
+    bench_thread_pt arg = (bench_thread_pt) p;
+    char *live[BENCH_OBJ_LIVE];
+    double start;
+
+    for (unsigned i = 0; i < BENCH_OBJ_LIVE; i++){
+        live[i] = mem_new_alloc_addr(arg->shared, BENCH_OBJ_SIZE);
+        assert(live[i]);
+    }
+
+    pthread_barrier_wait(arg->start);
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_OBJ_OPS; i++){
+        unsigned victim = bench_rand_r(&arg->seed) % BENCH_OBJ_LIVE;
+
+        mem_del_alloc_addr(arg->shared, live[victim]);
+        live[victim] = mem_new_alloc_addr(arg->shared, BENCH_OBJ_SIZE);
+        assert(live[victim]);
+    }
+    arg->time = bench_now() - start;
+
+    for (unsigned i = 0; i < BENCH_OBJ_LIVE; i++)
+        mem_del_alloc_addr(arg->shared, live[i]);
+    return NULL;
+}
+
+static double bench_object_run(unsigned num_threads, const pool_opts_t *opts) {
+    bench_thread_pt threads = (bench_thread_pt) calloc(num_threads, sizeof(bench_thread_t));
+    pthread_barrier_t start;
+    double time = 0;
+    alloc_status status;
+    pool_pt pool;
+
+    assert(threads);
+    pool = mem_pool_open_opts(2 * num_threads * BENCH_OBJ_LIVE * BENCH_OBJ_SIZE, opts);
+    assert(pool);
+    pthread_barrier_init(&start, NULL, num_threads);
+    for (unsigned i = 0; i < num_threads; i++){
+        threads[i].start = &start;
+        threads[i].shared = pool;
+        threads[i].seed = BENCH_SEED + i;
+        pthread_create(&threads[i].thread, NULL, bench_object_churn, &threads[i]);
+    }
+    for (unsigned i = 0; i < num_threads; i++){
+        pthread_join(threads[i].thread, NULL);
+        if (threads[i].time > time)
+            time = threads[i].time;
+    }
+    pthread_barrier_destroy(&start);
+    assert(pool->num_allocs == 0);
+    status = mem_pool_close(pool);
+    assert(status == ALLOC_OK);
+    free(threads);
+
+    // allocations and deallocations per second, over all threads
+    return 2.0 * num_threads * BENCH_OBJ_OPS / time;
+}
+
+static void bench_lock_free(unsigned num_threads) {
+    const pool_opts_t locked_opts = { .kind = POOL_SLAB, .obj_size = BENCH_OBJ_SIZE, .thread_safe = 1 };
+    const pool_opts_t lf_opts = { .kind = POOL_SLAB, .obj_size = BENCH_OBJ_SIZE, .lock_free = 1 };
+    double locked_rate, lf_rate;
+
+    mem_init();
+    locked_rate = bench_object_run(num_threads, &locked_opts);
+    lf_rate = bench_object_run(num_threads, &lf_opts);
+    mem_free();
+
+    printf("%-24s %8u threads: locked %6.2f, lock-free %6.2f Mops/s\n",
+           "slab contention", num_threads, locked_rate * 1e-6, lf_rate * 1e-6);
+}
+
+
+/*
+ * Serves requests that each allocate BENCH_BATCH_SIZE buffers and then
+ * release them all, in a pool that holds 10k other allocations, one call per
+ * buffer or one batch call per request. Times are per buffer.
+ */
+static double bench_batch_run(const pool_opts_t *opts, int batched, double *del_time) {
+    size_t *sizes = (size_t *) malloc(BENCH_BATCH_SIZE * sizeof(size_t));
+    char **bufs = (char **) malloc(BENCH_BATCH_SIZE * sizeof(char *));
+    char **live = (char **) malloc(BENCH_FIFO_LIVE * sizeof(char *));
+    double start, alloc_time = 0;
+    alloc_status status;
+    pool_pt pool;
+
+    assert(sizes && bufs && live);
+    bench_seed = BENCH_SEED;
+    *del_time = 0;
+    mem_init();
+    pool = mem_pool_open_opts(4 * (BENCH_FIFO_LIVE + BENCH_BATCH_SIZE) * BENCH_MAX_ALLOC, opts);
+    assert(pool);
+    // every other one of the background allocations goes, which leaves gaps
+    for (unsigned i = 0; i < BENCH_FIFO_LIVE; i++){
+        live[i] = mem_new_alloc_addr(pool, 1 + bench_rand() % BENCH_MAX_ALLOC);
+        assert(live[i]);
+    }
+    for (unsigned i = 0; i < BENCH_FIFO_LIVE; i += 2)
+        mem_del_alloc_addr(pool, live[i]);
+
+    for (unsigned r = 0; r < BENCH_BATCH_REQUESTS; r++){
+        for (unsigned i = 0; i < BENCH_BATCH_SIZE; i++)
+            sizes[i] = 1 + bench_rand() % BENCH_MAX_ALLOC;
+
+        start = bench_now();
+        if (batched){
+            status = mem_new_alloc_batch(pool, sizes, BENCH_BATCH_SIZE, bufs);
+            assert(status == ALLOC_OK);
+        }
+        else{
+            for (unsigned i = 0; i < BENCH_BATCH_SIZE; i++){
+                bufs[i] = mem_new_alloc_addr(pool, sizes[i]);
+                assert(bufs[i]);
+            }
+        }
+        alloc_time += bench_now() - start;
+
+        start = bench_now();
+        if (batched){
+            status = mem_del_alloc_batch(pool, bufs, BENCH_BATCH_SIZE);
+            assert(status == ALLOC_OK);
+        }
+        else{
+            for (unsigned i = 0; i < BENCH_BATCH_SIZE; i++)
+                mem_del_alloc_addr(pool, bufs[i]);
+        }
+        *del_time += bench_now() - start;
+    }
+
+    for (unsigned i = 1; i < BENCH_FIFO_LIVE; i += 2)
+        mem_del_alloc_addr(pool, live[i]);
+    mem_pool_close(pool);
+    mem_free();
+    free(sizes);
+    free(bufs);
+    free(live);
+
+    *del_time *= 1e9 / ((double) BENCH_BATCH_REQUESTS * BENCH_BATCH_SIZE);
+    return alloc_time * 1e9 / ((double) BENCH_BATCH_REQUESTS * BENCH_BATCH_SIZE);
+}
+
+static void bench_batch(const char *name, const pool_opts_t *opts) {
+    double single_alloc, single_del, batch_alloc, batch_del;
+
+    single_alloc = bench_batch_run(opts, 0, &single_del);
+    batch_alloc = bench_batch_run(opts, 1, &batch_del);
+
+    printf("%-24s %8u bufs: %-14s alloc %6.1f / %6.1f, free %6.1f / %6.1f ns/buf (single / batch)\n",
+           "batch request", BENCH_BATCH_SIZE, name, single_alloc, batch_alloc, single_del, batch_del);
+}
+
+
+/*
+ * Serves requests whose scratch buffers (like bench_batch, without the
+ * other allocations) go into a FIRST_FIT pool and are freed one by one, or
+ * into an arena pool that is reset to a mark at the end of every request.
+ */
+static void bench_arena(void) {
+    const pool_opts_t ff_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP };
+    const pool_opts_t arena_opts = { .kind = POOL_ARENA };
+    size_t pool_size = 2 * BENCH_BATCH_SIZE * BENCH_MAX_ALLOC;
+    char **bufs = (char **) malloc(BENCH_BATCH_SIZE * sizeof(char *));
+    double start, ff_time, arena_time;
+    arena_mark_t mark;
+    pool_pt pool;
+
+    assert(bufs);
+    bench_seed = BENCH_SEED;
+    mem_init();
+    pool = mem_pool_open_opts(pool_size, &ff_opts);
+    assert(pool);
+    start = bench_now();
+    for (unsigned r = 0; r < BENCH_BATCH_REQUESTS; r++){
+        for (unsigned i = 0; i < BENCH_BATCH_SIZE; i++){
+            bufs[i] = mem_new_alloc_addr(pool, 1 + bench_rand() % BENCH_MAX_ALLOC);
+            assert(bufs[i]);
+        }
+        for (unsigned i = 0; i < BENCH_BATCH_SIZE; i++)
+            mem_del_alloc_addr(pool, bufs[i]);
+    }
+    ff_time = bench_now() - start;
+    mem_pool_close(pool);
+
+    bench_seed = BENCH_SEED;
+    pool = mem_pool_open_opts(pool_size, &arena_opts);
+    assert(pool);
+    start = bench_now();
+    for (unsigned r = 0; r < BENCH_BATCH_REQUESTS; r++){
+        mem_arena_mark(pool, &mark);
+        for (unsigned i = 0; i < BENCH_BATCH_SIZE; i++){
+            bufs[i] = mem_new_alloc_addr(pool, 1 + bench_rand() % BENCH_MAX_ALLOC);
+            assert(bufs[i]);
+        }
+        mem_arena_reset(pool, &mark);
+    }
+    arena_time = bench_now() - start;
+    mem_pool_close(pool);
+    mem_free();
+    free(bufs);
+
+    printf("%-24s %8u bufs: FIRST_FIT %6.1f, arena %6.1f ns/buf\n",
+           "scratch request", BENCH_BATCH_SIZE,
+           ff_time * 1e9 / ((double) BENCH_BATCH_REQUESTS * BENCH_BATCH_SIZE),
+           arena_time * 1e9 / ((double) BENCH_BATCH_REQUESTS * BENCH_BATCH_SIZE));
+}
+
+
+/*
+ * Builds buffers by appending BENCH_APPEND_STEP bytes at a time, up to
+ * BENCH_APPEND_SIZE, in a pool with 5k other allocations separated by gaps,
+ * growing each buffer with mem_realloc or with a new block, a copy and a
+ * deallocation. Times are per append.
+ */
+static double bench_append_run(const pool_opts_t *opts, int in_place) {
+    char **live = (char **) malloc(BENCH_FIFO_LIVE * sizeof(char *));
+    double start, append_time;
+    pool_pt pool;
+    char *buf, *new_buf;
+
+    assert(live);
+    bench_seed = BENCH_SEED;
+    mem_init();
+    pool = mem_pool_open_opts(4 * BENCH_FIFO_LIVE * BENCH_MAX_ALLOC + 2 * BENCH_APPEND_SIZE, opts);
+    assert(pool);
+    for (unsigned i = 0; i < BENCH_FIFO_LIVE; i++){
+        live[i] = mem_new_alloc_addr(pool, 1 + bench_rand() % BENCH_MAX_ALLOC);
+        assert(live[i]);
+    }
+    for (unsigned i = 0; i < BENCH_FIFO_LIVE; i += 2)
+        mem_del_alloc_addr(pool, live[i]);
+
+    start = bench_now();
+    for (unsigned b = 0; b < BENCH_APPEND_BUFS; b++){
+        buf = mem_new_alloc_addr(pool, BENCH_APPEND_STEP);
+        assert(buf);
+        memset(buf, (int) b, BENCH_APPEND_STEP);
+        for (size_t size = BENCH_APPEND_STEP; size < BENCH_APPEND_SIZE; size += BENCH_APPEND_STEP){
+            if (in_place){
+                new_buf = mem_realloc(pool, buf, size + BENCH_APPEND_STEP);
+            }
+            else{
+                new_buf = mem_new_alloc_addr(pool, size + BENCH_APPEND_STEP);
+                if (new_buf != NULL){
+                    memcpy(new_buf, buf, size);
+                    mem_del_alloc_addr(pool, buf);
+                }
+            }
+            assert(new_buf);
+            buf = new_buf;
+            memset(buf + size, (int) b, BENCH_APPEND_STEP);
+        }
+        mem_del_alloc_addr(pool, buf);
+    }
+    append_time = bench_now() - start;
+
+    for (unsigned i = 1; i < BENCH_FIFO_LIVE; i += 2)
+        mem_del_alloc_addr(pool, live[i]);
+    mem_pool_close(pool);
+    mem_free();
+    free(live);
+
+    return append_time * 1e9 / ((double) BENCH_APPEND_BUFS * (BENCH_APPEND_SIZE / BENCH_APPEND_STEP - 1));
+}
+
+static void bench_append(const char *name, const pool_opts_t *opts) {
+    double move_time = bench_append_run(opts, 0);
+    double realloc_time = bench_append_run(opts, 1);
+
+    printf("%-24s %8u bufs: %-14s move %6.1f, realloc %6.1f ns/append\n",
+           "append buffer", BENCH_APPEND_BUFS, name, move_time, realloc_time);
+}
+
+
+/*
+ * Allocates BENCH_ALIGNED_BUFS cache-line-sized blocks in a pool with 5k other
+ * allocations separated by gaps, with mem_new_alloc or aligned to a cache
+ * line. Returns the time per allocation, and the share of the blocks that
+ * straddle two cache lines in *split.
+ */
+static double bench_aligned_run(const pool_opts_t *opts, int aligned, double *split) {
+    char **live = (char **) malloc(BENCH_FIFO_LIVE * sizeof(char *));
+    char **bufs = (char **) malloc(BENCH_ALIGNED_BUFS * sizeof(char *));
+    double start, alloc_time;
+    unsigned num_split = 0;
+    alloc_pt alloc;
+    pool_pt pool;
+
+    assert(live && bufs);
+    bench_seed = BENCH_SEED;
+    mem_init();
+    pool = mem_pool_open_opts(4 * BENCH_FIFO_LIVE * BENCH_MAX_ALLOC, opts);
+    assert(pool);
+    for (unsigned i = 0; i < BENCH_FIFO_LIVE; i++){
+        live[i] = mem_new_alloc_addr(pool, 1 + bench_rand() % BENCH_MAX_ALLOC);
+        assert(live[i]);
+    }
+    for (unsigned i = 0; i < BENCH_FIFO_LIVE; i += 2)
+        mem_del_alloc_addr(pool, live[i]);
+
+    start = bench_now();
+    for (unsigned b = 0; b < BENCH_ALIGNED_BUFS; b++){
+        if (aligned)
+            alloc = mem_new_alloc_aligned(pool, BENCH_CACHE_LINE, BENCH_CACHE_LINE);
+        else
+            alloc = mem_new_alloc(pool, BENCH_CACHE_LINE);
+        assert(alloc);
+        bufs[b] = alloc->mem;
+    }
+    alloc_time = bench_now() - start;
+    for (unsigned b = 0; b < BENCH_ALIGNED_BUFS; b++){
+        if ((uintptr_t) bufs[b] % BENCH_CACHE_LINE != 0)
+            num_split++;
+        mem_del_alloc_addr(pool, bufs[b]);
+    }
+
+    for (unsigned i = 1; i < BENCH_FIFO_LIVE; i += 2)
+        mem_del_alloc_addr(pool, live[i]);
+    mem_pool_close(pool);
+    mem_free();
+    free(live);
+    free(bufs);
+
+    *split = 100.0 * num_split / BENCH_ALIGNED_BUFS;
+    return alloc_time * 1e9 / BENCH_ALIGNED_BUFS;
+}
+
+static void bench_aligned(const char *name, const pool_opts_t *opts) {
+    double plain_split, aligned_split;
+    double plain_time = bench_aligned_run(opts, 0, &plain_split);
+    double aligned_time = bench_aligned_run(opts, 1, &aligned_split);
+
+    printf("%-24s %8u bufs: %-14s plain %6.1f ns (%5.1f%% split), aligned %6.1f ns (%5.1f%% split)\n",
+           "aligned alloc", BENCH_ALIGNED_BUFS, name, plain_time, plain_split, aligned_time, aligned_split);
+}
+
+static void *bench_count(void *p) {
+    volatile unsigned long *counter = (volatile unsigned long *) p;
+
+    for (unsigned long i = 0; i < BENCH_COUNTER_OPS; i++)
+        (*counter)++;
+    return NULL;
+}
+
+// BENCH_COUNTERS threads each bump a counter of its own, allocated one after
+// the other, or each aligned to a cache line; returns the time in ms
+static double bench_counters_run(int aligned) {
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP };
+    pthread_t threads[BENCH_COUNTERS];
+    char *counters[BENCH_COUNTERS];
+    double start, elapsed;
+    alloc_pt alloc;
+    pool_pt pool;
+
+    mem_init();
+    pool = mem_pool_open_opts(BENCH_COUNTERS * BENCH_CACHE_LINE * 2, &opts);
+    assert(pool);
+    for (unsigned i = 0; i < BENCH_COUNTERS; i++){
+        if (aligned)
+            alloc = mem_new_alloc_aligned(pool, sizeof(unsigned long), BENCH_CACHE_LINE);
+        else
+            alloc = mem_new_alloc(pool, sizeof(unsigned long));
+        assert(alloc);
+        counters[i] = alloc->mem;
+        memset(counters[i], 0, sizeof(unsigned long));
+    }
+
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_COUNTERS; i++)
+        pthread_create(&threads[i], NULL, bench_count, counters[i]);
+    for (unsigned i = 0; i < BENCH_COUNTERS; i++)
+        pthread_join(threads[i], NULL);
+    elapsed = bench_now() - start;
+
+    for (unsigned i = 0; i < BENCH_COUNTERS; i++)
+        mem_del_alloc_addr(pool, counters[i]);
+    mem_pool_close(pool);
+    mem_free();
+    return elapsed * 1e3;
+}
+
+static void bench_counters(void) {
+    double packed_time = bench_counters_run(0);
+    double aligned_time = bench_counters_run(1);
+
+    printf("%-24s %8u thrs: packed %8.2f ms, aligned to a cache line %8.2f ms\n",
+           "per-thread counters", BENCH_COUNTERS, packed_time, aligned_time);
+}
+
+// the size of the largest gap of a pool
+static size_t bench_largest_gap(pool_pt pool) {
+    pool_segment_pt segments = NULL;
+    unsigned num_segments = 0;
+    size_t largest = 0;
+
+    mem_inspect_pool(pool, &segments, &num_segments);
+    for (unsigned i = 0; i < num_segments; i++){
+        if (!segments[i].allocated && segments[i].size > largest)
+            largest = segments[i].size;
+    }
+    free(segments);
+    return largest;
+}
+
+/*
+ * Fills a pool with BENCH_FIFO_LIVE blocks allocated by handle, and
+ * deallocates every other one, which leaves half of the pool free in
+ * thousands of small gaps. Compacts it with none of the blocks or one in
+ * BENCH_COMPACT_PINNED pinned, and prints the gaps and the largest of them
+ * before and after, and the time mem_pool_compact takes.
+ */
+static void bench_compact(const char *name, unsigned pin_every) {
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .handles = 1 };
+    alloc_handle_t *handles = (alloc_handle_t *) malloc(BENCH_FIFO_LIVE * sizeof(alloc_handle_t));
+    size_t *sizes = (size_t *) malloc(BENCH_FIFO_LIVE * sizeof(size_t));
+    size_t total = 0, largest_before;
+    unsigned gaps_before;
+    double start, compact_time;
+    pool_pt pool;
+
+    assert(handles && sizes);
+    bench_seed = BENCH_SEED;
+    for (unsigned i = 0; i < BENCH_FIFO_LIVE; i++){
+        sizes[i] = 1 + bench_rand() % BENCH_MAX_ALLOC;
+        total += sizes[i];
+    }
+    mem_init();
+    pool = mem_pool_open_opts(total, &opts);
+    assert(pool);
+    for (unsigned i = 0; i < BENCH_FIFO_LIVE; i++){
+        handles[i] = mem_new_handle(pool, sizes[i]);
+        assert(handles[i]);
+    }
+    for (unsigned i = 0; i < BENCH_FIFO_LIVE; i += 2)
+        mem_del_handle(pool, handles[i]);
+    for (unsigned i = 1; pin_every != 0 && i < BENCH_FIFO_LIVE; i += 2 * pin_every)
+        mem_pin(pool, handles[i]);
+    gaps_before = pool->num_gaps;
+    largest_before = bench_largest_gap(pool);
+
+    start = bench_now();
+    mem_pool_compact(pool);
+    compact_time = bench_now() - start;
+
+    printf("%-24s %8u blks: %-14s gaps %5u -> %5u, largest %7zu -> %7zu bytes, compact %7.1f us\n",
+           "compaction", BENCH_FIFO_LIVE / 2, name, gaps_before, pool->num_gaps,
+           largest_before, bench_largest_gap(pool), compact_time * 1e6);
+
+    for (unsigned i = 1; pin_every != 0 && i < BENCH_FIFO_LIVE; i += 2 * pin_every)
+        mem_unpin(pool, handles[i]);
+    for (unsigned i = 1; i < BENCH_FIFO_LIVE; i += 2)
+        mem_del_handle(pool, handles[i]);
+    mem_pool_close(pool);
+    mem_free();
+    free(handles);
+    free(sizes);
+}
+
+
+/*
+ * Opens a BENCH_MAPPED_SIZE pool, writes all of it once, and then reads
+ * words at random addresses in it, with the pool memory from malloc or mapped
+ * with the mmap options. A prefaulted pool takes longer to open, but its
+ * first pass takes no page faults; huge pages cut the TLB misses of the
+ * random reads.
+ */
+static void bench_mapped(const char *name, const pool_opts_t *opts) {
+    double start, open_time, write_time, read_time;
+    pool_pt pool;
+
+    bench_seed = BENCH_SEED;
+    mem_init();
+    start = bench_now();
+    pool = mem_pool_open_opts(BENCH_MAPPED_SIZE, opts);
+    open_time = bench_now() - start;
+    assert(pool);
+
+    start = bench_now();
+    memset(pool->mem, 1, BENCH_MAPPED_SIZE);
+    write_time = bench_now() - start;
+
+    start = bench_now();
+    for (unsigned i = 0; i < BENCH_MAPPED_READS; i++)
+        (void) *(volatile long *) (pool->mem + (bench_rand() % (BENCH_MAPPED_SIZE / sizeof(long))) * sizeof(long));
+    read_time = bench_now() - start;
+
+    mem_pool_close(pool);
+    mem_free();
+
+    printf("%-24s %8zu MiB: %-14s open %7.2f ms, first write %7.2f ms, random read %5.1f ns\n",
+           "mapped pool", BENCH_MAPPED_SIZE >> 20, name, open_time * 1e3, write_time * 1e3,
+           read_time * 1e9 / BENCH_MAPPED_READS);
+}
+
+
+/*
+ * A burst that allocates and writes BENCH_BURST_BLOCKS blocks of up to
+ * BENCH_BURST_MAX bytes in a BENCH_MAPPED_SIZE pool and then frees them all,
+ * twice. Reports the time of the frees, the pool memory still in RAM after
+ * them, and the time of the second burst, whose writes fault the pages back
+ * in if the frees gave them back.
+ */
+static void bench_burst(const char *name, size_t decommit) {
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .mmap = 1, .decommit = decommit };
+    char **bufs = (char **) malloc(BENCH_BURST_BLOCKS * sizeof(char *));
+    double start, free_time = 0, refill_time = 0;
+    rss_stats_t stats;
+    pool_pt pool;
+    size_t size;
+
+    assert(bufs);
+    bench_seed = BENCH_SEED;
+    mem_init();
+    pool = mem_pool_open_opts(BENCH_MAPPED_SIZE, &opts);
+    assert(pool);
+    for (unsigned burst = 0; burst < 2; burst++){
+        start = bench_now();
+        for (unsigned i = 0; i < BENCH_BURST_BLOCKS; i++){
+            size = 1 + bench_rand() % BENCH_BURST_MAX;
+            bufs[i] = mem_new_alloc_addr(pool, size);
+            assert(bufs[i]);
+            memset(bufs[i], 1, size);
+        }
+        if (burst == 1)
+            refill_time = bench_now() - start;
+
+        start = bench_now();
+        for (unsigned i = 0; i < BENCH_BURST_BLOCKS; i++)
+            mem_del_alloc_addr(pool, bufs[i]);
+        free_time += bench_now() - start;
+    }
+    mem_rss_stats(pool, &stats);
+    mem_pool_close(pool);
+    mem_free();
+    free(bufs);
+
+    printf("%-24s %8u bufs: %-14s free %6.2f ms, resident after %6.1f MiB, second burst %7.2f ms\n",
+           "burst", BENCH_BURST_BLOCKS, name, free_time * 1e3 / 2,
+           stats.resident / (double) (1 << 20), refill_time * 1e3);
+}
+
+
+/*
+ * The burst above in a pool opened at BENCH_GROWTH_SIZE that may grow to
+ * BENCH_MAPPED_SIZE (max_size non-zero), or in one opened at BENCH_MAPPED_SIZE.
+ * Reports the time of the burst, how much memory the pool holds at its peak
+ * and after the frees, and how much of it is in RAM then.
+ */
+static void bench_growth(const char *name, size_t max_size) {
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .mmap = 1, .max_size = max_size };
+    char **bufs = (char **) malloc(BENCH_BURST_BLOCKS * sizeof(char *));
+    double start, burst_time;
+    size_t size, peak_size;
+    rss_stats_t stats;
+    pool_pt pool;
+
+    assert(bufs);
+    bench_seed = BENCH_SEED;
+    mem_init();
+    start = bench_now();
+    pool = mem_pool_open_opts(max_size ? BENCH_GROWTH_SIZE : BENCH_MAPPED_SIZE, &opts);
+    assert(pool);
+    for (unsigned i = 0; i < BENCH_BURST_BLOCKS; i++){
+        size = 1 + bench_rand() % BENCH_BURST_MAX;
+        bufs[i] = mem_new_alloc_addr(pool, size);
+        assert(bufs[i]);
+        memset(bufs[i], 1, size);
+    }
+    burst_time = bench_now() - start;
+    peak_size = pool->total_size;
+    for (unsigned i = 0; i < BENCH_BURST_BLOCKS; i++)
+        mem_del_alloc_addr(pool, bufs[i]);
+    mem_rss_stats(pool, &stats);
+
+    printf("%-24s %8u bufs: %-14s burst %7.2f ms, peak %6.1f MiB, after %6.1f MiB (%6.1f MiB resident)\n",
+           "growth", BENCH_BURST_BLOCKS, name, burst_time * 1e3, peak_size / (double) (1 << 20),
+           pool->total_size / (double) (1 << 20), stats.resident / (double) (1 << 20));
+    mem_pool_close(pool);
+    mem_free();
+    free(bufs);
+}
+
+
+/*
+ * Fills a file-backed boundary-tag pool of BENCH_FILE_SIZE with
+ * BENCH_FILE_BLOCKS written blocks of up to BENCH_FILE_MAX bytes and closes
+ * it. Reports the time to reopen it, with the blocks in place, compared to
+ * the time to populate a new pool with them again.
+ */
+static void bench_file(void) {
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG, .path = BENCH_FILE_PATH };
+    double start, populate_time, reopen_time;
+    pool_pt pool;
+    size_t size;
+
+    remove(BENCH_FILE_PATH);
+    bench_seed = BENCH_SEED;
+    mem_init();
+    start = bench_now();
+    pool = mem_pool_open_opts(BENCH_FILE_SIZE, &opts);
+    assert(pool);
+    for (unsigned i = 0; i < BENCH_FILE_BLOCKS; i++){
+        size = 1 + bench_rand() % BENCH_FILE_MAX;
+        char *mem = mem_new_alloc_addr(pool, size);
+        assert(mem);
+        memset(mem, 1, size);
+    }
+    populate_time = bench_now() - start;
+    mem_pool_close(pool);
+
+    start = bench_now();
+    pool = mem_pool_open_opts(0, &opts);
+    reopen_time = bench_now() - start;
+    assert(pool && pool->num_allocs == BENCH_FILE_BLOCKS);
+    mem_pool_close(pool);
+    mem_free();
+    remove(BENCH_FILE_PATH);
+
+    printf("%-24s %8u bufs: populate %8.2f ms, reopen %8.3f ms\n",
+           "file-backed pool", BENCH_FILE_BLOCKS, populate_time * 1e3, reopen_time * 1e3);
+}
+
+
+// the consumer of bench_handoff_run: reads every buffer, and frees it if it is in the pool
+static void bench_handoff_consume(int fd, int by_offset) {
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG,
+                         .path = BENCH_SHARED_PATH, .shared = 1 };
+    static char copy[BENCH_HANDOFF_SIZE];
+    pool_pt pool = NULL;
+    unsigned long sum = 0;
+    size_t offset;
+    ssize_t got;
+    char *buf;
+
+    for (;;){
+        if (by_offset){
+            if (read(fd, &offset, sizeof(offset)) != (ssize_t) sizeof(offset))
+                break;
+            // the producer has created the pool by the time it sends the first offset
+            if (pool == NULL && (pool = mem_pool_open_opts(0, &opts)) == NULL)
+                _exit(1);
+            buf = pool->mem + offset;
+        }
+        else{
+            for (size_t done = 0; done < BENCH_HANDOFF_SIZE; done += (size_t) got){
+                got = read(fd, copy + done, BENCH_HANDOFF_SIZE - done);
+                if (got <= 0)
+                    break;
+            }
+            if (got <= 0)
+                break;
+            buf = copy;
+        }
+        for (size_t i = 0; i < BENCH_HANDOFF_SIZE; i += sizeof(long))
+            sum += *(long *) (buf + i);
+        if (pool != NULL)
+            mem_del_alloc_addr(pool, buf);
+    }
+    if (pool != NULL)
+        mem_pool_close(pool);
+    _exit(sum == 0);
+}
+
+// Hands BENCH_HANDOFF_BUFS buffers of BENCH_HANDOFF_SIZE bytes from this
+// process to a child through a pipe, as their offset in a shared pool or as
+// a copy of their contents, and returns the time per buffer.
+static double bench_handoff_run(int by_offset) {
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG,
+                         .path = BENCH_SHARED_PATH, .shared = 1 };
+    static char copy[BENCH_HANDOFF_SIZE];
+    pool_pt pool = NULL;
+    int fds[2], status;
+    double start, elapsed;
+    size_t offset;
+    pid_t child;
+    char *buf;
+
+    remove(BENCH_SHARED_PATH);
+    mem_init();
+    if (pipe(fds) != 0)
+        abort();
+    child = fork();
+    assert(child >= 0);
+    if (child == 0){
+        close(fds[1]);
+        bench_handoff_consume(fds[0], by_offset);
+    }
+    close(fds[0]);
+
+    start = bench_now();
+    if (by_offset){
+        pool = mem_pool_open_opts(BENCH_HANDOFF_POOL, &opts);
+        assert(pool);
+    }
+    for (unsigned i = 0; i < BENCH_HANDOFF_BUFS; i++){
+        if (by_offset){
+            // wait for the consumer if the pool is full
+            while ((buf = mem_new_alloc_addr(pool, BENCH_HANDOFF_SIZE)) == NULL)
+                sched_yield();
+            memset(buf, (int) i | 1, BENCH_HANDOFF_SIZE);
+            offset = (size_t) (buf - pool->mem);
+            if (write(fds[1], &offset, sizeof(offset)) != (ssize_t) sizeof(offset))
+                abort();
+        }
+        else{
+            memset(copy, (int) i | 1, BENCH_HANDOFF_SIZE);
+            if (write(fds[1], copy, BENCH_HANDOFF_SIZE) != BENCH_HANDOFF_SIZE)
+                abort();
+        }
+    }
+    close(fds[1]);
+    waitpid(child, &status, 0);
+    elapsed = bench_now() - start;
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    if (pool != NULL)
+        mem_pool_close(pool);
+    mem_free();
+    remove(BENCH_SHARED_PATH);
+    return elapsed * 1e9 / BENCH_HANDOFF_BUFS;
+}
+
+static void bench_handoff(void) {
+    double copy_time = bench_handoff_run(0);
+    double offset_time = bench_handoff_run(1);
+
+    printf("%-24s %8u bufs: pipe copy %8.1f, shared pool offset %8.1f ns/buf\n",
+           "process handoff", BENCH_HANDOFF_BUFS, copy_time, offset_time);
+}
+
+
+// Writes and reads a block of half of BENCH_NUMA_SIZE in a pool of pool_size
+// bytes, BENCH_NUMA_PASSES times, and returns the bandwidth in GB/s.
+static double bench_numa_run(const pool_opts_t *opts, size_t pool_size) {
+    size_t size = BENCH_NUMA_SIZE / 2;
+    double start, elapsed;
+    unsigned long sum = 0;
+    pool_pt pool;
+    char *buf;
+
+    mem_init();
+    pool = mem_pool_open_opts(pool_size, opts);
+    assert(pool);
+    buf = mem_new_alloc_addr(pool, size);
+    assert(buf);
+    memset(buf, 0, size);
+
+    start = bench_now();
+    for (unsigned pass = 0; pass < BENCH_NUMA_PASSES; pass++){
+        memset(buf, (int) pass, size);
+        for (size_t i = 0; i < size; i += sizeof(long))
+            sum += *(volatile long *) (buf + i);
+    }
+    elapsed = bench_now() - start;
+    assert(sum != 0 || BENCH_NUMA_PASSES == 1);
+
+    mem_del_alloc_addr(pool, buf);
+    mem_pool_close(pool);
+    mem_free();
+    return 2.0 * size * BENCH_NUMA_PASSES / elapsed / 1e9;
+}
+
+// the bandwidth from this thread's node to a pool bound to each node, and to a NUMA-local pool
+static void bench_numa(void) {
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .numa_bind = 1 };
+    uint64_t online = _numa_online();
+    char name[32];
+
+    for (unsigned node = 0; node < MEM_NUMA_MAX_NODES; node++){
+        if (((online >> node) & 1) == 0)
+            continue;
+        opts.numa_node = node;
+        snprintf(name, sizeof(name), "bound to node %u", node);
+        printf("%-24s %8zu MiB: %-18s from node %u %6.2f GB/s\n",
+               "numa placement", BENCH_NUMA_SIZE >> 20, name, _numa_of_thread(), bench_numa_run(&opts, BENCH_NUMA_SIZE));
+    }
+    // every node gets BENCH_NUMA_SIZE
+    opts = (pool_opts_t) { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .numa_local = 1 };
+    printf("%-24s %8zu MiB: %-18s from node %u %6.2f GB/s\n",
+           "numa placement", BENCH_NUMA_SIZE >> 20, "node-local", _numa_of_thread(),
+           bench_numa_run(&opts, BENCH_NUMA_SIZE * (size_t) __builtin_popcountll(online)));
+}
+
+
+/*****         driver routine          *****/
+
+int main(int argc, char *argv[]) {
+    const pool_opts_t ff_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP };
+    const pool_opts_t bf_opts = { .policy = BEST_FIT, .kind = POOL_NODE_HEAP };
+    const pool_opts_t sf_opts = { .policy = SEGREGATED_FIT, .kind = POOL_NODE_HEAP };
+    const pool_opts_t bt_opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG };
+    const pool_opts_t bd_opts = { .policy = BUDDY, .kind = POOL_NODE_HEAP };
+    const pool_opts_t sl_opts = { .policy = FIRST_FIT, .kind = POOL_SLAB, .obj_size = BENCH_OBJ_SIZE };
+    const pool_opts_t mm_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .mmap = 1 };
+    const pool_opts_t pf_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .prefault = 1 };
+    const pool_opts_t hp_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .huge_pages = 1, .prefault = 1 };
+
+    (void) argc;
+    (void) argv;
+
+    for (unsigned i = 0; i < sizeof(BENCH_GAP_COUNTS) / sizeof(BENCH_GAP_COUNTS[0]); i++)
+        bench_gap_index(BENCH_GAP_COUNTS[i]);
+    for (unsigned i = 0; i < sizeof(BENCH_GAP_COUNTS) / sizeof(BENCH_GAP_COUNTS[0]); i++)
+        bench_first_fit(BENCH_GAP_COUNTS[i]);
+    for (unsigned i = 0; i < sizeof(BENCH_GAP_COUNTS) / sizeof(BENCH_GAP_COUNTS[0]); i++)
+        bench_seg_miss(BENCH_GAP_COUNTS[i]);
+    bench_churn("churn", BENCH_CHURN_LIVE, 1, BENCH_MAX_ALLOC, "FIRST_FIT", &ff_opts);
+    bench_churn("churn", BENCH_CHURN_LIVE, 1, BENCH_MAX_ALLOC, "BEST_FIT", &bf_opts);
+    bench_churn("churn", BENCH_CHURN_LIVE, 1, BENCH_MAX_ALLOC, "SEGREGATED_FIT", &sf_opts);
+    bench_churn("churn", BENCH_CHURN_LIVE, 1, BENCH_MAX_ALLOC, "boundary tags", &bt_opts);
+    bench_churn("object churn", BENCH_CHURN_LIVE, BENCH_OBJ_SIZE, 1, "FIRST_FIT", &ff_opts);
+    bench_churn("object churn", BENCH_CHURN_LIVE, BENCH_OBJ_SIZE, 1, "SEGREGATED_FIT", &sf_opts);
+    bench_churn("object churn", BENCH_CHURN_LIVE, BENCH_OBJ_SIZE, 1, "boundary tags", &bt_opts);
+    bench_churn("object churn", BENCH_CHURN_LIVE, BENCH_OBJ_SIZE, 1, "slab", &sl_opts);
+    bench_churn("page churn", BENCH_PAGE_LIVE, BENCH_PAGE_SIZE, BENCH_MAX_PAGES, "FIRST_FIT", &ff_opts);
+    bench_churn("page churn", BENCH_PAGE_LIVE, BENCH_PAGE_SIZE, BENCH_MAX_PAGES, "BEST_FIT", &bf_opts);
+    bench_churn("page churn", BENCH_PAGE_LIVE, BENCH_PAGE_SIZE, BENCH_MAX_PAGES, "SEGREGATED_FIT", &sf_opts);
+    bench_churn("page churn", BENCH_PAGE_LIVE, BENCH_PAGE_SIZE, BENCH_MAX_PAGES, "BUDDY", &bd_opts);
+    bench_fifo(BENCH_FIFO_LIVE, FIRST_FIT, "FIRST_FIT");
+    bench_fifo(BENCH_FIFO_LIVE, NEXT_FIT, "NEXT_FIT");
+    bench_fifo(BENCH_FIFO_LIVE, BEST_FIT, "BEST_FIT");
+    bench_batch("FIRST_FIT", &ff_opts);
+    bench_batch("BEST_FIT", &bf_opts);
+    bench_batch("SEGREGATED_FIT", &sf_opts);
+    bench_batch("boundary tags", &bt_opts);
+    bench_arena();
+    bench_append("FIRST_FIT", &ff_opts);
+    bench_append("BEST_FIT", &bf_opts);
+    bench_append("SEGREGATED_FIT", &sf_opts);
+    bench_append("boundary tags", &bt_opts);
+    bench_aligned("FIRST_FIT", &ff_opts);
+    bench_aligned("BEST_FIT", &bf_opts);
+    bench_counters();
+    bench_compact("none pinned", 0);
+    bench_compact("1% pinned", BENCH_COMPACT_PINNED);
+    bench_mapped("malloc", &ff_opts);
+    bench_mapped("mmap", &mm_opts);
+    bench_mapped("prefault", &pf_opts);
+    bench_mapped("huge pages", &hp_opts);
+    bench_burst("kept", 0);
+    bench_burst("decommit 64k", (size_t) 64 << 10);
+    bench_burst("decommit 1M", (size_t) 1 << 20);
+    bench_growth("worst case", 0);
+    bench_growth("growable", BENCH_MAPPED_SIZE);
+    bench_file();
+    bench_handoff();
+    bench_numa();
+    for (unsigned i = 0; i < sizeof(BENCH_THREAD_COUNTS) / sizeof(BENCH_THREAD_COUNTS[0]); i++)
+        bench_threads(BENCH_THREAD_COUNTS[i]);
+    for (unsigned i = 0; i < sizeof(BENCH_THREAD_COUNTS) / sizeof(BENCH_THREAD_COUNTS[0]); i++)
+        bench_shared(BENCH_THREAD_COUNTS[i]);
+    for (unsigned i = 0; i < sizeof(BENCH_THREAD_COUNTS) / sizeof(BENCH_THREAD_COUNTS[0]); i++)
+        bench_sharded(BENCH_THREAD_COUNTS[i]);
+    for (unsigned i = 0; i < sizeof(BENCH_THREAD_COUNTS) / sizeof(BENCH_THREAD_COUNTS[0]); i++)
+        bench_remote(BENCH_THREAD_COUNTS[i]);
+    for (unsigned i = 0; i < sizeof(BENCH_CONTENTION_COUNTS) / sizeof(BENCH_CONTENTION_COUNTS[0]); i++)
+        bench_lock_free(BENCH_CONTENTION_COUNTS[i]);
+
+    return 0;
+}
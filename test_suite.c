@@ -4,10 +4,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <stdarg.h>
 #include <stddef.h>
 #include <setjmp.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include "cmocka.h"
 #include "mem_pool.h"
@@ -25,6 +30,10 @@
 
 static const unsigned NUM_TEST_ITERATIONS = NUM_ITERATIONS;
 static const unsigned POOL_SIZE           = 1000000;
+static const unsigned NUM_THREADS         = 4;
+static const unsigned NUM_THREAD_ALLOCS   = 1000;
+static const unsigned CACHE_OBJ_SIZE      = 16;
+static const unsigned CACHE_SLOTS         = 4;
 
 
 /*****         helper routines         *****/
@@ -235,36 +244,1588 @@ static void test_pool_nonempty(void **state) {
 }
 
 
+static void test_pool_addr(void **state) {
+    (void) state; /* unused */
+
+    pool_pt pool = NULL;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating pool of %lu bytes with policy %s\n", (long) POOL_SIZE, "BEST_FIT");
+    pool = mem_pool_open(POOL_SIZE, BEST_FIT);
+    assert_non_null(pool);
+
+    INFO("Allocating 100 and 200 bytes by address\n");
+    char *mem0 = mem_new_alloc_addr(pool, 100);
+    assert_true(mem0 == pool->mem);
+    char *mem1 = mem_new_alloc_addr(pool, 200);
+    assert_true(mem1 == pool->mem + 100);
+    assert_null(mem_new_alloc_addr(pool, 0));
+    assert_null(mem_new_alloc_addr(pool, POOL_SIZE));
+
+    INFO("Deallocating addresses which are not allocations\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem0 + 1), ALLOC_FAIL);
+    assert_int_equal(mem_del_alloc_addr(pool, pool->mem + 300), ALLOC_FAIL);
+    assert_int_equal(mem_del_alloc_addr(pool, NULL), ALLOC_FAIL);
+
+    INFO("Deallocating 100 bytes by address, twice\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_FAIL);
+
+    INFO("Allocating 100 bytes by record, deallocating it by address\n");
+    alloc_pt alloc = mem_new_alloc(pool, 100);
+    assert_non_null(alloc);
+    assert_true(alloc->mem == mem0);
+    assert_int_equal(mem_del_alloc_addr(pool, alloc->mem), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+
+    assert_int_equal(pool->num_allocs, 0);
+    assert_int_equal(pool->num_gaps, 1);
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void *thread_churn(void *arg) {
+    pool_pt pool = (pool_pt) arg;
+    char *mem[NUM_THREAD_ALLOCS];
+    pool_pt own_pool;
+    pool_opts_t opts = { .policy = BEST_FIT, .kind = POOL_NODE_HEAP };
+
+    // a private pool, to open and close alongside the other threads
+    own_pool = mem_pool_open_opts(POOL_SIZE / 10, &opts);
+    if (own_pool == NULL)
+        return arg;
+
+    for (unsigned round = 0; round < 10; ++round) {
+        for (unsigned i = 0; i < NUM_THREAD_ALLOCS; ++i) {
+            mem[i] = mem_new_alloc_addr(pool, 1 + i % 50);
+            if (mem[i] == NULL)
+                return arg;
+            memset(mem[i], (int) (i % 256), 1 + i % 50);
+        }
+        for (unsigned i = 0; i < NUM_THREAD_ALLOCS; ++i) {
+            // nobody else may have been handed these bytes
+            if (mem[i][i % 50] != (char) (i % 256))
+                return arg;
+            if (mem_del_alloc_addr(pool, mem[i]) != ALLOC_OK)
+                return arg;
+        }
+    }
+
+    if (mem_pool_close(own_pool) != ALLOC_OK)
+        return arg;
+    return NULL;
+}
+
+static void test_pool_threads(void **state) {
+    (void) state; /* unused */
+
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .thread_safe = 1 };
+    pthread_t threads[NUM_THREADS];
+    void *result;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating thread-safe pool of %lu bytes with policy %s\n", (long) POOL_SIZE, "FIRST_FIT");
+    pool = mem_pool_open_opts(POOL_SIZE, &opts);
+    assert_non_null(pool);
+
+    INFO("Churning the pool from %u threads\n", NUM_THREADS);
+    for (unsigned i = 0; i < NUM_THREADS; ++i) {
+        assert_int_equal(pthread_create(&threads[i], NULL, thread_churn, pool), 0);
+    }
+    for (unsigned i = 0; i < NUM_THREADS; ++i) {
+        assert_int_equal(pthread_join(threads[i], &result), 0);
+        assert_null(result);
+    }
+
+    assert_int_equal(pool->alloc_size, 0);
+    assert_int_equal(pool->num_allocs, 0);
+    assert_int_equal(pool->num_gaps, 1);
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+// empties the slab pool the calling thread's parent has taken every slot of,
+// closes it and opens a new one, which may get the old pool's address
+static void *cache_reopen(void *arg) {
+    pool_pt pool = (pool_pt) arg;
+    pool_opts_t opts = { .kind = POOL_SLAB, .obj_size = CACHE_OBJ_SIZE,
+                         .thread_safe = 1, .thread_cache = 1 };
+
+    for (unsigned i = 0; i < CACHE_SLOTS; ++i) {
+        if (mem_del_alloc_addr(pool, pool->mem + i * CACHE_OBJ_SIZE) != ALLOC_OK)
+            return NULL;
+    }
+    if (mem_cache_flush(pool) != ALLOC_OK || mem_pool_close(pool) != ALLOC_OK)
+        return NULL;
+    return mem_pool_open_opts(CACHE_SLOTS * CACHE_OBJ_SIZE, &opts);
+}
+
+static void *cache_stale(void *arg) {
+    pool_pt pool = (pool_pt) arg;
+    pool_pt new_pool;
+    cache_stats_t stats;
+    pthread_t thread;
+    char *mem;
+
+    // leaves this thread's cache of the pool empty, but with stats
+    for (unsigned i = 0; i < CACHE_SLOTS; ++i) {
+        if (mem_new_alloc_addr(pool, CACHE_OBJ_SIZE) == NULL)
+            return arg;
+    }
+    if (pthread_create(&thread, NULL, cache_reopen, pool) != 0
+        || pthread_join(thread, (void **) &new_pool) != 0 || new_pool == NULL)
+        return arg;
+
+    // a new pool at the old address does not inherit the old pool's cache
+    if (mem_cache_stats(new_pool, &stats) != ALLOC_OK || stats.alloc_hits != 0 || stats.alloc_misses != 0)
+        return arg;
+    mem = mem_new_alloc_addr(new_pool, CACHE_OBJ_SIZE);
+    if (mem == NULL || mem_cache_stats(new_pool, &stats) != ALLOC_OK
+        || stats.alloc_hits != 0 || stats.alloc_misses != 1)
+        return arg;
+    if (mem_del_alloc_addr(new_pool, mem) != ALLOC_OK
+        || mem_cache_flush(new_pool) != ALLOC_OK || mem_pool_close(new_pool) != ALLOC_OK)
+        return arg;
+    return NULL;
+}
+
+static void test_pool_thread_cache(void **state) {
+    (void) state; /* unused */
+
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG,
+                         .thread_safe = 1, .thread_cache = 1 };
+    pool_opts_t bad_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP,
+                             .thread_safe = 1, .thread_cache = 1 };
+    cache_stats_t stats;
+    pthread_t threads[NUM_THREADS];
+    void *result;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Node heap pools and pools that are not thread-safe cannot be cached\n");
+    assert_null(mem_pool_open_opts(POOL_SIZE, &bad_opts));
+    bad_opts.kind = POOL_BOUNDARY_TAG;
+    bad_opts.policy = SEGREGATED_FIT;
+    bad_opts.thread_safe = 0;
+    assert_null(mem_pool_open_opts(POOL_SIZE, &bad_opts));
+
+    INFO("Allocating thread-cached boundary-tag pool of %lu bytes\n", (long) POOL_SIZE);
+    pool = mem_pool_open_opts(POOL_SIZE, &opts);
+    assert_non_null(pool);
+
+    INFO("Allocating 10 bytes, which refills the cache with a batch of 16-byte blocks\n");
+    alloc_pt alloc = mem_new_alloc(pool, 10);
+    assert_non_null(alloc);
+    assert_int_equal(alloc->size, 16);
+    char *mem = alloc->mem;
+    assert_true(pool->num_allocs > 1);
+
+    INFO("Deallocating it and allocating 12 bytes, which gets it back from the cache\n");
+    unsigned num_allocs = pool->num_allocs;
+    assert_int_equal(mem_del_alloc(pool, alloc), ALLOC_OK);
+    assert_int_equal(pool->num_allocs, num_allocs);
+    assert_true(mem_new_alloc_addr(pool, 12) == mem);
+
+    INFO("Large requests bypass the cache\n");
+    char *large = mem_new_alloc_addr(pool, 1000);
+    assert_non_null(large);
+    assert_int_equal(mem_del_alloc_addr(pool, large), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, large), ALLOC_FAIL);
+
+    assert_int_equal(mem_cache_stats(pool, &stats), ALLOC_OK);
+    assert_int_equal(stats.alloc_hits, 1);
+    assert_int_equal(stats.alloc_misses, 1);
+    assert_int_equal(stats.del_hits, 1);
+    assert_int_equal(stats.del_misses, 2);
+    assert_int_equal(stats.flushed, 0);
+
+    INFO("The pool only closes once the cache is flushed\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem), ALLOC_OK);
+    assert_int_equal(mem_pool_close(pool), ALLOC_NOT_FREED);
+    assert_int_equal(mem_cache_flush(pool), ALLOC_OK);
+    assert_int_equal(pool->num_allocs, 0);
+    assert_int_equal(pool->num_gaps, 1);
+
+    INFO("Churning the pool from %u threads, whose caches are flushed when they exit\n", NUM_THREADS);
+    for (unsigned i = 0; i < NUM_THREADS; ++i) {
+        assert_int_equal(pthread_create(&threads[i], NULL, thread_churn, pool), 0);
+    }
+    for (unsigned i = 0; i < NUM_THREADS; ++i) {
+        assert_int_equal(pthread_join(threads[i], &result), 0);
+        assert_null(result);
+    }
+
+    assert_int_equal(pool->alloc_size, 0);
+    assert_int_equal(pool->num_allocs, 0);
+    assert_int_equal(pool->num_gaps, 1);
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("A thread's cache of a closed pool is not reused for a new pool at its address\n");
+    pool_opts_t slab_opts = { .kind = POOL_SLAB, .obj_size = CACHE_OBJ_SIZE,
+                              .thread_safe = 1, .thread_cache = 1 };
+    pool = mem_pool_open_opts(CACHE_SLOTS * CACHE_OBJ_SIZE, &slab_opts);
+    assert_non_null(pool);
+    assert_int_equal(pthread_create(&threads[0], NULL, cache_stale, pool), 0);
+    assert_int_equal(pthread_join(threads[0], &result), 0);
+    assert_null(result);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void *shard_alloc(void *arg) {
+    return mem_new_alloc_addr((pool_pt) arg, 300);
+}
+
+static void test_pool_shards(void **state) {
+    (void) state; /* unused */
+
+    const size_t SHARDED_SIZE = 4000;
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .shards = 4 };
+    pool_opts_t bad_opts = { .policy = BUDDY, .kind = POOL_NODE_HEAP, .shards = 4 };
+    pthread_t thread;
+    void *result;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Buddy and boundary-tag pools cannot be sharded\n");
+    assert_null(mem_pool_open_opts(SHARDED_SIZE, &bad_opts));
+    bad_opts.policy = SEGREGATED_FIT;
+    bad_opts.kind = POOL_BOUNDARY_TAG;
+    assert_null(mem_pool_open_opts(SHARDED_SIZE, &bad_opts));
+
+    INFO("Allocating pool of %lu bytes in 4 arenas with policy %s\n", (long) SHARDED_SIZE, "FIRST_FIT");
+    pool = mem_pool_open_opts(SHARDED_SIZE, &opts);
+    assert_non_null(pool);
+
+    pool_segment_t exp0[4] = { {1000, 0}, {1000, 0}, {1000, 0}, {1000, 0} };
+    check_pool(pool, exp0);
+    check_metadata(pool, FIRST_FIT, SHARDED_SIZE, 0, 0, 4);
+
+    INFO("Allocating 600 and 500 bytes in the first arena, which steals from the second\n");
+    char *mem0 = mem_new_alloc_addr(pool, 600);
+    assert_true(mem0 == pool->mem);
+    char *mem1 = mem_new_alloc_addr(pool, 500);
+    assert_true(mem1 == pool->mem + 600);
+
+    pool_segment_t exp1[6] = { {600, 1}, {500, 1}, {400, 0}, {500, 0}, {1000, 0}, {1000, 0} };
+    check_pool(pool, exp1);
+    check_metadata(pool, FIRST_FIT, SHARDED_SIZE, 1100, 2, 4);
+
+    INFO("Allocating 300 bytes from another thread, which gets the second arena\n");
+    assert_int_equal(pthread_create(&thread, NULL, shard_alloc, pool), 0);
+    assert_int_equal(pthread_join(thread, &result), 0);
+    char *mem2 = (char *) result;
+    assert_true(mem2 == pool->mem + 1500);
+
+    pool_segment_t exp2[7] = { {600, 1}, {500, 1}, {400, 0}, {300, 1}, {200, 0}, {1000, 0}, {1000, 0} };
+    check_pool(pool, exp2);
+    check_metadata(pool, FIRST_FIT, SHARDED_SIZE, 1400, 3, 4);
+
+    INFO("Deallocating everything by address, from the first thread\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem0 + 1), ALLOC_FAIL);
+    assert_int_equal(mem_del_alloc_addr(pool, pool->mem + SHARDED_SIZE), ALLOC_FAIL);
+    assert_int_equal(mem_del_alloc_addr(pool, mem2), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_FAIL);
+
+    pool_segment_t exp3[4] = { {1500, 0}, {500, 0}, {1000, 0}, {1000, 0} };
+    check_pool(pool, exp3);
+    check_metadata(pool, FIRST_FIT, SHARDED_SIZE, 0, 0, 4);
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void *remote_del(void *arg) {
+    pool_pt pool = (pool_pt) arg;
+
+    // the first two blocks of the pool, then an address past its end
+    if (mem_del_alloc_addr(pool, pool->mem + 100) != ALLOC_OK
+        || mem_del_alloc_addr(pool, pool->mem) != ALLOC_OK
+        || mem_del_alloc_addr(pool, pool->mem + POOL_SIZE) != ALLOC_FAIL)
+        return pool;
+    return NULL;
+}
+
+static void *remote_del_last(void *arg) {
+    pool_pt pool = (pool_pt) arg;
+
+    return (mem_del_alloc_addr(pool, pool->mem + 200) == ALLOC_OK) ? NULL : pool;
+}
+
+static void test_pool_remote_free(void **state) {
+    (void) state; /* unused */
+
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .remote_free = 1 };
+    pool_opts_t bad_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP,
+                             .remote_free = 1, .shards = 4 };
+    pthread_t thread;
+    void *result;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Sharded pools cannot queue remote deallocations\n");
+    assert_null(mem_pool_open_opts(POOL_SIZE, &bad_opts));
+
+    INFO("Allocating remote-free pool of %lu bytes with policy %s\n", (long) POOL_SIZE, "FIRST_FIT");
+    pool = mem_pool_open_opts(POOL_SIZE, &opts);
+    assert_non_null(pool);
+
+    char *mem0 = mem_new_alloc_addr(pool, 100);
+    char *mem1 = mem_new_alloc_addr(pool, 100);
+    char *mem2 = mem_new_alloc_addr(pool, 100);
+    assert_true(mem0 == pool->mem && mem1 == pool->mem + 100 && mem2 == pool->mem + 200);
+
+    INFO("Deallocating the first two blocks from another thread, which only queues them\n");
+    assert_int_equal(pthread_create(&thread, NULL, remote_del, pool), 0);
+    assert_int_equal(pthread_join(thread, &result), 0);
+    assert_null(result);
+    assert_int_equal(pool->alloc_size, 300);
+    assert_int_equal(pool->num_allocs, 3);
+    assert_int_equal(pool->num_gaps, 1);
+
+    INFO("Allocating 1 byte, which deallocates the queue first and takes the size of a pointer\n");
+    alloc_pt alloc = mem_new_alloc(pool, 1);
+    assert_non_null(alloc);
+    assert_true(alloc->mem == mem0);
+    assert_int_equal(alloc->size, sizeof(char *));
+
+    pool_segment_t exp[4] = { {sizeof(char *), 1}, {200 - sizeof(char *), 0},
+                              {100, 1}, {POOL_SIZE - 300, 0} };
+    check_pool(pool, exp);
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 100 + sizeof(char *), 2, 2);
+
+    INFO("Deallocating the last block from another thread, which closing carries out\n");
+    assert_int_equal(mem_del_alloc(pool, alloc), ALLOC_OK);
+    assert_int_equal(pthread_create(&thread, NULL, remote_del_last, pool), 0);
+    assert_int_equal(pthread_join(thread, &result), 0);
+    assert_null(result);
+    assert_int_equal(pool->num_allocs, 1);
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void test_pool_lock_free(void **state) {
+    (void) state; /* unused */
+
+    const size_t OBJ_SIZE = 50;
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .kind = POOL_SLAB, .obj_size = OBJ_SIZE, .lock_free = 1 };
+    pool_opts_t bad_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .lock_free = 1 };
+    pthread_t threads[NUM_THREADS];
+    void *result;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Only slab pools can be lock-free\n");
+    assert_null(mem_pool_open_opts(POOL_SIZE, &bad_opts));
+
+    INFO("Allocating lock-free slab pool of %lu bytes for objects of %lu bytes\n",
+         (long) POOL_SIZE, (long) OBJ_SIZE);
+    pool = mem_pool_open_opts(POOL_SIZE, &opts);
+    assert_non_null(pool);
+    unsigned num_slots = pool->num_gaps;
+    size_t slot_size = pool->total_size / num_slots;
+
+    INFO("Allocating three objects, which take the first slots\n");
+    alloc_pt alloc0 = mem_new_alloc(pool, OBJ_SIZE);
+    char *mem1 = mem_new_alloc_addr(pool, 10);
+    char *mem2 = mem_new_alloc_addr(pool, OBJ_SIZE);
+    assert_non_null(alloc0);
+    assert_true(alloc0->mem == pool->mem);
+    assert_true(mem1 == pool->mem + slot_size && mem2 == pool->mem + 2 * slot_size);
+    assert_null(mem_new_alloc(pool, OBJ_SIZE + slot_size));
+    assert_int_equal(pool->alloc_size, 2 * OBJ_SIZE + 10);
+    assert_int_equal(pool->num_allocs, 3);
+    assert_int_equal(pool->num_gaps, num_slots - 3);
+
+    INFO("Deallocating the middle one, which is handed out again next\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem1 + 1), ALLOC_FAIL);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_FAIL);
+    assert_true(mem_new_alloc_addr(pool, OBJ_SIZE) == mem1);
+
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem2), ALLOC_OK);
+
+    INFO("Churning the pool from %u threads\n", NUM_THREADS);
+    for (unsigned i = 0; i < NUM_THREADS; ++i) {
+        assert_int_equal(pthread_create(&threads[i], NULL, thread_churn, pool), 0);
+    }
+    for (unsigned i = 0; i < NUM_THREADS; ++i) {
+        assert_int_equal(pthread_join(threads[i], &result), 0);
+        assert_null(result);
+    }
+
+    assert_int_equal(pool->alloc_size, 0);
+    assert_int_equal(pool->num_allocs, 0);
+    assert_int_equal(pool->num_gaps, num_slots);
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void test_pool_batch(void **state) {
+    (void) state; /* unused */
+
+    pool_pt pool = NULL;
+    const size_t sizes[4] = { 100, 200, 300, 400 };
+    const size_t too_large[2] = { 100, POOL_SIZE };
+    char *mem[4];
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating pool of %lu bytes with policy %s\n", (long) POOL_SIZE, "FIRST_FIT");
+    pool = mem_pool_open(POOL_SIZE, FIRST_FIT);
+    assert_non_null(pool);
+
+    INFO("Allocating a batch of 4 blocks\n");
+    assert_int_equal(mem_new_alloc_batch(pool, sizes, 4, mem), ALLOC_OK);
+    assert_true(mem[0] == pool->mem && mem[1] == pool->mem + 100
+                && mem[2] == pool->mem + 300 && mem[3] == pool->mem + 600);
+
+    INFO("A batch that does not fit allocates nothing\n");
+    char *none[2];
+    assert_int_equal(mem_new_alloc_batch(pool, too_large, 2, none), ALLOC_FAIL);
+    assert_null(none[0]);
+    assert_null(none[1]);
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 1000, 4, 1);
+
+    INFO("Deallocating the first 3 blocks in a batch, out of order, which coalesces them\n");
+    char *dels[3] = { mem[2], mem[0], mem[1] };
+    assert_int_equal(mem_del_alloc_batch(pool, dels, 3), ALLOC_OK);
+
+    pool_segment_t exp[3] = { {600, 0}, {400, 1}, {POOL_SIZE - 1000, 0} };
+    check_pool(pool, exp);
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 400, 1, 2);
+
+    INFO("A batch naming a block twice deallocates it once, and fails\n");
+    char *twice[2] = { mem[3], mem[3] };
+    assert_int_equal(mem_del_alloc_batch(pool, twice, 2), ALLOC_FAIL);
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 0, 0, 1);
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void test_pool_arena(void **state) {
+    (void) state; /* unused */
+
+    const size_t ARENA_SIZE = 1000;
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .kind = POOL_ARENA };
+    arena_mark_t mark;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating arena pool of %lu bytes\n", (long) ARENA_SIZE);
+    pool = mem_pool_open_opts(ARENA_SIZE, &opts);
+    assert_non_null(pool);
+
+    INFO("Allocating 10 bytes, with the record in front of them, and 20 bytes by address\n");
+    alloc_pt alloc = mem_new_alloc(pool, 10);
+    assert_non_null(alloc);
+    assert_true((char *) alloc == pool->mem);
+    assert_true(alloc->mem == pool->mem + sizeof(alloc_t));
+    assert_int_equal(alloc->size, 10);
+    char *mem0 = mem_new_alloc_addr(pool, 20);
+    assert_true(mem0 == pool->mem + 32);
+
+    INFO("Taking a mark and allocating 100 more bytes\n");
+    assert_int_equal(mem_arena_mark(pool, &mark), ALLOC_OK);
+    char *mem1 = mem_new_alloc_addr(pool, 100);
+    assert_true(mem1 == pool->mem + 56);
+
+    pool_segment_t exp0[2] = { {160, 1}, {ARENA_SIZE - 160, 0} };
+    check_pool(pool, exp0);
+    check_metadata(pool, FIRST_FIT, ARENA_SIZE, 130, 3, 1);
+
+    INFO("Deallocating does nothing, for blocks below the top\n");
+    assert_int_equal(mem_del_alloc(pool, alloc), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, pool->mem + 160), ALLOC_FAIL);
+    assert_null(mem_new_alloc_addr(pool, ARENA_SIZE - 159));
+    check_metadata(pool, FIRST_FIT, ARENA_SIZE, 130, 3, 1);
+
+    INFO("Resetting to the mark, which hands out the same memory again\n");
+    assert_int_equal(mem_arena_reset(pool, &mark), ALLOC_OK);
+    check_metadata(pool, FIRST_FIT, ARENA_SIZE, 30, 2, 1);
+    assert_true(mem_new_alloc_addr(pool, ARENA_SIZE - 56) == mem1);
+    check_metadata(pool, FIRST_FIT, ARENA_SIZE, ARENA_SIZE - 26, 3, 0);
+
+    INFO("Resetting the whole pool\n");
+    assert_int_equal(mem_arena_reset(pool, NULL), ALLOC_OK);
+    assert_int_equal(mem_arena_reset(pool, &mark), ALLOC_FAIL);
+    pool_segment_t exp1[1] = { {ARENA_SIZE, 0} };
+    check_pool(pool, exp1);
+    check_metadata(pool, FIRST_FIT, ARENA_SIZE, 0, 0, 1);
+
+    INFO("Closing pool, which releases what is still allocated\n");
+    assert_non_null(mem_new_alloc_addr(pool, 100));
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+
+static void test_pool_realloc(void **state) {
+    (void) state; /* unused */
+
+    const size_t REALLOC_SIZE = 1000;
+    pool_pt pool = NULL;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating first-fit pool of %lu bytes, and two blocks of 100 bytes\n", (long) REALLOC_SIZE);
+    pool = mem_pool_open(REALLOC_SIZE, FIRST_FIT);
+    assert_non_null(pool);
+    char *mem0 = mem_new_alloc_addr(pool, 100);
+    char *mem1 = mem_new_alloc_addr(pool, 100);
+    assert_true(mem1 == mem0 + 100);
+
+    INFO("Growing the second block into the gap after it\n");
+    assert_true(mem_realloc(pool, mem1, 300) == mem1);
+    pool_segment_t exp0[3] = { {100, 1}, {300, 1}, {600, 0} };
+    check_pool(pool, exp0);
+    check_metadata(pool, FIRST_FIT, REALLOC_SIZE, 400, 2, 1);
+
+    INFO("Shrinking it, which gives the tail to the gap after it\n");
+    assert_true(mem_realloc(pool, mem1, 200) == mem1);
+    pool_segment_t exp1[3] = { {100, 1}, {200, 1}, {700, 0} };
+    check_pool(pool, exp1);
+    check_metadata(pool, FIRST_FIT, REALLOC_SIZE, 300, 2, 1);
+
+    INFO("Shrinking the first block, which makes the tail a new gap\n");
+    assert_true(mem_realloc(pool, mem0, 40) == mem0);
+    pool_segment_t exp2[4] = { {40, 1}, {60, 0}, {200, 1}, {700, 0} };
+    check_pool(pool, exp2);
+    check_metadata(pool, FIRST_FIT, REALLOC_SIZE, 240, 2, 2);
+
+    INFO("Growing it back, which uses up that gap\n");
+    assert_true(mem_realloc(pool, mem0, 100) == mem0);
+    check_pool(pool, exp1);
+    check_metadata(pool, FIRST_FIT, REALLOC_SIZE, 300, 2, 1);
+
+    INFO("Growing it past its neighbour, which moves the contents\n");
+    for (unsigned i = 0; i < 100; i++){
+        mem0[i] = (char) i;
+    }
+    char *mem2 = mem_realloc(pool, mem0, 150);
+    assert_true(mem2 == mem1 + 200);
+    for (unsigned i = 0; i < 100; i++){
+        assert_int_equal(mem2[i], (char) i);
+    }
+    pool_segment_t exp3[4] = { {100, 0}, {200, 1}, {150, 1}, {550, 0} };
+    check_pool(pool, exp3);
+    check_metadata(pool, FIRST_FIT, REALLOC_SIZE, 350, 2, 2);
+
+    INFO("Failing to grow past the pool, or to resize a block that is not allocated\n");
+    assert_null(mem_realloc(pool, mem1, REALLOC_SIZE));
+    assert_null(mem_realloc(pool, mem0, 50));
+    assert_null(mem_realloc(pool, mem1, 0));
+    check_pool(pool, exp3);
+
+    INFO("Resizing nothing allocates\n");
+    assert_true(mem_realloc(pool, NULL, 50) == mem0);
+    check_metadata(pool, FIRST_FIT, REALLOC_SIZE, 400, 3, 2);
+
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem2), ALLOC_OK);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Growing and shrinking a block of a boundary-tag pool in place\n");
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG };
+    pool = mem_pool_open_opts(REALLOC_SIZE, &opts);
+    assert_non_null(pool);
+    mem0 = mem_new_alloc_addr(pool, 100);
+    assert_true(mem_realloc(pool, mem0, 500) == mem0);
+    check_metadata(pool, SEGREGATED_FIT, REALLOC_SIZE, 500, 1, 1);
+    assert_true(mem_realloc(pool, mem0, 10) == mem0);
+    mem1 = mem_new_alloc_addr(pool, REALLOC_SIZE - 100);
+    assert_non_null(mem1);
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+
+static void test_pool_aligned(void **state) {
+    (void) state; /* unused */
+
+    pool_pt pool = NULL;
+    // mapped pools start on a page boundary, so that offsets in the pool are aligned as the addresses
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .mmap = 1 };
+    pool_opts_t tag_opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG };
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Alignments that are not powers of two, and boundary-tag pools, are refused\n");
+    pool = mem_pool_open_opts(4096, &opts);
+    assert_non_null(pool);
+    assert_null(mem_new_alloc_aligned(pool, 100, 48));
+    assert_null(mem_new_alloc_aligned(pool, 100, 0));
+    pool_pt tag_pool = mem_pool_open_opts(4096, &tag_opts);
+    assert_non_null(tag_pool);
+    assert_null(mem_new_alloc_aligned(tag_pool, 100, 64));
+    assert_int_equal(mem_pool_close(tag_pool), ALLOC_OK);
+
+    INFO("FIRST_FIT: allocating 1, then 100 at 64, which leaves a gap of 63 in front\n");
+    alloc_pt alloc0 = mem_new_alloc(pool, 1);
+    alloc_pt alloc1 = mem_new_alloc_aligned(pool, 100, 64);
+    assert_non_null(alloc0);
+    assert_non_null(alloc1);
+    assert_ptr_equal(alloc1->mem, pool->mem + 64);
+    pool_segment_t exp0[4] = { {1, 1}, {63, 0}, {100, 1}, {3932, 0} };
+    check_pool(pool, exp0);
+
+    INFO("Allocating 10 at 16, which fits in the gap in front\n");
+    alloc_pt alloc2 = mem_new_alloc_aligned(pool, 10, 16);
+    assert_non_null(alloc2);
+    assert_ptr_equal(alloc2->mem, pool->mem + 16);
+    pool_segment_t exp1[6] = { {1, 1}, {15, 0}, {10, 1}, {38, 0}, {100, 1}, {3932, 0} };
+    check_pool(pool, exp1);
+
+    INFO("Deallocating the aligned blocks merges the gaps again\n");
+    char *mem2 = alloc2->mem;
+    assert_int_equal(mem_del_alloc_addr(pool, alloc1->mem), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem2), ALLOC_OK);
+    pool_segment_t exp2[2] = { {1, 1}, {4095, 0} };
+    check_pool(pool, exp2);
+    assert_int_equal(mem_del_alloc_addr(pool, pool->mem), ALLOC_OK);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("BEST_FIT: gaps of 40 at 8 and of 200 at 56\n");
+    opts.policy = BEST_FIT;
+    pool = mem_pool_open_opts(4096, &opts);
+    assert_non_null(pool);
+    const size_t sizes[5] = { 8, 40, 8, 200, 8 };
+    char *mems[5];
+    for (unsigned i = 0; i < 5; i++){
+        mems[i] = mem_new_alloc_addr(pool, sizes[i]);
+        assert_non_null(mems[i]);
+    }
+    assert_int_equal(mem_del_alloc_addr(pool, mems[1]), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mems[3]), ALLOC_OK);
+
+    INFO("Allocating 32 at 32, which only the gap of 200 holds once aligned\n");
+    alloc_pt alloc3 = mem_new_alloc_aligned(pool, 32, 32);
+    assert_non_null(alloc3);
+    assert_ptr_equal(alloc3->mem, pool->mem + 64);
+    pool_segment_t exp3[8] = { {8, 1}, {40, 0}, {8, 1}, {8, 0}, {32, 1}, {160, 0}, {8, 1}, {3832, 0} };
+    check_pool(pool, exp3);
+
+    INFO("Allocating 16 at 16, which the gap of 40 is the smallest to hold\n");
+    alloc_pt alloc4 = mem_new_alloc_aligned(pool, 16, 16);
+    assert_non_null(alloc4);
+    assert_ptr_equal(alloc4->mem, pool->mem + 16);
+    pool_segment_t exp4[10] = { {8, 1}, {8, 0}, {16, 1}, {16, 0}, {8, 1}, {8, 0}, {32, 1}, {160, 0},
+                                {8, 1}, {3832, 0} };
+    check_pool(pool, exp4);
+    check_metadata(pool, BEST_FIT, 4096, 72, 5, 5);
+
+    assert_int_equal(mem_del_alloc_addr(pool, pool->mem + 16), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, pool->mem + 64), ALLOC_OK);
+    for (unsigned i = 0; i < 5; i += 2)
+        assert_int_equal(mem_del_alloc_addr(pool, mems[i]), ALLOC_OK);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void test_pool_handles(void **state) {
+    (void) state; /* unused */
+
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .handles = 1 };
+    alloc_handle_t handles[5];
+    char *mem;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Buddy pools, and pools without a handle table, are refused\n");
+    opts.policy = BUDDY;
+    assert_null(mem_pool_open_opts(1024, &opts));
+    opts.policy = FIRST_FIT;
+    pool = mem_pool_open(1000, FIRST_FIT);
+    assert_non_null(pool);
+    assert_int_equal(mem_new_handle(pool, 100), 0);
+    assert_int_equal(mem_pool_compact(pool), ALLOC_FAIL);
+    assert_int_equal(mem_pool_close(pool), ALLOC_OK);
+
+    INFO("Allocating 5 blocks of 100 by handle, and deallocating the 1st and the 3rd\n");
+    pool = mem_pool_open_opts(1000, &opts);
+    assert_non_null(pool);
+    for (unsigned i = 0; i < 5; i++){
+        handles[i] = mem_new_handle(pool, 100);
+        assert_int_not_equal(handles[i], 0);
+        mem = mem_pin(pool, handles[i]);
+        assert_ptr_equal(mem, pool->mem + 100 * i);
+        memset(mem, 'a' + i, 100);
+        assert_int_equal(mem_unpin(pool, handles[i]), ALLOC_OK);
+    }
+    assert_int_equal(mem_del_handle(pool, handles[0]), ALLOC_OK);
+    assert_int_equal(mem_del_handle(pool, handles[2]), ALLOC_OK);
+    assert_null(mem_pin(pool, handles[0]));
+    assert_int_equal(mem_del_handle(pool, handles[2]), ALLOC_FAIL);
+    pool_segment_t exp0[6] = { {100, 0}, {100, 1}, {100, 0}, {100, 1}, {100, 1}, {500, 0} };
+    check_pool(pool, exp0);
+
+    INFO("A block with a handle is not found by its address, and 600 bytes do not fit\n");
+    assert_int_equal(mem_del_alloc_addr(pool, pool->mem + 100), ALLOC_FAIL);
+    assert_null(mem_realloc(pool, pool->mem + 100, 50));
+    assert_null(mem_new_alloc(pool, 600));
+
+    INFO("Compacting with the 4th block pinned, which stays where it is\n");
+    mem = mem_pin(pool, handles[3]);
+    assert_ptr_equal(mem, pool->mem + 300);
+    assert_int_equal(mem_del_handle(pool, handles[3]), ALLOC_FAIL);
+    status = mem_pool_compact(pool);
+    assert_int_equal(status, ALLOC_OK);
+    pool_segment_t exp1[5] = { {100, 1}, {200, 0}, {100, 1}, {100, 1}, {500, 0} };
+    check_pool(pool, exp1);
+    char expect[100];
+    memset(expect, 'b', 100);
+    assert_memory_equal(pool->mem, expect, 100);
+    assert_ptr_equal(mem_pin(pool, handles[1]), pool->mem);
+    assert_int_equal(mem_unpin(pool, handles[1]), ALLOC_OK);
+
+    INFO("Unpinning it and compacting again leaves a single gap at the end\n");
+    assert_int_equal(mem_unpin(pool, handles[3]), ALLOC_OK);
+    assert_int_equal(mem_unpin(pool, handles[3]), ALLOC_FAIL);
+    status = mem_pool_compact(pool);
+    assert_int_equal(status, ALLOC_OK);
+    pool_segment_t exp2[4] = { {100, 1}, {100, 1}, {100, 1}, {700, 0} };
+    check_pool(pool, exp2);
+    check_metadata(pool, FIRST_FIT, 1000, 300, 3, 1);
+    for (unsigned i = 1; i < 5; i += 2){
+        memset(expect, 'a' + i, 100);
+        mem = mem_pin(pool, handles[i]);
+        assert_ptr_equal(mem, pool->mem + 100 * (i / 2));
+        assert_memory_equal(mem, expect, 100);
+        assert_int_equal(mem_unpin(pool, handles[i]), ALLOC_OK);
+    }
+
+    INFO("Now 600 bytes fit, and a freed handle is handed out again\n");
+    alloc_pt alloc = mem_new_alloc(pool, 600);
+    assert_non_null(alloc);
+    assert_ptr_equal(alloc->mem, pool->mem + 300);
+    assert_int_equal(mem_new_handle(pool, 50), handles[2]);
+    pool_segment_t exp3[6] = { {100, 1}, {100, 1}, {100, 1}, {600, 1}, {50, 1}, {50, 0} };
+    check_pool(pool, exp3);
+
+    assert_int_equal(mem_del_alloc(pool, alloc), ALLOC_OK);
+    for (unsigned i = 1; i < 5; i++)
+        assert_int_equal(mem_del_handle(pool, handles[i]), ALLOC_OK);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void test_pool_mapped(void **state) {
+    (void) state; /* unused */
+
+    const size_t MAPPED_SIZE = (3 << 20) + 5;
+    const size_t HUGE_PAGE = 2 << 20;
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = BEST_FIT, .kind = POOL_NODE_HEAP, .huge_pages = 1, .prefault = 1 };
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Mapping pool of %lu bytes with huge pages, prefaulted\n", (long) MAPPED_SIZE);
+    pool = mem_pool_open_opts(MAPPED_SIZE, &opts);
+    assert_non_null(pool);
+    assert_int_equal((size_t) pool->mem % HUGE_PAGE, 0);
+    check_metadata(pool, BEST_FIT, MAPPED_SIZE, 0, 0, 1);
+
+    INFO("Allocating and filling the whole pool\n");
+    char *mem = mem_new_alloc_addr(pool, MAPPED_SIZE);
+    assert_true(mem == pool->mem);
+    memset(mem, 0xab, MAPPED_SIZE);
+    assert_int_equal(mem_del_alloc_addr(pool, mem), ALLOC_OK);
+
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Mapping a sharded pool of 100 bytes\n");
+    memset(&opts, 0, sizeof(opts));
+    opts.mmap = 1;
+    opts.shards = 2;
+    pool = mem_pool_open_opts(100, &opts);
+    assert_non_null(pool);
+    mem = mem_new_alloc_addr(pool, 50);
+    assert_non_null(mem);
+    memset(mem, 0xab, 50);
+    assert_int_equal(mem_del_alloc_addr(pool, mem), ALLOC_OK);
+
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+
+static void test_pool_decommit(void **state) {
+    (void) state; /* unused */
+
+    const size_t PAGE = 4096;
+    const size_t DECOMMIT_SIZE = 256 * PAGE;
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .decommit = 16 * PAGE };
+    rss_stats_t stats;
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Mapping pool of %lu bytes, whose gaps of 16 pages or more give their pages back\n", (long) DECOMMIT_SIZE);
+    pool = mem_pool_open_opts(DECOMMIT_SIZE, &opts);
+    assert_non_null(pool);
+    assert_int_equal(mem_rss_stats(pool, &stats), ALLOC_OK);
+    assert_int_equal(stats.resident, 0);
+
+    INFO("Allocating and filling 128 pages, and 1 page after them\n");
+    char *mem0 = mem_new_alloc_addr(pool, 128 * PAGE);
+    char *mem1 = mem_new_alloc_addr(pool, PAGE);
+    memset(mem0, 0xab, 128 * PAGE);
+    memset(mem1, 0xab, PAGE);
+    assert_int_equal(mem_rss_stats(pool, &stats), ALLOC_OK);
+    assert_int_equal(stats.resident, 129 * PAGE);
+    assert_int_equal(stats.decommits, 0);
+
+    INFO("Deallocating the 128 pages, which go back to the OS\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_OK);
+    assert_int_equal(mem_rss_stats(pool, &stats), ALLOC_OK);
+    assert_int_equal(stats.resident, PAGE);
+    assert_int_equal(stats.decommitted, 128 * PAGE);
+    assert_int_equal(stats.decommits, 1);
+
+    INFO("Allocating them again, which faults them back in as they are written\n");
+    mem0 = mem_new_alloc_addr(pool, 128 * PAGE);
+    assert_int_equal(mem0[0], 0);
+    memset(mem0, 0xcd, 8 * PAGE);
+    assert_int_equal(mem_rss_stats(pool, &stats), ALLOC_OK);
+    assert_true(stats.resident >= 9 * PAGE && stats.resident < 129 * PAGE);
+
+    INFO("Deallocating the page after them, which merges with the gap after it\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    assert_int_equal(mem_rss_stats(pool, &stats), ALLOC_OK);
+    assert_int_equal(stats.decommits, 2);
+    assert_int_equal(stats.decommitted, 129 * PAGE);
+
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_OK);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void test_pool_growable(void **state) {
+    (void) state; /* unused */
+
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .max_size = 4000 };
+    pool_opts_t bad_opts = { .policy = BUDDY, .kind = POOL_NODE_HEAP, .max_size = 4096 };
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Opening growable pools with a cap below the size, or buddy allocation, fails\n");
+    assert_null(mem_pool_open_opts(5000, &opts));
+    assert_null(mem_pool_open_opts(1024, &bad_opts));
+
+    INFO("Opening pool of 1000 bytes, which may grow to 4000\n");
+    pool = mem_pool_open_opts(1000, &opts);
+    assert_non_null(pool);
+
+    INFO("Allocating 800, then 500, which adds an extent as large as the pool\n");
+    char *mem0 = mem_new_alloc_addr(pool, 800);
+    char *mem1 = mem_new_alloc_addr(pool, 500);
+    assert_non_null(mem0);
+    assert_non_null(mem1);
+    assert_int_equal(pool->total_size, 2000);
+    pool_segment_t exp0[4] = { {800, 1}, {200, 0}, {500, 1}, {500, 0} };
+    check_pool(pool, exp0);
+
+    INFO("Allocating 1500, which adds an extent up to the cap, and then 600, which fails\n");
+    char *mem2 = mem_new_alloc_addr(pool, 1500);
+    assert_non_null(mem2);
+    assert_int_equal(pool->total_size, 4000);
+    assert_null(mem_new_alloc_addr(pool, 600));
+    pool_segment_t exp1[6] = { {800, 1}, {200, 0}, {500, 1}, {500, 0}, {1500, 1}, {500, 0} };
+    check_pool(pool, exp1);
+
+    INFO("Deallocating the 500, whose gap does not merge across the start of its extent\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    assert_int_equal(pool->total_size, 4000);
+    pool_segment_t exp2[5] = { {800, 1}, {200, 0}, {1000, 0}, {1500, 1}, {500, 0} };
+    check_pool(pool, exp2);
+
+    INFO("Deallocating the 1500, whose empty extent goes back\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem2), ALLOC_OK);
+    assert_int_equal(pool->total_size, 2000);
+    pool_segment_t exp3[3] = { {800, 1}, {200, 0}, {1000, 0} };
+    check_pool(pool, exp3);
+
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_OK);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+static void test_pool_file(void **state) {
+    (void) state; /* unused */
+
+    const char *PATH = "test_pool_file.pool";
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG, .path = PATH };
+    pool_opts_t bad_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .path = PATH };
+    pool_segment_pt segs = NULL;
+    unsigned num_segs = 0;
+    size_t offset;
+
+    remove(PATH);
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Opening a file-backed node heap pool fails\n");
+    assert_null(mem_pool_open_opts(65536, &bad_opts));
+
+    INFO("Creating file-backed pool of 64 KiB, which cannot be opened twice\n");
+    pool = mem_pool_open_opts(65536, &opts);
+    assert_non_null(pool);
+    assert_null(mem_pool_open_opts(65536, &opts));
+    assert_null(mem_pool_get_root(pool));
+
+    INFO("Allocating 100, 200 and 300, deallocating the 200, and making the 100 the root\n");
+    char *mem0 = mem_new_alloc_addr(pool, 100);
+    char *mem1 = mem_new_alloc_addr(pool, 200);
+    char *mem2 = mem_new_alloc_addr(pool, 300);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    offset = (size_t) (mem2 - pool->mem);
+    memcpy(mem0, &offset, sizeof(offset));
+    strcpy(mem2, "still here");
+    assert_int_equal(mem_pool_set_root(pool, mem1), ALLOC_FAIL);
+    assert_int_equal(mem_pool_set_root(pool, mem0), ALLOC_OK);
+    mem_inspect_pool(pool, &segs, &num_segs);
+
+    INFO("Closing the pool with its allocations\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Reopening it, whatever the size, with the allocations in place\n");
+    pool = mem_pool_open_opts(0, &opts);
+    assert_non_null(pool);
+    assert_int_equal(pool->total_size, 65536);
+    assert_int_equal(pool->num_allocs, 2);
+    assert_int_equal(pool->alloc_size, 400);
+    check_pool(pool, segs);
+    free(segs);
+    mem0 = mem_pool_get_root(pool);
+    assert_non_null(mem0);
+    memcpy(&offset, mem0, sizeof(offset));
+    mem2 = pool->mem + offset;
+    assert_memory_equal(mem2, "still here", sizeof("still here"));
+
+    INFO("Deallocating both, and reopening an empty pool\n");
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem2), ALLOC_OK);
+    assert_int_equal(mem_pool_set_root(pool, NULL), ALLOC_OK);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+    pool = mem_pool_open_opts(0, &opts);
+    assert_non_null(pool);
+    assert_int_equal(pool->num_allocs, 0);
+    assert_int_equal(pool->num_gaps, 1);
+    assert_null(mem_pool_get_root(pool));
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+    remove(PATH);
+}
+
+static void test_pool_shared(void **state) {
+    (void) state; /* unused */
+
+    const char *PATH = "test_pool_shared.pool";
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG, .path = PATH, .shared = 1 };
+    pool_opts_t private_opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG, .path = PATH };
+    int ready[2];
+    int child_status;
+    pid_t child;
+    char go = 1;
+
+    remove(PATH);
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+    assert_int_equal(pipe(ready), 0);
+
+    INFO("Starting a second process, which opens the pool once this one has\n");
+    child = fork();
+    assert_true(child >= 0);
+    if (child == 0){
+        // the child reports failure through its exit status
+        if (read(ready[0], &go, 1) != 1)
+            _exit(1);
+        pool = mem_pool_open_opts(0, &opts);
+        if (pool == NULL)
+            _exit(2);
+        char *mem = mem_new_alloc_addr(pool, 100);
+        if (mem == NULL || mem_pool_set_root(pool, mem) != ALLOC_OK)
+            _exit(3);
+        memcpy(mem, "from the child", sizeof("from the child"));
+        if (mem_pool_close(pool) != ALLOC_OK)
+            _exit(4);
+        _exit(0);
+    }
+
+    INFO("Creating shared pool of 64 KiB, which a private open does not attach to\n");
+    pool = mem_pool_open_opts(65536, &opts);
+    assert_non_null(pool);
+    assert_null(mem_pool_open_opts(65536, &private_opts));
+    char *mem0 = mem_new_alloc_addr(pool, 200);
+    assert_non_null(mem0);
+
+    INFO("Letting the other process allocate a block and make it the root\n");
+    assert_int_equal(write(ready[1], &go, 1), 1);
+    assert_int_equal(waitpid(child, &child_status, 0), child);
+    assert_true(WIFEXITED(child_status));
+    assert_int_equal(WEXITSTATUS(child_status), 0);
+
+    INFO("Finding the block, and the counters of both processes\n");
+    char *mem1 = mem_pool_get_root(pool);
+    assert_non_null(mem1);
+    assert_memory_equal(mem1, "from the child", sizeof("from the child"));
+    assert_int_equal(pool->num_allocs, 2);
+    assert_int_equal(pool->alloc_size, 300);
+
+    assert_int_equal(mem_del_alloc_addr(pool, mem0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_OK);
+    assert_int_equal(pool->num_gaps, 1);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    close(ready[0]);
+    close(ready[1]);
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+    remove(PATH);
+}
+
+static void test_pool_numa(void **state) {
+    (void) state; /* unused */
+
+    const size_t NUMA_SIZE = 8192;
+    pool_pt pool = NULL;
+    pool_opts_t bound_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .prefault = 1,
+                               .numa_bind = 1, .numa_node = 0 };
+    pool_opts_t local_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .numa_local = 1 };
+    pool_opts_t bad_opts = { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .numa_bind = 1, .numa_node = 64 };
+    pool_segment_pt segs = NULL;
+    unsigned num_segs = 0;
+    size_t total = 0;
+    char *mems[100];
+
+    alloc_status status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Binding to a node that does not exist, or arena and sharded NUMA-local pools, fails\n");
+    assert_null(mem_pool_open_opts(NUMA_SIZE, &bad_opts));
+    bad_opts = (pool_opts_t) { .kind = POOL_ARENA, .numa_local = 1 };
+    assert_null(mem_pool_open_opts(NUMA_SIZE, &bad_opts));
+    bad_opts = (pool_opts_t) { .policy = FIRST_FIT, .kind = POOL_NODE_HEAP, .shards = 2, .numa_local = 1 };
+    assert_null(mem_pool_open_opts(NUMA_SIZE, &bad_opts));
+
+    INFO("Opening pool of %lu bytes bound to node 0, which every machine has\n", (long) NUMA_SIZE);
+    pool = mem_pool_open_opts(NUMA_SIZE, &bound_opts);
+    assert_non_null(pool);
+    char *mem = mem_new_alloc_addr(pool, 1000);
+    assert_ptr_equal(mem, pool->mem);
+    memset(mem, 1, 1000);
+    pool_segment_t exp0[2] = { {1000, 1}, {NUMA_SIZE - 1000, 0} };
+    check_pool(pool, exp0);
+    assert_int_equal(mem_del_alloc_addr(pool, mem), ALLOC_OK);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Opening NUMA-local pool of %lu bytes, with a pool per online node\n", (long) NUMA_SIZE);
+    pool = mem_pool_open_opts(NUMA_SIZE, &local_opts);
+    assert_non_null(pool);
+    assert_int_equal(pool->total_size, NUMA_SIZE);
+
+    INFO("Allocating 100 blocks of 10 bytes, and growing one to 20\n");
+    for (unsigned i = 0; i < 100; i++){
+        mems[i] = mem_new_alloc_addr(pool, 10);
+        assert_non_null(mems[i]);
+        memset(mems[i], (int) i, 10);
+    }
+    mems[0] = mem_realloc(pool, mems[0], 20);
+    assert_non_null(mems[0]);
+    assert_int_equal(pool->num_allocs, 100);
+    assert_int_equal(pool->alloc_size, 1010);
+    assert_int_equal(mem_pool_close(pool), ALLOC_NOT_FREED);
+
+    INFO("The segments of the nodes add up to the pool\n");
+    mem_inspect_pool(pool, &segs, &num_segs);
+    assert_non_null(segs);
+    for (unsigned i = 0; i < num_segs; i++)
+        total += segs[i].size;
+    free(segs);
+    assert_int_equal(total, NUMA_SIZE);
+
+    for (unsigned i = 0; i < 100; i++)
+        assert_int_equal(mem_del_alloc_addr(pool, mems[i]), ALLOC_OK);
+    assert_int_equal(pool->num_allocs, 0);
+    assert_int_equal(pool->alloc_size, 0);
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+}
+
+
+/*******************************************/
+/***       2. USER-FACING METADATA       ***/
+/*******************************************/
+
+static void test_pool_ff_metadata(void **state) {
+    alloc_status status;
+    pool_pt pool = *state;
+
+    /*
+     * Uses scenario 07 w/o pool checking:
+     *
+     * 1. Pool is a gap.
+     * 2. Allocate 100.
+     * 3. Allocate 1000.
+     * 4. Allocate 10000.
+     * 5. Deallocate the 1000.
+     * 6. Deallocate the 100.
+     * 7. Allocate 1100.
+     * 8. Deallocate the 10000.
+     * 9. Deallocate 1100.
+     */
+
+    pool_segment_t exp0[1] =
+            {
+                    {pool->total_size, 0}
+            };  // empty pool
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 0, 0, 1);
+
+
+    // 2. allocate 100
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
+
+    pool_segment_t exp1[2] =
+            {
+                    {100, 1},
+                    {pool->total_size-100, 0}
+            }; // one allocation of 100
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 100, 1, 1);
+
+
+    // 3. allocate 1000
+    alloc_pt alloc1 = mem_new_alloc(pool, 1000);
+    assert_non_null(alloc1);
+
+    pool_segment_t exp2[3] =
+            {
+                    {100, 1},
+                    {1000, 1},
+                    {pool->total_size-100-1000, 0}
+            }; // two allocations: 100, 1000
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 1100, 2, 1);
+
+
+    // 4. allocate 10000
+    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
+    assert_non_null(alloc2);
+
+    pool_segment_t exp3[4] =
+            {
+                    {100, 1},
+                    {1000, 1},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // three allocations: 100, 1000, 10000
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 11100, 3, 1);
+
+
+    // 5. deallocate 1000
+    status = mem_del_alloc(pool, alloc1);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp4[4] =
+            {
+                    {100, 1},
+                    {1000, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // two allocations 100, 10000 w/ two gaps
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 10100, 2, 2);
+
+
+    // 6. deallocate 100
+    status = mem_del_alloc(pool, alloc0);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp5[3] =
+            {
+                    {1100, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // one allocations 10000 w/ two gaps
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 10000, 1, 2);
+
+
+    // 7. allocate 1100
+    alloc_pt alloc3 = mem_new_alloc(pool, 1100);
+    assert_non_null(alloc3);
+
+    pool_segment_t exp6[3] =
+            {
+                    {1100, 1},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            };
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 11100, 2, 1);
+
+
+    // 8. deallocate 10000
+    status = mem_del_alloc(pool, alloc2);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp7[2] =
+            {
+                    {1100, 1},
+                    {pool->total_size-1100, 0}
+            };
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 1100, 1, 1);
+
+
+    // 9. deallocate 1100
+    status = mem_del_alloc(pool, alloc3);
+    assert_int_equal(status, ALLOC_OK);
+
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 0, 0, 1);
+}
+
+static void test_pool_bf_metadata(void **state) {
+    alloc_status status;
+    pool_pt pool = *state;
+
+    /*
+     * Uses scenario 17 w/o pool checking:
+     *
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 10 x 100.
+     * 3. Deallocate (2, 1, 3), (6, 5), 8
+     * 4. Allocate 50.
+     * 5. Allocate another 50.
+     * 6. Clean up.
+     */
+
+    pool_segment_t exp0[1] =
+            {
+                    {pool->total_size, 0},
+            };
+    check_metadata(pool, BEST_FIT, POOL_SIZE, 0, 0, 1);
+
+
+    const unsigned NUM_ALLOCS = 10;
+
+    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
+    assert_non_null(allocs);
+
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        allocs[i] = mem_new_alloc(pool, 100);
+        assert_non_null(allocs[i]);
+    }
+    assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
+
+    pool_segment_t exp1[8] =
+            {
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_metadata(pool, BEST_FIT, POOL_SIZE, 400, 4, 4);
+
+
+    alloc_pt alloc0 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc0);
+    pool_segment_t exp2[9] =
+            {
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {50, 1},
+                    {50, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_metadata(pool, BEST_FIT, POOL_SIZE, 450, 5, 4);
+
+
+    alloc_pt alloc1 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc1);
+    pool_segment_t exp3[9] =
+            {
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {50, 1},
+                    {50, 1},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_metadata(pool, BEST_FIT, POOL_SIZE, 500, 6, 3);
+
+
+    // clean up
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        if (allocs[i])
+            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+    }
+    free(allocs);
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
+
+
+    check_metadata(pool, BEST_FIT, POOL_SIZE, 0, 0, 1);
+}
+
+
 /*******************************************/
-/***       2. USER-FACING METADATA       ***/
+/***       3. FIRST_FIT SCENARIOS        ***/
 /*******************************************/
 
-static void test_pool_ff_metadata(void **state) {
+static int pool_ff_setup(void **state) {
+    alloc_status status;
+    const alloc_policy POOL_POLICY = FIRST_FIT;
+    pool_pt pool = NULL;
+
+    status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating pool of %lu bytes with policy %s\n",
+         (long) POOL_SIZE, (POOL_POLICY == FIRST_FIT) ? "FIRST_FIT" : "BEST_FIT");
+    pool = mem_pool_open(POOL_SIZE, POOL_POLICY);
+    assert_non_null(pool);
+
+    *state = pool;
+
+    return 0;
+}
+
+static int pool_ff_teardown(void **state) {
+    pool_pt pool = *state;
+    alloc_status status;
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+
+    return 0;
+}
+
+static void test_pool_scenario00(void **state) {
+    alloc_status status;
+    pool_pt pool = *state;
+
+    /*
+     * Scenario 00:
+     *
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 100. That will be at the top. The rest is a gap.
+     * 3. Deallocate the 100 allocation. Pool is again one single gap.
+     */
+
+    pool_segment_t exp0[1] =
+            {
+                    {pool->total_size, 0}
+            };
+    check_pool(pool, exp0);
+
+
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
+
+    pool_segment_t exp1[2] =
+            {
+                    {100, 1},
+                    {pool->total_size-100, 0}
+            };
+    check_pool(pool, exp1);
+
+
+    status = mem_del_alloc(pool, alloc0);
+    assert_int_equal(status, ALLOC_OK);
+
+    check_pool(pool, exp0);
+}
+
+static void test_pool_scenario01(void **state) {
+    alloc_status status;
+    pool_pt pool = *state;
+
+    /*
+     * Scenario 01:
+     *
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 100. That will be at the top. The rest is a gap.
+     * 3. Deallocate the 100 allocation. Pool is again one single gap.
+     * 4. Allocate 100. That will be at the top. The rest is a gap.
+     * 5. Deallocate the 100 allocation. Pool is again one single gap.
+     */
+
+    pool_segment_t exp0[1] =
+            {
+                    {pool->total_size, 0}
+            };
+    check_pool(pool, exp0);
+
+
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
+
+    pool_segment_t exp1[2] =
+            {
+                    {100, 1},
+                    {pool->total_size-100, 0}
+            };
+    check_pool(pool, exp1);
+
+
+    status = mem_del_alloc(pool, alloc0);
+    assert_int_equal(status, ALLOC_OK);
+
+    check_pool(pool, exp0);
+
+
+    alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
+
+    check_pool(pool, exp1);
+
+
+    status = mem_del_alloc(pool, alloc0);
+    assert_int_equal(status, ALLOC_OK);
+
+    check_pool(pool, exp0);
+}
+
+
+static void test_pool_scenario02(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Uses scenario 07 w/o pool checking:
+     * Scenario 02:
      *
-     * 1. Pool is a gap.
-     * 2. Allocate 100.
-     * 3. Allocate 1000.
-     * 4. Allocate 10000.
-     * 5. Deallocate the 1000.
-     * 6. Deallocate the 100.
-     * 7. Allocate 1100.
-     * 8. Deallocate the 10000.
-     * 9. Deallocate 1100.
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 100. That will be at the top. The rest is a gap.
+     * 3. Allocate 1000. That will be right underneath the 100. Rest is gap.
+     * 4. Deallocate the 1000. The 100 remains. Rest is gap.
+     * 5. Deallocate the 100 allocation. Pool is again one single gap.
      */
 
     pool_segment_t exp0[1] =
             {
                     {pool->total_size, 0}
             };  // empty pool
-    check_metadata(pool, FIRST_FIT, POOL_SIZE, 0, 0, 1);
+    check_pool(pool, exp0);
 
 
-    // 2. allocate 100
+    // allocate 100
     alloc_pt alloc0 = mem_new_alloc(pool, 100);
     assert_non_null(alloc0);
 
@@ -273,10 +1834,10 @@ static void test_pool_ff_metadata(void **state) {
                     {100, 1},
                     {pool->total_size-100, 0}
             }; // one allocation of 100
-    check_metadata(pool, FIRST_FIT, POOL_SIZE, 100, 1, 1);
+    check_pool(pool, exp1);
 
 
-    // 3. allocate 1000
+    // allocate 1000
     alloc_pt alloc1 = mem_new_alloc(pool, 1000);
     assert_non_null(alloc1);
 
@@ -286,237 +1847,211 @@ static void test_pool_ff_metadata(void **state) {
                     {1000, 1},
                     {pool->total_size-100-1000, 0}
             }; // two allocations: 100, 1000
-    check_metadata(pool, FIRST_FIT, POOL_SIZE, 1100, 2, 1);
+    check_pool(pool, exp2);
 
 
-    // 4. allocate 10000
-    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
-    assert_non_null(alloc2);
+    // deallocate 1000
+    status = mem_del_alloc(pool, alloc1);
+    assert_int_equal(status, ALLOC_OK);
 
-    pool_segment_t exp3[4] =
-            {
-                    {100, 1},
-                    {1000, 1},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // three allocations: 100, 1000, 10000
-    check_metadata(pool, FIRST_FIT, POOL_SIZE, 11100, 3, 1);
+    check_pool(pool, exp1);
 
 
-    // 5. deallocate 1000
-    status = mem_del_alloc(pool, alloc1);
+    // deallocate 100
+    status = mem_del_alloc(pool, alloc0);
     assert_int_equal(status, ALLOC_OK);
 
-    pool_segment_t exp4[4] =
+    check_pool(pool, exp0);
+}
+
+static void test_pool_scenario03(void **state) {
+    alloc_status status;
+    pool_pt pool = *state;
+
+    /*
+     * Scenario 03:
+     *
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 100. That will be at the top. The rest is a gap.
+     * 3. Allocate 1000. That will be right underneath the 100. Rest is gap.
+     * 4. Deallocate the 100 allocation. Two gaps around the 1000.
+     * 4. Deallocate the 1000. The pool is again a single gap.
+     */
+
+    pool_segment_t exp0[1] =
             {
-                    {100, 1},
-                    {1000, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // two allocations 100, 10000 w/ two gaps
-    check_metadata(pool, FIRST_FIT, POOL_SIZE, 10100, 2, 2);
+                    {pool->total_size, 0}
+            };  // empty pool
+    check_pool(pool, exp0);
 
 
-    // 6. deallocate 100
-    status = mem_del_alloc(pool, alloc0);
-    assert_int_equal(status, ALLOC_OK);
+    // allocate 100
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
 
-    pool_segment_t exp5[3] =
+    pool_segment_t exp1[2] =
             {
-                    {1100, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // one allocations 10000 w/ two gaps
-    check_metadata(pool, FIRST_FIT, POOL_SIZE, 10000, 1, 2);
+                    {100, 1},
+                    {pool->total_size-100, 0}
+            }; // one allocation of 100
+    check_pool(pool, exp1);
 
 
-    // 7. allocate 1100
-    alloc_pt alloc3 = mem_new_alloc(pool, 1100);
-    assert_non_null(alloc3);
+    // allocate 1000
+    alloc_pt alloc1 = mem_new_alloc(pool, 1000);
+    assert_non_null(alloc1);
 
-    pool_segment_t exp6[3] =
+    pool_segment_t exp2[3] =
             {
-                    {1100, 1},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            };
-    check_metadata(pool, FIRST_FIT, POOL_SIZE, 11100, 2, 1);
+                    {100, 1},
+                    {1000, 1},
+                    {pool->total_size-100-1000, 0}
+            }; // two allocations: 100, 1000
+    check_pool(pool, exp2);
 
 
-    // 8. deallocate 10000
-    status = mem_del_alloc(pool, alloc2);
+    // deallocate 100
+    status = mem_del_alloc(pool, alloc0);
     assert_int_equal(status, ALLOC_OK);
 
-    pool_segment_t exp7[2] =
+    pool_segment_t exp3[3] =
             {
-                    {1100, 1},
-                    {pool->total_size-1100, 0}
-            };
-    check_metadata(pool, FIRST_FIT, POOL_SIZE, 1100, 1, 1);
+                    {100, 0},
+                    {1000, 1},
+                    {pool->total_size-100-1000, 0}
+            }; // one allocation of 100 w/ two gaps
+    check_pool(pool, exp3);
 
 
-    // 9. deallocate 1100
-    status = mem_del_alloc(pool, alloc3);
+    // deallocate 1000
+    status = mem_del_alloc(pool, alloc1);
     assert_int_equal(status, ALLOC_OK);
 
-    check_metadata(pool, FIRST_FIT, POOL_SIZE, 0, 0, 1);
+    check_pool(pool, exp0);
 }
 
-static void test_pool_bf_metadata(void **state) {
+static void test_pool_scenario04(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Uses scenario 17 w/o pool checking:
+     * Scenario 04:
      *
-     * 1. Pool starts out as a single gap.
-     * 2. Allocate 10 x 100.
-     * 3. Deallocate (2, 1, 3), (6, 5), 8
-     * 4. Allocate 50.
-     * 5. Allocate another 50.
-     * 6. Clean up.
+     * 1. Pool is a gap.
+     * 2. Allocate 100.
+     * 3. Allocate 1000.
+     * 4. Allocate 10000.
+     * 5. Deallocate the 1000.
+     * 6. Deallocate the 100.
+     * 7. Deallocate the 10000.
      */
 
     pool_segment_t exp0[1] =
             {
-                    {pool->total_size, 0},
-            };
-    check_metadata(pool, BEST_FIT, POOL_SIZE, 0, 0, 1);
-
-
-    const unsigned NUM_ALLOCS = 10;
-
-    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
-    assert_non_null(allocs);
-
-    for (int i=0; i<NUM_ALLOCS; ++i) {
-        allocs[i] = mem_new_alloc(pool, 100);
-        assert_non_null(allocs[i]);
-    }
-    assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
-
-    pool_segment_t exp1[8] =
-            {
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_metadata(pool, BEST_FIT, POOL_SIZE, 400, 4, 4);
+                    {pool->total_size, 0}
+            };  // empty pool
+    check_pool(pool, exp0);
 
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 50);
+    // allocate 100
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
     assert_non_null(alloc0);
-    pool_segment_t exp2[9] =
+
+    pool_segment_t exp1[2] =
             {
                     {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {50, 1},
-                    {50, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_metadata(pool, BEST_FIT, POOL_SIZE, 450, 5, 4);
+                    {pool->total_size-100, 0}
+            }; // one allocation of 100
+    check_pool(pool, exp1);
 
 
-    alloc_pt alloc1 = mem_new_alloc(pool, 50);
+    // allocate 1000
+    alloc_pt alloc1 = mem_new_alloc(pool, 1000);
     assert_non_null(alloc1);
-    pool_segment_t exp3[9] =
+
+    pool_segment_t exp2[3] =
             {
                     {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {50, 1},
-                    {50, 1},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_metadata(pool, BEST_FIT, POOL_SIZE, 500, 6, 3);
-
-
-    // clean up
-    for (int i=0; i<NUM_ALLOCS; ++i) {
-        if (allocs[i])
-            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
-    }
-    free(allocs);
-    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
-    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
-
+                    {1000, 1},
+                    {pool->total_size-100-1000, 0}
+            }; // two allocations: 100, 1000
+    check_pool(pool, exp2);
 
-    check_metadata(pool, BEST_FIT, POOL_SIZE, 0, 0, 1);
-}
 
+    // allocate 10000
+    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
+    assert_non_null(alloc2);
 
-/*******************************************/
-/***       3. FIRST_FIT SCENARIOS        ***/
-/*******************************************/
+    pool_segment_t exp3[4] =
+            {
+                    {100, 1},
+                    {1000, 1},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // three allocations: 100, 1000, 10000
+    check_pool(pool, exp3);
 
-static int pool_ff_setup(void **state) {
-    alloc_status status;
-    const alloc_policy POOL_POLICY = FIRST_FIT;
-    pool_pt pool = NULL;
 
-    status = mem_init();
+    // deallocate 1000
+    status = mem_del_alloc(pool, alloc1);
     assert_int_equal(status, ALLOC_OK);
 
-    INFO("Allocating pool of %lu bytes with policy %s\n",
-         (long) POOL_SIZE, (POOL_POLICY == FIRST_FIT) ? "FIRST_FIT" : "BEST_FIT");
-    pool = mem_pool_open(POOL_SIZE, POOL_POLICY);
-    assert_non_null(pool);
+    pool_segment_t exp4[4] =
+            {
+                    {100, 1},
+                    {1000, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // two allocations 100, 10000 w/ two gaps
+    check_pool(pool, exp4);
 
-    *state = pool;
 
-    return 0;
-}
+    // deallocate 100
+    status = mem_del_alloc(pool, alloc0);
+    assert_int_equal(status, ALLOC_OK);
 
-static int pool_ff_teardown(void **state) {
-    pool_pt pool = *state;
-    alloc_status status;
+    pool_segment_t exp5[3] =
+            {
+                    {1100, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // one allocations 10000 w/ two gaps
+    check_pool(pool, exp5);
 
-    INFO("Closing pool\n");
-    status = mem_pool_close(pool);
-    assert_int_equal(status, ALLOC_OK);
 
-    status = mem_free();
+    // deallocate 10000
+    status = mem_del_alloc(pool, alloc2);
     assert_int_equal(status, ALLOC_OK);
 
-    return 0;
+    check_pool(pool, exp0);
 }
 
-static void test_pool_scenario00(void **state) {
+static void test_pool_scenario05(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 00:
+     * Scenario 05:
      *
-     * 1. Pool starts out as a single gap.
-     * 2. Allocate 100. That will be at the top. The rest is a gap.
-     * 3. Deallocate the 100 allocation. Pool is again one single gap.
+     * 1. Pool is a gap.
+     * 2. Allocate 100.
+     * 3. Allocate 1000.
+     * 4. Allocate 10000.
+     * 5. Deallocate the 1000.
+     * 6. Deallocate the 100.
+     * 7. Allocate 2000.
+     * 8. Deallocate the 10000.
+     * 9. Deallocate 2000.
      */
 
     pool_segment_t exp0[1] =
             {
                     {pool->total_size, 0}
-            };
+            };  // empty pool
     check_pool(pool, exp0);
 
 
+    // 2. allocate 100
     alloc_pt alloc0 = mem_new_alloc(pool, 100);
     assert_non_null(alloc0);
 
@@ -524,79 +2059,114 @@ static void test_pool_scenario00(void **state) {
             {
                     {100, 1},
                     {pool->total_size-100, 0}
-            };
+            }; // one allocation of 100
     check_pool(pool, exp1);
 
 
-    status = mem_del_alloc(pool, alloc0);
-    assert_int_equal(status, ALLOC_OK);
+    // 3. allocate 1000
+    alloc_pt alloc1 = mem_new_alloc(pool, 1000);
+    assert_non_null(alloc1);
 
-    check_pool(pool, exp0);
-}
+    pool_segment_t exp2[3] =
+            {
+                    {100, 1},
+                    {1000, 1},
+                    {pool->total_size-100-1000, 0}
+            }; // two allocations: 100, 1000
+    check_pool(pool, exp2);
 
-static void test_pool_scenario01(void **state) {
-    alloc_status status;
-    pool_pt pool = *state;
 
-    /*
-     * Scenario 01:
-     *
-     * 1. Pool starts out as a single gap.
-     * 2. Allocate 100. That will be at the top. The rest is a gap.
-     * 3. Deallocate the 100 allocation. Pool is again one single gap.
-     * 4. Allocate 100. That will be at the top. The rest is a gap.
-     * 5. Deallocate the 100 allocation. Pool is again one single gap.
-     */
+    // 4. allocate 10000
+    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
+    assert_non_null(alloc2);
 
-    pool_segment_t exp0[1] =
+    pool_segment_t exp3[4] =
             {
-                    {pool->total_size, 0}
-            };
-    check_pool(pool, exp0);
+                    {100, 1},
+                    {1000, 1},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // three allocations: 100, 1000, 10000
+    check_pool(pool, exp3);
 
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 100);
-    assert_non_null(alloc0);
+    // 5. deallocate 1000
+    status = mem_del_alloc(pool, alloc1);
+    assert_int_equal(status, ALLOC_OK);
 
-    pool_segment_t exp1[2] =
+    pool_segment_t exp4[4] =
             {
                     {100, 1},
-                    {pool->total_size-100, 0}
-            };
-    check_pool(pool, exp1);
+                    {1000, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // two allocations 100, 10000 w/ two gaps
+    check_pool(pool, exp4);
 
 
+    // 6. deallocate 100
     status = mem_del_alloc(pool, alloc0);
     assert_int_equal(status, ALLOC_OK);
 
-    check_pool(pool, exp0);
+    pool_segment_t exp5[3] =
+            {
+                    {1100, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // one allocations 10000 w/ two gaps
+    check_pool(pool, exp5);
 
 
-    alloc0 = mem_new_alloc(pool, 100);
-    assert_non_null(alloc0);
+    // 7. allocate 2000
+    alloc_pt alloc3 = mem_new_alloc(pool, 2000);
+    assert_non_null(alloc3);
 
-    check_pool(pool, exp1);
+    pool_segment_t exp6[4] =
+            {
+                    {1100, 0},
+                    {10000, 1},
+                    {2000, 1},
+                    {pool->total_size-100-1000-10000-2000, 0}
+            };
+    check_pool(pool, exp6);
 
 
-    status = mem_del_alloc(pool, alloc0);
+    // 8. deallocate 10000
+    status = mem_del_alloc(pool, alloc2);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp7[3] =
+            {
+                    {11100, 0},
+                    {2000, 1},
+                    {pool->total_size-100-1000-10000-2000, 0}
+            };
+    check_pool(pool, exp7);
+
+
+    // 9. deallocate 2000
+    status = mem_del_alloc(pool, alloc3);
     assert_int_equal(status, ALLOC_OK);
 
     check_pool(pool, exp0);
 }
 
-
-static void test_pool_scenario02(void **state) {
+static void test_pool_scenario06(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 02:
+     * Scenario 06:
      *
-     * 1. Pool starts out as a single gap.
-     * 2. Allocate 100. That will be at the top. The rest is a gap.
-     * 3. Allocate 1000. That will be right underneath the 100. Rest is gap.
-     * 4. Deallocate the 1000. The 100 remains. Rest is gap.
-     * 5. Deallocate the 100 allocation. Pool is again one single gap.
+     * 1. Pool is a gap.
+     * 2. Allocate 100.
+     * 3. Allocate 1000.
+     * 4. Allocate 10000.
+     * 5. Deallocate the 1000.
+     * 6. Deallocate the 100.
+     * 7. Allocate 500.
+     * 8. Deallocate the 10000.
+     * 9. Deallocate 500.
      */
 
     pool_segment_t exp0[1] =
@@ -606,7 +2176,7 @@ static void test_pool_scenario02(void **state) {
     check_pool(pool, exp0);
 
 
-    // allocate 100
+    // 2. allocate 100
     alloc_pt alloc0 = mem_new_alloc(pool, 100);
     assert_non_null(alloc0);
 
@@ -618,7 +2188,7 @@ static void test_pool_scenario02(void **state) {
     check_pool(pool, exp1);
 
 
-    // allocate 1000
+    // 3. allocate 1000
     alloc_pt alloc1 = mem_new_alloc(pool, 1000);
     assert_non_null(alloc1);
 
@@ -631,32 +2201,96 @@ static void test_pool_scenario02(void **state) {
     check_pool(pool, exp2);
 
 
-    // deallocate 1000
+    // 4. allocate 10000
+    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
+    assert_non_null(alloc2);
+
+    pool_segment_t exp3[4] =
+            {
+                    {100, 1},
+                    {1000, 1},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // three allocations: 100, 1000, 10000
+    check_pool(pool, exp3);
+
+
+    // 5. deallocate 1000
     status = mem_del_alloc(pool, alloc1);
     assert_int_equal(status, ALLOC_OK);
 
-    check_pool(pool, exp1);
+    pool_segment_t exp4[4] =
+            {
+                    {100, 1},
+                    {1000, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // two allocations 100, 10000 w/ two gaps
+    check_pool(pool, exp4);
+
+
+    // 6. deallocate 100
+    status = mem_del_alloc(pool, alloc0);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp5[3] =
+            {
+                    {1100, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // one allocations 10000 w/ two gaps
+    check_pool(pool, exp5);
+
+
+    // 7. allocate 500
+    alloc_pt alloc3 = mem_new_alloc(pool, 500);
+    assert_non_null(alloc3);
+
+    pool_segment_t exp6[4] =
+            {
+                    {500, 1},
+                    {600, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            };
+    check_pool(pool, exp6);
+
+
+    // 8. deallocate 10000
+    status = mem_del_alloc(pool, alloc2);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp7[2] =
+            {
+                    {500, 1},
+                    {pool->total_size-500, 0}
+            };
+    check_pool(pool, exp7);
 
 
-    // deallocate 100
-    status = mem_del_alloc(pool, alloc0);
+    // 9. deallocate 500
+    status = mem_del_alloc(pool, alloc3);
     assert_int_equal(status, ALLOC_OK);
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario03(void **state) {
+static void test_pool_scenario07(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 03:
+     * Scenario 07:
      *
-     * 1. Pool starts out as a single gap.
-     * 2. Allocate 100. That will be at the top. The rest is a gap.
-     * 3. Allocate 1000. That will be right underneath the 100. Rest is gap.
-     * 4. Deallocate the 100 allocation. Two gaps around the 1000.
-     * 4. Deallocate the 1000. The pool is again a single gap.
+     * 1. Pool is a gap.
+     * 2. Allocate 100.
+     * 3. Allocate 1000.
+     * 4. Allocate 10000.
+     * 5. Deallocate the 1000.
+     * 6. Deallocate the 100.
+     * 7. Allocate 1100.
+     * 8. Deallocate the 10000.
+     * 9. Deallocate 1100.
      */
 
     pool_segment_t exp0[1] =
@@ -666,7 +2300,7 @@ static void test_pool_scenario03(void **state) {
     check_pool(pool, exp0);
 
 
-    // allocate 100
+    // 2. allocate 100
     alloc_pt alloc0 = mem_new_alloc(pool, 100);
     assert_non_null(alloc0);
 
@@ -678,7 +2312,7 @@ static void test_pool_scenario03(void **state) {
     check_pool(pool, exp1);
 
 
-    // allocate 1000
+    // 3. allocate 1000
     alloc_pt alloc1 = mem_new_alloc(pool, 1000);
     assert_non_null(alloc1);
 
@@ -691,32 +2325,86 @@ static void test_pool_scenario03(void **state) {
     check_pool(pool, exp2);
 
 
-    // deallocate 100
-    status = mem_del_alloc(pool, alloc0);
-    assert_int_equal(status, ALLOC_OK);
+    // 4. allocate 10000
+    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
+    assert_non_null(alloc2);
 
-    pool_segment_t exp3[3] =
+    pool_segment_t exp3[4] =
             {
-                    {100, 0},
+                    {100, 1},
                     {1000, 1},
-                    {pool->total_size-100-1000, 0}
-            }; // one allocation of 100 w/ two gaps
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // three allocations: 100, 1000, 10000
     check_pool(pool, exp3);
 
 
-    // deallocate 1000
+    // 5. deallocate 1000
     status = mem_del_alloc(pool, alloc1);
     assert_int_equal(status, ALLOC_OK);
 
+    pool_segment_t exp4[4] =
+            {
+                    {100, 1},
+                    {1000, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // two allocations 100, 10000 w/ two gaps
+    check_pool(pool, exp4);
+
+
+    // 6. deallocate 100
+    status = mem_del_alloc(pool, alloc0);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp5[3] =
+            {
+                    {1100, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // one allocations 10000 w/ two gaps
+    check_pool(pool, exp5);
+
+
+    // 7. allocate 1100
+
+    alloc_pt alloc3 = mem_new_alloc(pool, 1100);
+    assert_non_null(alloc3);
+
+    pool_segment_t exp6[3] =
+            {
+                    {1100, 1},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            };
+    check_pool(pool, exp6);
+
+
+    // 8. deallocate 10000
+    status = mem_del_alloc(pool, alloc2);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp7[2] =
+            {
+                    {1100, 1},
+                    {pool->total_size-1100, 0}
+            };
+    check_pool(pool, exp7);
+
+
+    // 9. deallocate 1100
+    status = mem_del_alloc(pool, alloc3);
+    assert_int_equal(status, ALLOC_OK);
+
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario04(void **state) {
+static void test_pool_scenario08(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 04:
+     * Scenario 08:
      *
      * 1. Pool is a gap.
      * 2. Allocate 100.
@@ -724,7 +2412,8 @@ static void test_pool_scenario04(void **state) {
      * 4. Allocate 10000.
      * 5. Deallocate the 1000.
      * 6. Deallocate the 100.
-     * 7. Deallocate the 10000.
+     * 7. Try to allocate 989000. No room.
+     * 8. Deallocate the 10000.
      */
 
     pool_segment_t exp0[1] =
@@ -734,7 +2423,7 @@ static void test_pool_scenario04(void **state) {
     check_pool(pool, exp0);
 
 
-    // allocate 100
+    // 2. allocate 100
     alloc_pt alloc0 = mem_new_alloc(pool, 100);
     assert_non_null(alloc0);
 
@@ -746,7 +2435,7 @@ static void test_pool_scenario04(void **state) {
     check_pool(pool, exp1);
 
 
-    // allocate 1000
+    // 3. allocate 1000
     alloc_pt alloc1 = mem_new_alloc(pool, 1000);
     assert_non_null(alloc1);
 
@@ -759,7 +2448,7 @@ static void test_pool_scenario04(void **state) {
     check_pool(pool, exp2);
 
 
-    // allocate 10000
+    // 4. allocate 10000
     alloc_pt alloc2 = mem_new_alloc(pool, 10000);
     assert_non_null(alloc2);
 
@@ -773,7 +2462,7 @@ static void test_pool_scenario04(void **state) {
     check_pool(pool, exp3);
 
 
-    // deallocate 1000
+    // 5. deallocate 1000
     status = mem_del_alloc(pool, alloc1);
     assert_int_equal(status, ALLOC_OK);
 
@@ -787,7 +2476,7 @@ static void test_pool_scenario04(void **state) {
     check_pool(pool, exp4);
 
 
-    // deallocate 100
+    // 6. deallocate 100
     status = mem_del_alloc(pool, alloc0);
     assert_int_equal(status, ALLOC_OK);
 
@@ -800,19 +2489,26 @@ static void test_pool_scenario04(void **state) {
     check_pool(pool, exp5);
 
 
-    // deallocate 10000
+    // 7. try 989000 (should not succeed)
+    alloc_pt alloc3 = mem_new_alloc(pool, 989000);
+    assert_null(alloc3);
+
+    check_pool(pool, exp5);
+
+
+    // 8. deallocate 10000
     status = mem_del_alloc(pool, alloc2);
     assert_int_equal(status, ALLOC_OK);
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario05(void **state) {
+static void test_pool_scenario09(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 05:
+     * Scenario 09:
      *
      * 1. Pool is a gap.
      * 2. Allocate 100.
@@ -820,9 +2516,9 @@ static void test_pool_scenario05(void **state) {
      * 4. Allocate 10000.
      * 5. Deallocate the 1000.
      * 6. Deallocate the 100.
-     * 7. Allocate 2000.
+     * 7. Allocate 988000.
      * 8. Deallocate the 10000.
-     * 9. Deallocate 2000.
+     * 9. Deallocate the 988000.
      */
 
     pool_segment_t exp0[1] =
@@ -898,16 +2594,16 @@ static void test_pool_scenario05(void **state) {
     check_pool(pool, exp5);
 
 
-    // 7. allocate 2000
-    alloc_pt alloc3 = mem_new_alloc(pool, 2000);
+    // 7. allocate 988000
+    alloc_pt alloc3 = mem_new_alloc(pool, 988000);
     assert_non_null(alloc3);
 
     pool_segment_t exp6[4] =
             {
                     {1100, 0},
                     {10000, 1},
-                    {2000, 1},
-                    {pool->total_size-100-1000-10000-2000, 0}
+                    {988000, 1},
+                    {pool->total_size-100-1000-10000-988000, 0}
             };
     check_pool(pool, exp6);
 
@@ -919,25 +2615,25 @@ static void test_pool_scenario05(void **state) {
     pool_segment_t exp7[3] =
             {
                     {11100, 0},
-                    {2000, 1},
-                    {pool->total_size-100-1000-10000-2000, 0}
+                    {988000, 1},
+                    {pool->total_size-100-1000-10000-988000, 0}
             };
     check_pool(pool, exp7);
 
 
-    // 9. deallocate 2000
+    // 9. deallocate 988000
     status = mem_del_alloc(pool, alloc3);
     assert_int_equal(status, ALLOC_OK);
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario06(void **state) {
+static void test_pool_scenario10(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 06:
+     * Scenario 09:
      *
      * 1. Pool is a gap.
      * 2. Allocate 100.
@@ -945,9 +2641,9 @@ static void test_pool_scenario06(void **state) {
      * 4. Allocate 10000.
      * 5. Deallocate the 1000.
      * 6. Deallocate the 100.
-     * 7. Allocate 500.
+     * 7. Allocate 988900.
      * 8. Deallocate the 10000.
-     * 9. Deallocate 500.
+     * 9. Deallocate the 988900.
      */
 
     pool_segment_t exp0[1] =
@@ -1010,616 +2706,845 @@ static void test_pool_scenario06(void **state) {
     check_pool(pool, exp4);
 
 
-    // 6. deallocate 100
-    status = mem_del_alloc(pool, alloc0);
+    // 6. deallocate 100
+    status = mem_del_alloc(pool, alloc0);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp5[3] =
+            {
+                    {1100, 0},
+                    {10000, 1},
+                    {pool->total_size-100-1000-10000, 0}
+            }; // one allocations 10000 w/ two gaps
+    check_pool(pool, exp5);
+
+
+    // 7. allocate 988900
+    alloc_pt alloc3 = mem_new_alloc(pool, 988900);
+    assert_non_null(alloc3);
+
+    pool_segment_t exp6[3] =
+            {
+                    {1100, 0},
+                    {10000, 1},
+                    {988900, 1},
+            };
+    check_pool(pool, exp6);
+
+
+    // 8. deallocate 10000
+    status = mem_del_alloc(pool, alloc2);
+    assert_int_equal(status, ALLOC_OK);
+
+    pool_segment_t exp7[2] =
+            {
+                    {11100, 0},
+                    {988900, 1},
+            };
+    check_pool(pool, exp7);
+
+
+    // 9. deallocate 988900
+    status = mem_del_alloc(pool, alloc3);
+    assert_int_equal(status, ALLOC_OK);
+
+    check_pool(pool, exp0);
+}
+
+static void test_pool_scenario23(void **state) {
+    pool_pt pool = *state;
+
+    /*
+     * Scenario 23:
+     *
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 10 blocks of assorted sizes, each followed by a 10 spacer.
+     * 3. Deallocate the 10 blocks, leaving 11 gaps.
+     * 4. Allocate 600. Topmost sufficient gap is the 700.
+     * 5. Allocate 250. Topmost sufficient gap is the 500.
+     * 6. Allocate 750. The 700 and 500 are used up, so it is the 900.
+     * 7. Allocate 850. Only the trailing gap fits.
+     * 8. Clean up.
+     */
+
+    const unsigned NUM_BLOCKS = 10;
+    const size_t sizes[] = {500, 300, 700, 300, 900, 100, 300, 800, 600, 200};
+    const size_t blocks_size = 4700 + 10 * NUM_BLOCKS;
+
+    alloc_pt blocks[NUM_BLOCKS], spacers[NUM_BLOCKS];
+    char *block_mem[NUM_BLOCKS];
+
+    for (int i=0; i<NUM_BLOCKS; ++i) {
+        blocks[i] = mem_new_alloc(pool, sizes[i]);
+        assert_non_null(blocks[i]);
+        block_mem[i] = blocks[i]->mem;
+        spacers[i] = mem_new_alloc(pool, 10);
+        assert_non_null(spacers[i]);
+    }
+    for (int i=0; i<NUM_BLOCKS; ++i) {
+        assert_int_equal(mem_del_alloc(pool, blocks[i]), ALLOC_OK);
+    }
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 10 * NUM_BLOCKS, NUM_BLOCKS, NUM_BLOCKS + 1);
+
+
+    alloc_pt alloc0 = mem_new_alloc(pool, 600);
+    assert_non_null(alloc0);
+    assert_true(alloc0->mem == block_mem[2]);
+
+    alloc_pt alloc1 = mem_new_alloc(pool, 250);
+    assert_non_null(alloc1);
+    assert_true(alloc1->mem == block_mem[0]);
+
+    alloc_pt alloc2 = mem_new_alloc(pool, 750);
+    assert_non_null(alloc2);
+    assert_true(alloc2->mem == block_mem[4]);
+
+    alloc_pt alloc3 = mem_new_alloc(pool, 850);
+    assert_non_null(alloc3);
+    assert_true(alloc3->mem == pool->mem + blocks_size);
+
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 10 * NUM_BLOCKS + 2450, NUM_BLOCKS + 4, NUM_BLOCKS + 1);
+
+
+    // clean up
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc2), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc3), ALLOC_OK);
+    for (int i=0; i<NUM_BLOCKS; ++i) {
+        assert_int_equal(mem_del_alloc(pool, spacers[i]), ALLOC_OK);
+    }
+
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 0, 0, 1);
+}
+
+/*******************************************/
+/***        4. BEST_FIT SCENARIOS        ***/
+/*******************************************/
+
+static int pool_bf_setup(void **state) {
+    alloc_status status;
+    const alloc_policy POOL_POLICY = BEST_FIT;
+    pool_pt pool = NULL;
+
+    status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating pool of %lu bytes with policy %s\n",
+         (long) POOL_SIZE, (POOL_POLICY == FIRST_FIT) ? "FIRST_FIT" : "BEST_FIT");
+    pool = mem_pool_open(POOL_SIZE, POOL_POLICY);
+    assert_non_null(pool);
+
+    *state = pool;
+
+    return 0;
+}
+
+static int pool_bf_teardown(void **state) {
+    pool_pt pool = *state;
+    alloc_status status;
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
     assert_int_equal(status, ALLOC_OK);
 
-    pool_segment_t exp5[3] =
-            {
-                    {1100, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // one allocations 10000 w/ two gaps
-    check_pool(pool, exp5);
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
 
+    return 0;
+}
 
-    // 7. allocate 500
-    alloc_pt alloc3 = mem_new_alloc(pool, 500);
-    assert_non_null(alloc3);
+static void dummy_test(void **state) {
+    (void) state;
+}
 
-    pool_segment_t exp6[4] =
+static void test_pool_scenario11(void **state) {
+    alloc_status status;
+    pool_pt pool = *state;
+
+    /*
+     * Scenario 11:
+     *
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 100. That will be at the top. The rest is a gap.
+     * 3. Deallocate the 100 allocation. Pool is again one single gap.
+     */
+
+    pool_segment_t exp0[1] =
             {
-                    {500, 1},
-                    {600, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
+                    {pool->total_size, 0}
             };
-    check_pool(pool, exp6);
+    check_pool(pool, exp0);
 
 
-    // 8. deallocate 10000
-    status = mem_del_alloc(pool, alloc2);
-    assert_int_equal(status, ALLOC_OK);
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
 
-    pool_segment_t exp7[2] =
+    pool_segment_t exp1[2] =
             {
-                    {500, 1},
-                    {pool->total_size-500, 0}
+                    {100, 1},
+                    {pool->total_size-100, 0}
             };
-    check_pool(pool, exp7);
+    check_pool(pool, exp1);
 
 
-    // 9. deallocate 500
-    status = mem_del_alloc(pool, alloc3);
+    status = mem_del_alloc(pool, alloc0);
     assert_int_equal(status, ALLOC_OK);
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario07(void **state) {
+static void test_pool_scenario12(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 07:
+     * Scenario 12:
      *
-     * 1. Pool is a gap.
-     * 2. Allocate 100.
-     * 3. Allocate 1000.
-     * 4. Allocate 10000.
-     * 5. Deallocate the 1000.
-     * 6. Deallocate the 100.
-     * 7. Allocate 1100.
-     * 8. Deallocate the 10000.
-     * 9. Deallocate 1100.
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 10 x 100.
+     * 3. Deallocate (1, 2), 4, (6, 7, 8)
+     * 4. Allocate 100.
+     * 5. Clean up.
      */
 
     pool_segment_t exp0[1] =
             {
-                    {pool->total_size, 0}
-            };  // empty pool
+                    {pool->total_size, 0},
+            };
     check_pool(pool, exp0);
 
 
-    // 2. allocate 100
-    alloc_pt alloc0 = mem_new_alloc(pool, 100);
-    assert_non_null(alloc0);
+    const unsigned NUM_ALLOCS = 10;
 
-    pool_segment_t exp1[2] =
+    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
+    assert_non_null(allocs);
+
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        allocs[i] = mem_new_alloc(pool, 100);
+        assert_non_null(allocs[i]);
+    }
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[4]), ALLOC_OK); allocs[4]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
+
+    pool_segment_t exp1[8] =
             {
                     {100, 1},
-                    {pool->total_size-100, 0}
-            }; // one allocation of 100
+                    {200, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
     check_pool(pool, exp1);
 
 
-    // 3. allocate 1000
-    alloc_pt alloc1 = mem_new_alloc(pool, 1000);
-    assert_non_null(alloc1);
-
-    pool_segment_t exp2[3] =
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
+    pool_segment_t exp2[8] =
             {
                     {100, 1},
-                    {1000, 1},
-                    {pool->total_size-100-1000, 0}
-            }; // two allocations: 100, 1000
+                    {200, 0},
+                    {100, 1},
+                    {100, 1},
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
     check_pool(pool, exp2);
 
 
-    // 4. allocate 10000
-    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
-    assert_non_null(alloc2);
-
-    pool_segment_t exp3[4] =
-            {
-                    {100, 1},
-                    {1000, 1},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // three allocations: 100, 1000, 10000
-    check_pool(pool, exp3);
-
+    // clean up
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        if (allocs[i])
+            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+    }
+    free(allocs);
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
 
-    // 5. deallocate 1000
-    status = mem_del_alloc(pool, alloc1);
-    assert_int_equal(status, ALLOC_OK);
+    
+    check_pool(pool, exp0);
+}
 
-    pool_segment_t exp4[4] =
-            {
-                    {100, 1},
-                    {1000, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // two allocations 100, 10000 w/ two gaps
-    check_pool(pool, exp4);
+static void test_pool_scenario13(void **state) {
+    alloc_status status;
+    pool_pt pool = *state;
 
+    /*
+     * Scenario 13:
+     *
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 10 x 100.
+     * 3. Deallocate 1, 4, (6, 7, 8)
+     * 4. Allocate 100.
+     * 5. Clean up.
+     */
 
-    // 6. deallocate 100
-    status = mem_del_alloc(pool, alloc0);
-    assert_int_equal(status, ALLOC_OK);
+    /*
+ * Scenario 14:
+ *
+ * 1. Pool starts out as a single gap.
+ * 2. Allocate 10 x 100.
+ * 3. Deallocate 4, 1, (6, 7, 8) (note: 4 before 1)
+ * 4. Allocate 100.
+ * 5. Clean up.
+ */
 
-    pool_segment_t exp5[3] =
+    pool_segment_t exp0[1] =
             {
-                    {1100, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // one allocations 10000 w/ two gaps
-    check_pool(pool, exp5);
+                    {pool->total_size, 0},
+            };
+    check_pool(pool, exp0);
 
 
-    // 7. allocate 1100
+    const unsigned NUM_ALLOCS = 10;
 
-    alloc_pt alloc3 = mem_new_alloc(pool, 1100);
-    assert_non_null(alloc3);
+    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
+    assert_non_null(allocs);
 
-    pool_segment_t exp6[3] =
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        allocs[i] = mem_new_alloc(pool, 100);
+        assert_non_null(allocs[i]);
+    }
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[4]), ALLOC_OK); allocs[4]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
+
+    pool_segment_t exp1[9] =
             {
-                    {1100, 1},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
             };
-    check_pool(pool, exp6);
-
+    check_pool(pool, exp1);
 
-    // 8. deallocate 10000
-    status = mem_del_alloc(pool, alloc2);
-    assert_int_equal(status, ALLOC_OK);
 
-    pool_segment_t exp7[2] =
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
+    pool_segment_t exp2[9] =
             {
-                    {1100, 1},
-                    {pool->total_size-1100, 0}
+                    {100, 1},
+                    {100, 1},
+                    {100, 1},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
             };
-    check_pool(pool, exp7);
 
+    check_pool(pool, exp2);
+
+
+    // clean up
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        if (allocs[i])
+            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+    }
+    free(allocs);
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
 
-    // 9. deallocate 1100
-    status = mem_del_alloc(pool, alloc3);
-    assert_int_equal(status, ALLOC_OK);
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario08(void **state) {
+static void test_pool_scenario14(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 08:
+     * Scenario 14:
      *
-     * 1. Pool is a gap.
-     * 2. Allocate 100.
-     * 3. Allocate 1000.
-     * 4. Allocate 10000.
-     * 5. Deallocate the 1000.
-     * 6. Deallocate the 100.
-     * 7. Try to allocate 989000. No room.
-     * 8. Deallocate the 10000.
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 10 x 100.
+     * 3. Deallocate 4, 1, (6, 7, 8) (note: 4 before 1)
+     * 4. Allocate 100.
+     * 5. Clean up.
      */
 
     pool_segment_t exp0[1] =
             {
-                    {pool->total_size, 0}
-            };  // empty pool
+                    {pool->total_size, 0},
+            };
     check_pool(pool, exp0);
 
 
-    // 2. allocate 100
-    alloc_pt alloc0 = mem_new_alloc(pool, 100);
-    assert_non_null(alloc0);
-
-    pool_segment_t exp1[2] =
-            {
-                    {100, 1},
-                    {pool->total_size-100, 0}
-            }; // one allocation of 100
-    check_pool(pool, exp1);
+    const unsigned NUM_ALLOCS = 10;
 
+    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
+    assert_non_null(allocs);
 
-    // 3. allocate 1000
-    alloc_pt alloc1 = mem_new_alloc(pool, 1000);
-    assert_non_null(alloc1);
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        allocs[i] = mem_new_alloc(pool, 100);
+        assert_non_null(allocs[i]);
+    }
+    assert_int_equal(mem_del_alloc(pool, allocs[4]), ALLOC_OK); allocs[4]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
 
-    pool_segment_t exp2[3] =
+    pool_segment_t exp1[9] =
             {
                     {100, 1},
-                    {1000, 1},
-                    {pool->total_size-100-1000, 0}
-            }; // two allocations: 100, 1000
-    check_pool(pool, exp2);
-
-
-    // 4. allocate 10000
-    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
-    assert_non_null(alloc2);
-
-    pool_segment_t exp3[4] =
-            {
+                    {100, 0},
                     {100, 1},
-                    {1000, 1},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // three allocations: 100, 1000, 10000
-    check_pool(pool, exp3);
-
-
-    // 5. deallocate 1000
-    status = mem_del_alloc(pool, alloc1);
-    assert_int_equal(status, ALLOC_OK);
-
-    pool_segment_t exp4[4] =
-            {
                     {100, 1},
-                    {1000, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // two allocations 100, 10000 w/ two gaps
-    check_pool(pool, exp4);
-
+                    {100, 0},
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_pool(pool, exp1);
 
-    // 6. deallocate 100
-    status = mem_del_alloc(pool, alloc0);
-    assert_int_equal(status, ALLOC_OK);
 
-    pool_segment_t exp5[3] =
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
+    pool_segment_t exp2[9] =
             {
-                    {1100, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // one allocations 10000 w/ two gaps
-    check_pool(pool, exp5);
-
-
-    // 7. try 989000 (should not succeed)
-    alloc_pt alloc3 = mem_new_alloc(pool, 989000);
-    assert_null(alloc3);
+                    {100, 1},
+                    {100, 1},
+                    {100, 1},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_pool(pool, exp2);
 
-    check_pool(pool, exp5);
 
+    // clean up
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        if (allocs[i])
+            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+    }
+    free(allocs);
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
 
-    // 8. deallocate 10000
-    status = mem_del_alloc(pool, alloc2);
-    assert_int_equal(status, ALLOC_OK);
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario09(void **state) {
+static void test_pool_scenario15(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 09:
+     * Scenario 15:
      *
-     * 1. Pool is a gap.
-     * 2. Allocate 100.
-     * 3. Allocate 1000.
-     * 4. Allocate 10000.
-     * 5. Deallocate the 1000.
-     * 6. Deallocate the 100.
-     * 7. Allocate 988000.
-     * 8. Deallocate the 10000.
-     * 9. Deallocate the 988000.
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 10 x 100.
+     * 3. Deallocate (1, 2), 4, (6, 7, 8)
+     * 4. Allocate 50.
+     * 5. Allocate another 50.
+     * 6. Clean up.
      */
 
     pool_segment_t exp0[1] =
             {
-                    {pool->total_size, 0}
-            };  // empty pool
+                    {pool->total_size, 0},
+            };
     check_pool(pool, exp0);
 
 
-    // 2. allocate 100
-    alloc_pt alloc0 = mem_new_alloc(pool, 100);
-    assert_non_null(alloc0);
-
-    pool_segment_t exp1[2] =
-            {
-                    {100, 1},
-                    {pool->total_size-100, 0}
-            }; // one allocation of 100
-    check_pool(pool, exp1);
+    const unsigned NUM_ALLOCS = 10;
 
+    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
+    assert_non_null(allocs);
 
-    // 3. allocate 1000
-    alloc_pt alloc1 = mem_new_alloc(pool, 1000);
-    assert_non_null(alloc1);
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        allocs[i] = mem_new_alloc(pool, 100);
+        assert_non_null(allocs[i]);
+    }
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[4]), ALLOC_OK); allocs[4]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
 
-    pool_segment_t exp2[3] =
+    pool_segment_t exp1[8] =
             {
                     {100, 1},
-                    {1000, 1},
-                    {pool->total_size-100-1000, 0}
-            }; // two allocations: 100, 1000
-    check_pool(pool, exp2);
-
-
-    // 4. allocate 10000
-    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
-    assert_non_null(alloc2);
-
-    pool_segment_t exp3[4] =
-            {
+                    {200, 0},
                     {100, 1},
-                    {1000, 1},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // three allocations: 100, 1000, 10000
-    check_pool(pool, exp3);
-
-
-    // 5. deallocate 1000
-    status = mem_del_alloc(pool, alloc1);
-    assert_int_equal(status, ALLOC_OK);
-
-    pool_segment_t exp4[4] =
-            {
+                    {100, 0},
                     {100, 1},
-                    {1000, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // two allocations 100, 10000 w/ two gaps
-    check_pool(pool, exp4);
-
-
-    // 6. deallocate 100
-    status = mem_del_alloc(pool, alloc0);
-    assert_int_equal(status, ALLOC_OK);
-
-    pool_segment_t exp5[3] =
-            {
-                    {1100, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // one allocations 10000 w/ two gaps
-    check_pool(pool, exp5);
-
+                    {300, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_pool(pool, exp1);
 
-    // 7. allocate 988000
-    alloc_pt alloc3 = mem_new_alloc(pool, 988000);
-    assert_non_null(alloc3);
 
-    pool_segment_t exp6[4] =
+    alloc_pt alloc0 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc0);
+    pool_segment_t exp2[9] =
             {
-                    {1100, 0},
-                    {10000, 1},
-                    {988000, 1},
-                    {pool->total_size-100-1000-10000-988000, 0}
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {50, 1},
+                    {50, 0},
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
             };
-    check_pool(pool, exp6);
-
+    check_pool(pool, exp2);
 
-    // 8. deallocate 10000
-    status = mem_del_alloc(pool, alloc2);
-    assert_int_equal(status, ALLOC_OK);
 
-    pool_segment_t exp7[3] =
+    alloc_pt alloc1 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc1);
+    pool_segment_t exp3[9] =
             {
-                    {11100, 0},
-                    {988000, 1},
-                    {pool->total_size-100-1000-10000-988000, 0}
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {50, 1},
+                    {50, 1},
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
             };
-    check_pool(pool, exp7);
+    check_pool(pool, exp3);
 
 
-    // 9. deallocate 988000
-    status = mem_del_alloc(pool, alloc3);
-    assert_int_equal(status, ALLOC_OK);
+    // clean up
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        if (allocs[i])
+            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+    }
+    free(allocs);
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
+
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario10(void **state) {
+static void test_pool_scenario16(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 09:
+     * Scenario 16:
      *
-     * 1. Pool is a gap.
-     * 2. Allocate 100.
-     * 3. Allocate 1000.
-     * 4. Allocate 10000.
-     * 5. Deallocate the 1000.
-     * 6. Deallocate the 100.
-     * 7. Allocate 988900.
-     * 8. Deallocate the 10000.
-     * 9. Deallocate the 988900.
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 10 x 100.
+     * 3. Deallocate 7, 5, 3, 1
+     * 4. Allocate 50.
+     * 5. Allocate another 50.
+     * 6. Clean up.
      */
 
     pool_segment_t exp0[1] =
             {
-                    {pool->total_size, 0}
-            };  // empty pool
+                    {pool->total_size, 0},
+            };
     check_pool(pool, exp0);
 
 
-    // 2. allocate 100
-    alloc_pt alloc0 = mem_new_alloc(pool, 100);
-    assert_non_null(alloc0);
+    const unsigned NUM_ALLOCS = 10;
 
-    pool_segment_t exp1[2] =
+    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
+    assert_non_null(allocs);
+
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        allocs[i] = mem_new_alloc(pool, 100);
+        assert_non_null(allocs[i]);
+    }
+    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+
+    pool_segment_t exp1[11] =
             {
                     {100, 1},
-                    {pool->total_size-100, 0}
-            }; // one allocation of 100
+                    {100, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
     check_pool(pool, exp1);
 
 
-    // 3. allocate 1000
-    alloc_pt alloc1 = mem_new_alloc(pool, 1000);
-    assert_non_null(alloc1);
-
-    pool_segment_t exp2[3] =
+    alloc_pt alloc0 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc0);
+    pool_segment_t exp2[12] =
             {
                     {100, 1},
-                    {1000, 1},
-                    {pool->total_size-100-1000, 0}
-            }; // two allocations: 100, 1000
+                    {50, 1},
+                    {50, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
     check_pool(pool, exp2);
 
 
-    // 4. allocate 10000
-    alloc_pt alloc2 = mem_new_alloc(pool, 10000);
-    assert_non_null(alloc2);
-
-    pool_segment_t exp3[4] =
+    alloc_pt alloc1 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc1);
+    pool_segment_t exp3[12] =
             {
                     {100, 1},
-                    {1000, 1},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // three allocations: 100, 1000, 10000
-    check_pool(pool, exp3);
-
-
-    // 5. deallocate 1000
-    status = mem_del_alloc(pool, alloc1);
-    assert_int_equal(status, ALLOC_OK);
-
-    pool_segment_t exp4[4] =
-            {
+                    {50, 1},
+                    {50, 1},
                     {100, 1},
-                    {1000, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // two allocations 100, 10000 w/ two gaps
-    check_pool(pool, exp4);
-
-
-    // 6. deallocate 100
-    status = mem_del_alloc(pool, alloc0);
-    assert_int_equal(status, ALLOC_OK);
+                    {100, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_pool(pool, exp3);
 
-    pool_segment_t exp5[3] =
-            {
-                    {1100, 0},
-                    {10000, 1},
-                    {pool->total_size-100-1000-10000, 0}
-            }; // one allocations 10000 w/ two gaps
-    check_pool(pool, exp5);
 
+    // clean up
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        if (allocs[i])
+            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+    }
+    free(allocs);
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
 
-    // 7. allocate 988900
-    alloc_pt alloc3 = mem_new_alloc(pool, 988900);
-    assert_non_null(alloc3);
 
-    pool_segment_t exp6[3] =
-            {
-                    {1100, 0},
-                    {10000, 1},
-                    {988900, 1},
-            };
-    check_pool(pool, exp6);
+    check_pool(pool, exp0);
+}
 
+static void test_pool_scenario17(void **state) {
+    alloc_status status;
+    pool_pt pool = *state;
 
-    // 8. deallocate 10000
-    status = mem_del_alloc(pool, alloc2);
-    assert_int_equal(status, ALLOC_OK);
+    /*
+     * Scenario 17:
+     *
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 10 x 100.
+     * 3. Deallocate (2, 1, 3), (6, 5), 8
+     * 4. Allocate 50.
+     * 5. Allocate another 50.
+     * 6. Clean up.
+     */
 
-    pool_segment_t exp7[2] =
+    pool_segment_t exp0[1] =
             {
-                    {11100, 0},
-                    {988900, 1},
+                    {pool->total_size, 0},
             };
-    check_pool(pool, exp7);
-
+    check_pool(pool, exp0);
 
-    // 9. deallocate 988900
-    status = mem_del_alloc(pool, alloc3);
-    assert_int_equal(status, ALLOC_OK);
 
-    check_pool(pool, exp0);
-}
+    const unsigned NUM_ALLOCS = 10;
 
-/*******************************************/
-/***        4. BEST_FIT SCENARIOS        ***/
-/*******************************************/
+    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
+    assert_non_null(allocs);
 
-static int pool_bf_setup(void **state) {
-    alloc_status status;
-    const alloc_policy POOL_POLICY = BEST_FIT;
-    pool_pt pool = NULL;
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        allocs[i] = mem_new_alloc(pool, 100);
+        assert_non_null(allocs[i]);
+    }
+    assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
 
-    status = mem_init();
-    assert_int_equal(status, ALLOC_OK);
+    pool_segment_t exp1[8] =
+            {
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_pool(pool, exp1);
 
-    INFO("Allocating pool of %lu bytes with policy %s\n",
-         (long) POOL_SIZE, (POOL_POLICY == FIRST_FIT) ? "FIRST_FIT" : "BEST_FIT");
-    pool = mem_pool_open(POOL_SIZE, POOL_POLICY);
-    assert_non_null(pool);
 
-    *state = pool;
+    alloc_pt alloc0 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc0);
+    pool_segment_t exp2[9] =
+            {
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {50, 1},
+                    {50, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_pool(pool, exp2);
 
-    return 0;
-}
 
-static int pool_bf_teardown(void **state) {
-    pool_pt pool = *state;
-    alloc_status status;
+    alloc_pt alloc1 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc1);
+    pool_segment_t exp3[9] =
+            {
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {50, 1},
+                    {50, 1},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
+            };
+    check_pool(pool, exp3);
 
-    INFO("Closing pool\n");
-    status = mem_pool_close(pool);
-    assert_int_equal(status, ALLOC_OK);
 
-    status = mem_free();
-    assert_int_equal(status, ALLOC_OK);
+    // clean up
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        if (allocs[i])
+            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+    }
+    free(allocs);
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
 
-    return 0;
-}
 
-static void dummy_test(void **state) {
-    (void) state;
+    check_pool(pool, exp0);
 }
 
-static void test_pool_scenario11(void **state) {
+static void test_pool_scenario18(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 11:
+     * Scenario 18:
      *
      * 1. Pool starts out as a single gap.
-     * 2. Allocate 100. That will be at the top. The rest is a gap.
-     * 3. Deallocate the 100 allocation. Pool is again one single gap.
+     * 2. Allocate 10 x 100.
+     * 3. Deallocate (2, 1, 3), (6, 5), 8
+     * 4. Allocate 999000.
+     * 5. Try to Allocate 350. Should fail.
+     * 6. Clean up.
      */
 
     pool_segment_t exp0[1] =
             {
-                    {pool->total_size, 0}
+                    {pool->total_size, 0},
             };
     check_pool(pool, exp0);
 
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 100);
-    assert_non_null(alloc0);
+    const unsigned NUM_ALLOCS = 10;
 
-    pool_segment_t exp1[2] =
+    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
+    assert_non_null(allocs);
+
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        allocs[i] = mem_new_alloc(pool, 100);
+        assert_non_null(allocs[i]);
+    }
+    assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
+
+    pool_segment_t exp1[8] =
             {
                     {100, 1},
-                    {pool->total_size-100, 0}
+                    {300, 0},
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 0},
             };
     check_pool(pool, exp1);
 
 
-    status = mem_del_alloc(pool, alloc0);
-    assert_int_equal(status, ALLOC_OK);
+    alloc_pt alloc0 = mem_new_alloc(pool, 999000);
+    assert_non_null(alloc0);
+    pool_segment_t exp2[8] =
+            {
+                    {100, 1},
+                    {300, 0},
+                    {100, 1},
+                    {200, 0},
+                    {100, 1},
+                    {100, 0},
+                    {100, 1},
+                    {pool->total_size - 1000, 1},
+            };
+    check_pool(pool, exp2);
+
+
+    alloc_pt alloc1 = mem_new_alloc(pool, 350);
+    assert_null(alloc1);
+    check_pool(pool, exp2);
+
+
+    // clean up
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        if (allocs[i])
+            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+    }
+    free(allocs);
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario12(void **state) {
+static void test_pool_scenario19(void **state) {
     alloc_status status;
     pool_pt pool = *state;
 
     /*
-     * Scenario 12:
+     * Scenario 19:
      *
      * 1. Pool starts out as a single gap.
      * 2. Allocate 10 x 100.
-     * 3. Deallocate (1, 2), 4, (6, 7, 8)
-     * 4. Allocate 100.
-     * 5. Clean up.
+     * 3. Deallocate (2, 1, 3), (6, 5), 8
+     * 4. Allocate 150.
+     * 6. Clean up.
      */
 
     pool_segment_t exp0[1] =
@@ -1638,37 +3563,38 @@ static void test_pool_scenario12(void **state) {
         allocs[i] = mem_new_alloc(pool, 100);
         assert_non_null(allocs[i]);
     }
-    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
     assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[4]), ALLOC_OK); allocs[4]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
     assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
 
     pool_segment_t exp1[8] =
             {
+                    {100, 1},
+                    {300, 0},
                     {100, 1},
                     {200, 0},
                     {100, 1},
                     {100, 0},
                     {100, 1},
-                    {300, 0},
-                    {100, 1},
                     {pool->total_size - 1000, 0},
             };
     check_pool(pool, exp1);
 
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    alloc_pt alloc0 = mem_new_alloc(pool, 150);
     assert_non_null(alloc0);
-    pool_segment_t exp2[8] =
+    pool_segment_t exp2[9] =
             {
                     {100, 1},
-                    {200, 0},
-                    {100, 1},
+                    {300, 0},
                     {100, 1},
+                    {150, 1},
+                    {50, 0},
                     {100, 1},
-                    {300, 0},
+                    {100, 0},
                     {100, 1},
                     {pool->total_size - 1000, 0},
             };
@@ -1683,33 +3609,127 @@ static void test_pool_scenario12(void **state) {
     free(allocs);
     assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
 
-    
+
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario13(void **state) {
-    alloc_status status;
+static void test_pool_scenario20(void **state) {
     pool_pt pool = *state;
 
     /*
-     * Scenario 13:
+     * Scenario 20:
      *
      * 1. Pool starts out as a single gap.
-     * 2. Allocate 10 x 100.
-     * 3. Deallocate 1, 4, (6, 7, 8)
-     * 4. Allocate 100.
-     * 5. Clean up.
+     * 2. Allocate 10 blocks of assorted sizes, each followed by a 10 spacer.
+     * 3. Deallocate the 10 blocks, leaving 11 gaps.
+     * 4. Allocate 300. Exact fit, goes into the topmost of the three 300s.
+     * 5. Allocate 250. Smallest sufficient gap is the second 300.
+     * 6. Allocate 650. Smallest sufficient gap is the 700.
+     * 7. Allocate 1000. Only the trailing gap fits.
+     * 8. Clean up.
      */
 
+    const unsigned NUM_BLOCKS = 10;
+    const size_t sizes[] = {500, 300, 700, 300, 900, 100, 300, 800, 600, 200};
+    const size_t blocks_size = 4700 + 10 * NUM_BLOCKS;
+
+    alloc_pt blocks[NUM_BLOCKS], spacers[NUM_BLOCKS];
+    char *block_mem[NUM_BLOCKS];
+
+    for (int i=0; i<NUM_BLOCKS; ++i) {
+        blocks[i] = mem_new_alloc(pool, sizes[i]);
+        assert_non_null(blocks[i]);
+        block_mem[i] = blocks[i]->mem;
+        spacers[i] = mem_new_alloc(pool, 10);
+        assert_non_null(spacers[i]);
+    }
+    for (int i=0; i<NUM_BLOCKS; ++i) {
+        assert_int_equal(mem_del_alloc(pool, blocks[i]), ALLOC_OK);
+    }
+    check_metadata(pool, BEST_FIT, POOL_SIZE, 10 * NUM_BLOCKS, NUM_BLOCKS, NUM_BLOCKS + 1);
+
+
+    alloc_pt alloc0 = mem_new_alloc(pool, 300);
+    assert_non_null(alloc0);
+    assert_true(alloc0->mem == block_mem[1]);
+    check_metadata(pool, BEST_FIT, POOL_SIZE, 10 * NUM_BLOCKS + 300, NUM_BLOCKS + 1, NUM_BLOCKS);
+
+    alloc_pt alloc1 = mem_new_alloc(pool, 250);
+    assert_non_null(alloc1);
+    assert_true(alloc1->mem == block_mem[3]);
+
+    alloc_pt alloc2 = mem_new_alloc(pool, 650);
+    assert_non_null(alloc2);
+    assert_true(alloc2->mem == block_mem[2]);
+
+    alloc_pt alloc3 = mem_new_alloc(pool, 1000);
+    assert_non_null(alloc3);
+    assert_true(alloc3->mem == pool->mem + blocks_size);
+
+    check_metadata(pool, BEST_FIT, POOL_SIZE, 10 * NUM_BLOCKS + 2200, NUM_BLOCKS + 4, NUM_BLOCKS);
+
+
+    // clean up
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc2), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc3), ALLOC_OK);
+    for (int i=0; i<NUM_BLOCKS; ++i) {
+        assert_int_equal(mem_del_alloc(pool, spacers[i]), ALLOC_OK);
+    }
+
+    check_metadata(pool, BEST_FIT, POOL_SIZE, 0, 0, 1);
+}
+
+/*******************************************/
+/***     5. SEGREGATED_FIT SCENARIOS     ***/
+/*******************************************/
+
+static int pool_sf_setup(void **state) {
+    alloc_status status;
+    pool_pt pool = NULL;
+
+    status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating pool of %lu bytes with policy %s\n",
+         (long) POOL_SIZE, "SEGREGATED_FIT");
+    pool = mem_pool_open(POOL_SIZE, SEGREGATED_FIT);
+    assert_non_null(pool);
+
+    *state = pool;
+
+    return 0;
+}
+
+static int pool_sf_teardown(void **state) {
+    pool_pt pool = *state;
+    alloc_status status;
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+
+    return 0;
+}
+
+static void test_pool_scenario21(void **state) {
+    pool_pt pool = *state;
+
     /*
- * Scenario 14:
- *
- * 1. Pool starts out as a single gap.
- * 2. Allocate 10 x 100.
- * 3. Deallocate 4, 1, (6, 7, 8) (note: 4 before 1)
- * 4. Allocate 100.
- * 5. Clean up.
- */
+     * Scenario 21:
+     *
+     * 1. Pool starts out as a single gap.
+     * 2. Allocate 10 x 100, except for 102 at 5.
+     * 3. Deallocate (2, 1), 5
+     * 4. Allocate 150. The 200 gap is in a size class that fits.
+     * 5. Allocate 101. The 102 gap shares the request's size class [100, 104),
+     *    which is not guaranteed to fit, so it comes from the trailing gap.
+     * 6. Clean up.
+     */
 
     pool_segment_t exp0[1] =
             {
@@ -1724,46 +3744,41 @@ static void test_pool_scenario13(void **state) {
     assert_non_null(allocs);
 
     for (int i=0; i<NUM_ALLOCS; ++i) {
-        allocs[i] = mem_new_alloc(pool, 100);
+        allocs[i] = mem_new_alloc(pool, (i == 5) ? 102 : 100);
         assert_non_null(allocs[i]);
     }
+    assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
     assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[4]), ALLOC_OK); allocs[4]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
-
-    pool_segment_t exp1[9] =
-            {
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_pool(pool, exp1);
+    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
+    check_metadata(pool, SEGREGATED_FIT, POOL_SIZE, 700, 7, 3);
 
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    alloc_pt alloc0 = mem_new_alloc(pool, 150);
     assert_non_null(alloc0);
-    pool_segment_t exp2[9] =
+    assert_true(alloc0->mem == pool->mem + 100);
+
+
+    alloc_pt alloc1 = mem_new_alloc(pool, 101);
+    assert_non_null(alloc1);
+    assert_true(alloc1->mem == pool->mem + 1002);
+
+    pool_segment_t exp1[12] =
             {
+                    {100, 1},
+                    {150, 1},
+                    {50, 0},
                     {100, 1},
                     {100, 1},
+                    {102, 0},
                     {100, 1},
                     {100, 1},
-                    {100, 0},
                     {100, 1},
-                    {300, 0},
                     {100, 1},
-                    {pool->total_size - 1000, 0},
+                    {101, 1},
+                    {pool->total_size - 1103, 0},
             };
-
-    check_pool(pool, exp2);
+    check_pool(pool, exp1);
+    check_metadata(pool, SEGREGATED_FIT, POOL_SIZE, 951, 9, 3);
 
 
     // clean up
@@ -1773,23 +3788,22 @@ static void test_pool_scenario13(void **state) {
     }
     free(allocs);
     assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
 
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario14(void **state) {
-    alloc_status status;
+static void test_pool_scenario22(void **state) {
     pool_pt pool = *state;
 
     /*
-     * Scenario 14:
+     * Scenario 22:
      *
      * 1. Pool starts out as a single gap.
-     * 2. Allocate 10 x 100.
-     * 3. Deallocate 4, 1, (6, 7, 8) (note: 4 before 1)
-     * 4. Allocate 100.
-     * 5. Clean up.
+     * 2. Allocate the whole pool. No size class is guaranteed to fit, but
+     *    the gap in the request's own class does.
+     * 3. Deallocate it. Pool is again one single gap.
      */
 
     pool_segment_t exp0[1] =
@@ -1799,78 +3813,73 @@ static void test_pool_scenario14(void **state) {
     check_pool(pool, exp0);
 
 
-    const unsigned NUM_ALLOCS = 10;
-
-    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
-    assert_non_null(allocs);
-
-    for (int i=0; i<NUM_ALLOCS; ++i) {
-        allocs[i] = mem_new_alloc(pool, 100);
-        assert_non_null(allocs[i]);
-    }
-    assert_int_equal(mem_del_alloc(pool, allocs[4]), ALLOC_OK); allocs[4]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
+    alloc_pt alloc0 = mem_new_alloc(pool, pool->total_size);
+    assert_non_null(alloc0);
 
-    pool_segment_t exp1[9] =
+    pool_segment_t exp1[1] =
             {
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
+                    {pool->total_size, 1},
             };
     check_pool(pool, exp1);
+    check_metadata(pool, SEGREGATED_FIT, POOL_SIZE, POOL_SIZE, 1, 0);
 
-
-    alloc_pt alloc0 = mem_new_alloc(pool, 100);
-    assert_non_null(alloc0);
-    pool_segment_t exp2[9] =
-            {
-                    {100, 1},
-                    {100, 1},
-                    {100, 1},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_pool(pool, exp2);
+    assert_null(mem_new_alloc(pool, 1));
 
 
-    // clean up
-    for (int i=0; i<NUM_ALLOCS; ++i) {
-        if (allocs[i])
-            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
-    }
-    free(allocs);
     assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
 
-
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario15(void **state) {
+
+/*******************************************/
+/***     6. BOUNDARY-TAG SCENARIOS       ***/
+/*******************************************/
+
+static int pool_bt_setup(void **state) {
+    alloc_status status;
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = SEGREGATED_FIT, .kind = POOL_BOUNDARY_TAG };
+
+    status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating boundary-tag pool of %lu bytes with policy %s\n",
+         (long) POOL_SIZE, "SEGREGATED_FIT");
+    pool = mem_pool_open_opts(POOL_SIZE, &opts);
+    assert_non_null(pool);
+
+    *state = pool;
+
+    return 0;
+}
+
+static int pool_bt_teardown(void **state) {
+    pool_pt pool = *state;
     alloc_status status;
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+
+    return 0;
+}
+
+static void test_pool_scenario24(void **state) {
     pool_pt pool = *state;
 
     /*
-     * Scenario 15:
+     * Scenario 24:
      *
      * 1. Pool starts out as a single gap.
-     * 2. Allocate 10 x 100.
-     * 3. Deallocate (1, 2), 4, (6, 7, 8)
-     * 4. Allocate 50.
-     * 5. Allocate another 50.
-     * 6. Clean up.
+     * 2. Allocate 10 x 100. Each block holds a 24-byte header and
+     *    is rounded up to 8 bytes, so it takes 128 bytes.
+     * 3. Deallocate (2, 1), 5, 3. Neighboring gaps coalesce.
+     * 4. Deallocate 4, which joins the gaps on both sides.
+     * 5. Clean up.
      */
 
     pool_segment_t exp0[1] =
@@ -1888,60 +3897,45 @@ static void test_pool_scenario15(void **state) {
     for (int i=0; i<NUM_ALLOCS; ++i) {
         allocs[i] = mem_new_alloc(pool, 100);
         assert_non_null(allocs[i]);
+        assert_int_equal(allocs[i]->size, 100);
     }
-    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_true(allocs[1]->mem == allocs[0]->mem + 128);
+
     assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[4]), ALLOC_OK); allocs[4]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
+    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
 
-    pool_segment_t exp1[8] =
+    pool_segment_t exp1[9] =
             {
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
+                    {128, 1},
+                    {384, 0},
+                    {128, 1},
+                    {128, 0},
+                    {128, 1},
+                    {128, 1},
+                    {128, 1},
+                    {128, 1},
+                    {pool->total_size - 1280, 0},
             };
     check_pool(pool, exp1);
+    check_metadata(pool, SEGREGATED_FIT, POOL_SIZE, 600, 6, 3);
 
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 50);
-    assert_non_null(alloc0);
-    pool_segment_t exp2[9] =
-            {
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {50, 1},
-                    {50, 0},
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_pool(pool, exp2);
-
+    assert_int_equal(mem_del_alloc(pool, allocs[4]), ALLOC_OK); allocs[4]=0;
 
-    alloc_pt alloc1 = mem_new_alloc(pool, 50);
-    assert_non_null(alloc1);
-    pool_segment_t exp3[9] =
+    pool_segment_t exp2[7] =
             {
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {50, 1},
-                    {50, 1},
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
+                    {128, 1},
+                    {640, 0},
+                    {128, 1},
+                    {128, 1},
+                    {128, 1},
+                    {128, 1},
+                    {pool->total_size - 1280, 0},
             };
-    check_pool(pool, exp3);
+    check_pool(pool, exp2);
+    check_metadata(pool, SEGREGATED_FIT, POOL_SIZE, 500, 5, 2);
 
 
     // clean up
@@ -1950,26 +3944,24 @@ static void test_pool_scenario15(void **state) {
             assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
     }
     free(allocs);
-    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
-    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
 
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario16(void **state) {
-    alloc_status status;
+static void test_pool_scenario25(void **state) {
     pool_pt pool = *state;
 
     /*
-     * Scenario 16:
+     * Scenario 25:
      *
      * 1. Pool starts out as a single gap.
-     * 2. Allocate 10 x 100.
-     * 3. Deallocate 7, 5, 3, 1
-     * 4. Allocate 50.
-     * 5. Allocate another 50.
-     * 6. Clean up.
+     * 2. Allocate 100. The allocation record is the block header,
+     *    right in front of the allocation in the pool memory.
+     * 3. Deallocate it twice, and an address inside it. Only the
+     *    first deallocation succeeds.
+     * 4. Allocate the whole pool, minus the header.
+     * 5. Clean up.
      */
 
     pool_segment_t exp0[1] =
@@ -1979,103 +3971,89 @@ static void test_pool_scenario16(void **state) {
     check_pool(pool, exp0);
 
 
-    const unsigned NUM_ALLOCS = 10;
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
+    assert_true((char *) alloc0 >= pool->mem && (char *) alloc0 < alloc0->mem);
+    assert_true(alloc0->mem == pool->mem + 24);
 
-    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
-    assert_non_null(allocs);
+    assert_int_equal(mem_del_alloc_addr(pool, alloc0->mem + 8), ALLOC_FAIL);
+    assert_int_equal(mem_del_alloc_addr(pool, alloc0->mem), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, pool->mem + 24), ALLOC_FAIL);
+    check_pool(pool, exp0);
 
-    for (int i=0; i<NUM_ALLOCS; ++i) {
-        allocs[i] = mem_new_alloc(pool, 100);
-        assert_non_null(allocs[i]);
-    }
-    assert_int_equal(mem_del_alloc(pool, allocs[7]), ALLOC_OK); allocs[7]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
 
-    pool_segment_t exp1[11] =
+    alloc_pt alloc1 = mem_new_alloc(pool, pool->total_size - 24);
+    assert_non_null(alloc1);
+
+    pool_segment_t exp1[1] =
             {
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
+                    {pool->total_size, 1},
             };
     check_pool(pool, exp1);
+    check_metadata(pool, SEGREGATED_FIT, POOL_SIZE, POOL_SIZE - 24, 1, 0);
 
+    assert_null(mem_new_alloc(pool, 1));
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 50);
-    assert_non_null(alloc0);
-    pool_segment_t exp2[12] =
-            {
-                    {100, 1},
-                    {50, 1},
-                    {50, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_pool(pool, exp2);
 
+    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
 
-    alloc_pt alloc1 = mem_new_alloc(pool, 50);
-    assert_non_null(alloc1);
-    pool_segment_t exp3[12] =
-            {
-                    {100, 1},
-                    {50, 1},
-                    {50, 1},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_pool(pool, exp3);
+    check_pool(pool, exp0);
+}
 
 
-    // clean up
-    for (int i=0; i<NUM_ALLOCS; ++i) {
-        if (allocs[i])
-            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
-    }
-    free(allocs);
-    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
-    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
+/*******************************************/
+/***       7. NEXT_FIT SCENARIOS         ***/
+/*******************************************/
+
+static int pool_nf_setup(void **state) {
+    alloc_status status;
+    pool_pt pool = NULL;
+
+    status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating pool of %lu bytes with policy %s\n",
+         (long) POOL_SIZE, "NEXT_FIT");
+    pool = mem_pool_open(POOL_SIZE, NEXT_FIT);
+    assert_non_null(pool);
+
+    *state = pool;
+
+    return 0;
+}
 
+static int pool_nf_teardown(void **state) {
+    pool_pt pool = *state;
+    alloc_status status;
 
-    check_pool(pool, exp0);
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+
+    return 0;
 }
 
-static void test_pool_scenario17(void **state) {
-    alloc_status status;
+static void test_pool_scenario26(void **state) {
     pool_pt pool = *state;
 
     /*
-     * Scenario 17:
+     * Scenario 26:
      *
      * 1. Pool starts out as a single gap.
      * 2. Allocate 10 x 100.
-     * 3. Deallocate (2, 1, 3), (6, 5), 8
-     * 4. Allocate 50.
-     * 5. Allocate another 50.
-     * 6. Clean up.
+     * 3. Deallocate 2, 5.
+     * 4. Allocate 100. It goes after 9, where the search stopped.
+     * 5. Allocate the rest of the trailing gap. The search wraps around.
+     * 6. Allocate 50, which goes at the top of the gap at 2.
+     * 7. Allocate 60, which skips the remaining 50 and goes at 5.
+     * 8. Deallocate the 60. Its gap absorbs the one the search was to
+     *    resume at.
+     * 9. Allocate 50. The search resumes at the merged gap, so it goes at
+     *    5 again, not into the gap at 2.
+     * 10. Clean up.
      */
 
     pool_segment_t exp0[1] =
@@ -2095,58 +4073,52 @@ static void test_pool_scenario17(void **state) {
         assert_non_null(allocs[i]);
     }
     assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
     assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
-
-    pool_segment_t exp1[8] =
-            {
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_pool(pool, exp1);
 
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 50);
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
     assert_non_null(alloc0);
-    pool_segment_t exp2[9] =
+    assert_true(alloc0->mem == pool->mem + 1000);
+
+    alloc_pt alloc1 = mem_new_alloc(pool, pool->total_size - 1100);
+    assert_non_null(alloc1);
+    assert_true(alloc1->mem == pool->mem + 1100);
+
+    alloc_pt alloc2 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc2);
+    assert_true(alloc2->mem == pool->mem + 200);
+
+    alloc_pt alloc3 = mem_new_alloc(pool, 60);
+    assert_non_null(alloc3);
+    assert_true(alloc3->mem == pool->mem + 500);
+    check_metadata(pool, NEXT_FIT, POOL_SIZE, POOL_SIZE - 90, 12, 2);
+
+
+    assert_int_equal(mem_del_alloc(pool, alloc3), ALLOC_OK);
+
+    alloc_pt alloc4 = mem_new_alloc(pool, 50);
+    assert_non_null(alloc4);
+    assert_true(alloc4->mem == pool->mem + 500);
+
+    pool_segment_t exp1[14] =
             {
                     {100, 1},
-                    {300, 0},
                     {100, 1},
-                    {200, 0},
+                    {50, 1},
+                    {50, 0},
+                    {100, 1},
                     {100, 1},
                     {50, 1},
                     {50, 0},
                     {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_pool(pool, exp2);
-
-
-    alloc_pt alloc1 = mem_new_alloc(pool, 50);
-    assert_non_null(alloc1);
-    pool_segment_t exp3[9] =
-            {
                     {100, 1},
-                    {300, 0},
                     {100, 1},
-                    {200, 0},
                     {100, 1},
-                    {50, 1},
-                    {50, 1},
                     {100, 1},
-                    {pool->total_size - 1000, 0},
+                    {pool->total_size - 1100, 1},
             };
-    check_pool(pool, exp3);
+    check_pool(pool, exp1);
+    check_metadata(pool, NEXT_FIT, POOL_SIZE, POOL_SIZE - 100, 12, 2);
 
 
     // clean up
@@ -2157,184 +4129,241 @@ static void test_pool_scenario17(void **state) {
     free(allocs);
     assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
     assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc2), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc4), ALLOC_OK);
 
 
     check_pool(pool, exp0);
 }
 
-static void test_pool_scenario18(void **state) {
+
+/*******************************************/
+/***         8. BUDDY SCENARIOS          ***/
+/*******************************************/
+
+static int pool_bd_setup(void **state) {
+    alloc_status status;
+    pool_pt pool = NULL;
+
+    status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating pool of %lu bytes with policy %s\n",
+         (long) POOL_SIZE, "BUDDY");
+    pool = mem_pool_open(POOL_SIZE, BUDDY);
+    assert_non_null(pool);
+
+    *state = pool;
+
+    return 0;
+}
+
+static int pool_bd_teardown(void **state) {
+    pool_pt pool = *state;
     alloc_status status;
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+
+    return 0;
+}
+
+static void test_pool_scenario27(void **state) {
     pool_pt pool = *state;
 
     /*
-     * Scenario 18:
+     * Scenario 27:
      *
-     * 1. Pool starts out as a single gap.
-     * 2. Allocate 10 x 100.
-     * 3. Deallocate (2, 1, 3), (6, 5), 8
-     * 4. Allocate 999000.
-     * 5. Try to Allocate 350. Should fail.
-     * 6. Clean up.
+     * 1. Pool starts out as 7 top-level power-of-two blocks.
+     * 2. Allocate 100. It gets a 128 block, split off the 512 block.
+     * 3. Allocate 4096, split off the 16384 block.
+     * 4. Allocate 60. The 64 block fits without a split.
+     * 5. Deallocate 4096, which merges back into the 16384 block.
+     * 6. Deallocate 100, which merges back into the 512 block.
+     * 7. Clean up.
      */
 
-    pool_segment_t exp0[1] =
+    pool_segment_t exp0[7] =
             {
-                    {pool->total_size, 0},
+                    {524288, 0},
+                    {262144, 0},
+                    {131072, 0},
+                    {65536, 0},
+                    {16384, 0},
+                    {512, 0},
+                    {64, 0},
             };
     check_pool(pool, exp0);
+    check_metadata(pool, BUDDY, POOL_SIZE, 0, 0, 7);
 
 
-    const unsigned NUM_ALLOCS = 10;
+    alloc_pt alloc0 = mem_new_alloc(pool, 100);
+    assert_non_null(alloc0);
+    assert_int_equal(alloc0->size, 128);
+    assert_true(alloc0->mem == pool->mem + 999424);
 
-    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
-    assert_non_null(allocs);
+    alloc_pt alloc1 = mem_new_alloc(pool, 4096);
+    assert_non_null(alloc1);
+    assert_true(alloc1->mem == pool->mem + 983040);
 
-    for (int i=0; i<NUM_ALLOCS; ++i) {
-        allocs[i] = mem_new_alloc(pool, 100);
-        assert_non_null(allocs[i]);
-    }
-    assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
+    alloc_pt alloc2 = mem_new_alloc(pool, 60);
+    assert_non_null(alloc2);
+    assert_int_equal(alloc2->size, 64);
+    assert_true(alloc2->mem == pool->mem + 999936);
 
-    pool_segment_t exp1[8] =
+    pool_segment_t exp1[11] =
             {
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
+                    {524288, 0},
+                    {262144, 0},
+                    {131072, 0},
+                    {65536, 0},
+                    {4096, 1},
+                    {4096, 0},
+                    {8192, 0},
+                    {128, 1},
+                    {128, 0},
+                    {256, 0},
+                    {64, 1},
             };
     check_pool(pool, exp1);
+    check_metadata(pool, BUDDY, POOL_SIZE, 4288, 3, 8);
 
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 999000);
-    assert_non_null(alloc0);
-    pool_segment_t exp2[8] =
+    assert_int_equal(mem_del_alloc(pool, alloc1), ALLOC_OK);
+    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
+
+    pool_segment_t exp2[7] =
             {
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 1},
+                    {524288, 0},
+                    {262144, 0},
+                    {131072, 0},
+                    {65536, 0},
+                    {16384, 0},
+                    {512, 0},
+                    {64, 1},
             };
     check_pool(pool, exp2);
+    check_metadata(pool, BUDDY, POOL_SIZE, 64, 1, 6);
 
 
-    alloc_pt alloc1 = mem_new_alloc(pool, 350);
-    assert_null(alloc1);
-    check_pool(pool, exp2);
+    // clean up
+    assert_int_equal(mem_del_alloc(pool, alloc2), ALLOC_OK);
 
+    check_pool(pool, exp0);
+}
 
-    // clean up
-    for (int i=0; i<NUM_ALLOCS; ++i) {
-        if (allocs[i])
-            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
-    }
-    free(allocs);
-    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
 
+/*******************************************/
+/***          9. SLAB SCENARIOS          ***/
+/*******************************************/
+
+static const size_t SLAB_OBJ_SIZE = 100;  // slots of 104 bytes
 
-    check_pool(pool, exp0);
+static int pool_sl_setup(void **state) {
+    alloc_status status;
+    pool_pt pool = NULL;
+    pool_opts_t opts = { .policy = FIRST_FIT, .kind = POOL_SLAB, .obj_size = SLAB_OBJ_SIZE };
+
+    status = mem_init();
+    assert_int_equal(status, ALLOC_OK);
+
+    INFO("Allocating slab pool of %lu bytes for objects of %lu bytes\n",
+         (long) POOL_SIZE, (long) SLAB_OBJ_SIZE);
+    pool = mem_pool_open_opts(POOL_SIZE, &opts);
+    assert_non_null(pool);
+
+    *state = pool;
+
+    return 0;
 }
 
-static void test_pool_scenario19(void **state) {
+static int pool_sl_teardown(void **state) {
+    pool_pt pool = *state;
     alloc_status status;
+
+    INFO("Closing pool\n");
+    status = mem_pool_close(pool);
+    assert_int_equal(status, ALLOC_OK);
+
+    status = mem_free();
+    assert_int_equal(status, ALLOC_OK);
+
+    return 0;
+}
+
+static void test_pool_scenario28(void **state) {
     pool_pt pool = *state;
 
     /*
-     * Scenario 19:
+     * Scenario 28:
      *
-     * 1. Pool starts out as a single gap.
-     * 2. Allocate 10 x 100.
-     * 3. Deallocate (2, 1, 3), (6, 5), 8
-     * 4. Allocate 150.
-     * 6. Clean up.
+     * 1. Pool starts out as 9615 free slots of 104 bytes.
+     * 2. Allocate 3 x 100. Objects larger than a slot are refused.
+     * 3. Deallocate 1, twice. Only the first deallocation succeeds.
+     * 4. Allocate 50. It gets the slot of 1 back.
+     * 5. Clean up.
      */
 
-    pool_segment_t exp0[1] =
-            {
-                    {pool->total_size, 0},
-            };
-    check_pool(pool, exp0);
+    const unsigned NUM_SLOTS = POOL_SIZE / 104;
+    pool_segment_pt exp = (pool_segment_pt) calloc(NUM_SLOTS, sizeof(pool_segment_t));
+    assert_non_null(exp);
+
+    for (unsigned i=0; i<NUM_SLOTS; ++i) {
+        exp[i].size = 104;
+    }
+    check_pool(pool, exp);
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 0, 0, NUM_SLOTS);
 
 
-    const unsigned NUM_ALLOCS = 10;
+    const unsigned NUM_ALLOCS = 3;
 
-    alloc_pt *allocs = (alloc_pt *) calloc(NUM_ALLOCS, sizeof(alloc_pt));
-    assert_non_null(allocs);
+    alloc_pt allocs[NUM_ALLOCS];
 
     for (int i=0; i<NUM_ALLOCS; ++i) {
         allocs[i] = mem_new_alloc(pool, 100);
         assert_non_null(allocs[i]);
+        assert_true(allocs[i]->mem == pool->mem + i * 104);
     }
-    assert_int_equal(mem_del_alloc(pool, allocs[2]), ALLOC_OK); allocs[2]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK); allocs[1]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[3]), ALLOC_OK); allocs[3]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[6]), ALLOC_OK); allocs[6]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[5]), ALLOC_OK); allocs[5]=0;
-    assert_int_equal(mem_del_alloc(pool, allocs[8]), ALLOC_OK); allocs[8]=0;
+    assert_null(mem_new_alloc(pool, 105));
 
-    pool_segment_t exp1[8] =
-            {
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {200, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_pool(pool, exp1);
+    char *mem1 = allocs[1]->mem;
+    assert_int_equal(mem_del_alloc(pool, allocs[1]), ALLOC_OK);
+    assert_int_equal(mem_del_alloc_addr(pool, mem1), ALLOC_FAIL);
 
+    allocs[1] = mem_new_alloc(pool, 50);
+    assert_non_null(allocs[1]);
+    assert_true(allocs[1]->mem == mem1);
 
-    alloc_pt alloc0 = mem_new_alloc(pool, 150);
-    assert_non_null(alloc0);
-    pool_segment_t exp2[9] =
-            {
-                    {100, 1},
-                    {300, 0},
-                    {100, 1},
-                    {150, 1},
-                    {50, 0},
-                    {100, 1},
-                    {100, 0},
-                    {100, 1},
-                    {pool->total_size - 1000, 0},
-            };
-    check_pool(pool, exp2);
+    for (int i=0; i<NUM_ALLOCS; ++i) {
+        exp[i].allocated = 1;
+    }
+    check_pool(pool, exp);
+    check_metadata(pool, FIRST_FIT, POOL_SIZE, 250, 3, NUM_SLOTS - 3);
 
 
     // clean up
     for (int i=0; i<NUM_ALLOCS; ++i) {
-        if (allocs[i])
-            assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+        assert_int_equal(mem_del_alloc(pool, allocs[i]), ALLOC_OK);
+        exp[i].allocated = 0;
     }
-    free(allocs);
-    assert_int_equal(mem_del_alloc(pool, alloc0), ALLOC_OK);
 
 
-    check_pool(pool, exp0);
+    check_pool(pool, exp);
+    free(exp);
 }
 
+
 /*******************************************/
-/***          5. STRESS TEST             ***/
+/***         10. STRESS TEST             ***/
 /***                                     ***/
-/***         [non-functional]            ***/
 /***         [see NOTE below]            ***/
 /*******************************************/
 
-void test_pool_stresstest(void **state) {
+static void test_pool_stresstest(void **state) {
     (void) state; /* unused */
 
     const unsigned num_pools = 200;
@@ -2347,11 +4376,12 @@ void test_pool_stresstest(void **state) {
 
 
     pool_pt pools[num_pools];
-    alloc_pt allocations[num_pools][num_allocations];
+    char *allocations[num_pools][num_allocations];
 
     /*
-     * NOTE: This will work iff the address of the allocation
-     * in the pool is returned to the user instead of the
+     * NOTE: This works because it uses the address API
+     * (mem_new_alloc_addr/mem_del_alloc_addr), which hands out
+     * the address of the allocation in the pool instead of the
      * address of the allocation record. Since allocation records
      * are a part of the nodes, when the node heap is reallocated
      * the node addresses shift with it, and so do the allocation
@@ -2368,6 +4398,8 @@ void test_pool_stresstest(void **state) {
      * 3. In each pool 500 deallocations (many gaps)
      */
 
+    clock_t start = clock();
+
     // initialize store
     assert_int_equal(mem_init(), ALLOC_OK);
 
@@ -2381,7 +4413,7 @@ void test_pool_stresstest(void **state) {
         unsigned allocated = 0;
         for (unsigned aix=0; aix < num_allocations; ++aix) {
             allocations[pix][aix] =
-                    mem_new_alloc(pools[pix], (aix + 1) * min_alloc_size);
+                    mem_new_alloc_addr(pools[pix], (aix + 1) * min_alloc_size);
             allocated += (aix + 1) * min_alloc_size;
             if (!allocations[pix][aix]) {
                 INFO("ASSERT WILL FAIL at pix = %u, aix = %u, allocated = %u\n", pix, aix, allocated);
@@ -2392,7 +4424,7 @@ void test_pool_stresstest(void **state) {
         for (unsigned aix=0; aix < num_allocations; ++aix) {
             if (aix % 2) {
                 assert_int_equal(
-                        mem_del_alloc(pools[pix], allocations[pix][aix]),
+                        mem_del_alloc_addr(pools[pix], allocations[pix][aix]),
                         ALLOC_OK);
                 allocations[pix][aix] = NULL;
             }
@@ -2406,7 +4438,7 @@ void test_pool_stresstest(void **state) {
             if (allocations[pix][aix]) {
                 // delete allocation
                 assert_int_equal(
-                    mem_del_alloc(pools[pix], allocations[pix][aix]),
+                    mem_del_alloc_addr(pools[pix], allocations[pix][aix]),
                     ALLOC_OK);
             }
         }
@@ -2416,11 +4448,13 @@ void test_pool_stresstest(void **state) {
 
     // free store
     assert_int_equal(mem_free(), ALLOC_OK);
+
+    INFO("Stress test took %.3f s\n", (double) (clock() - start) / CLOCKS_PER_SEC);
 }
 
 
 /*******************************************/
-/***         6. DRIVER ROUTINE           ***/
+/***        11. DRIVER ROUTINE           ***/
 /*******************************************/
 
 int run_test_suite() {
@@ -2429,6 +4463,23 @@ int run_test_suite() {
             cmocka_unit_test(test_pool_smoketest),
 
             cmocka_unit_test(test_pool_nonempty),
+            cmocka_unit_test(test_pool_addr),
+            cmocka_unit_test(test_pool_threads),
+            cmocka_unit_test(test_pool_thread_cache),
+            cmocka_unit_test(test_pool_shards),
+            cmocka_unit_test(test_pool_remote_free),
+            cmocka_unit_test(test_pool_lock_free),
+            cmocka_unit_test(test_pool_batch),
+            cmocka_unit_test(test_pool_arena),
+            cmocka_unit_test(test_pool_realloc),
+            cmocka_unit_test(test_pool_aligned),
+            cmocka_unit_test(test_pool_handles),
+            cmocka_unit_test(test_pool_mapped),
+            cmocka_unit_test(test_pool_decommit),
+            cmocka_unit_test(test_pool_growable),
+            cmocka_unit_test(test_pool_file),
+            cmocka_unit_test(test_pool_shared),
+            cmocka_unit_test(test_pool_numa),
 
             cmocka_unit_test_setup_teardown(test_pool_ff_metadata, pool_ff_setup, pool_ff_teardown),
             cmocka_unit_test_setup_teardown(test_pool_bf_metadata, pool_bf_setup, pool_bf_teardown),
@@ -2444,6 +4495,7 @@ int run_test_suite() {
             cmocka_unit_test_setup_teardown(test_pool_scenario08, pool_ff_setup, pool_ff_teardown),
             cmocka_unit_test_setup_teardown(test_pool_scenario09, pool_ff_setup, pool_ff_teardown),
             cmocka_unit_test_setup_teardown(test_pool_scenario10, pool_ff_setup, pool_ff_teardown),
+            cmocka_unit_test_setup_teardown(test_pool_scenario23, pool_ff_setup, pool_ff_teardown),
 
             cmocka_unit_test_setup_teardown(test_pool_scenario11, pool_bf_setup, pool_bf_teardown),
             cmocka_unit_test_setup_teardown(test_pool_scenario12, pool_bf_setup, pool_bf_teardown),
@@ -2454,15 +4506,26 @@ int run_test_suite() {
             cmocka_unit_test_setup_teardown(test_pool_scenario17, pool_bf_setup, pool_bf_teardown),
             cmocka_unit_test_setup_teardown(test_pool_scenario18, pool_bf_setup, pool_bf_teardown),
             cmocka_unit_test_setup_teardown(test_pool_scenario19, pool_bf_setup, pool_bf_teardown),
+            cmocka_unit_test_setup_teardown(test_pool_scenario20, pool_bf_setup, pool_bf_teardown),
+
+            cmocka_unit_test_setup_teardown(test_pool_scenario21, pool_sf_setup, pool_sf_teardown),
+            cmocka_unit_test_setup_teardown(test_pool_scenario22, pool_sf_setup, pool_sf_teardown),
+
+            cmocka_unit_test_setup_teardown(test_pool_scenario24, pool_bt_setup, pool_bt_teardown),
+            cmocka_unit_test_setup_teardown(test_pool_scenario25, pool_bt_setup, pool_bt_teardown),
+
+            cmocka_unit_test_setup_teardown(test_pool_scenario26, pool_nf_setup, pool_nf_teardown),
+
+            cmocka_unit_test_setup_teardown(test_pool_scenario27, pool_bd_setup, pool_bd_teardown),
+
+            cmocka_unit_test_setup_teardown(test_pool_scenario28, pool_sl_setup, pool_sl_teardown),
 
-            // do not uncomment until the project is changed to return the allocation address
-//            cmocka_unit_test(test_pool_stresstest),
+            cmocka_unit_test(test_pool_stresstest),
     };
 
     return cmocka_run_group_tests_name("pool_test_suite", tests, NULL, NULL);
 }
 
 /* future editions */
-// TODO stress test: many pools, many allocations, many gaps (requires project refactoring, see NOTE in test body)
 // TODO test memory leaks: any way to do it w/o having to rewrite the source file?
 // TODO fix the final PASSED line of std::cerr output to the end of the file (?)